@@ -0,0 +1,83 @@
+#ifndef PEDAL_BLOB_H
+#define PEDAL_BLOB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "pedal_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Packed binary config, stored as one NVS blob and exchanged with the web UI
+ * (/api/settings, /api/save). All fields little-endian, no padding.
+ *
+ *   header   0  u8[4]  magic "MBXC"
+ *            4  u8     version (PEDAL_BLOB_VERSION)
+ *            5  u8     bank count (4)
+ *            6  u16    payload length
+ *            8  u32    CRC-32 (IEEE) of the payload
+ *   payload  0  u8     brightness
+ *            1  u8     flags (bit0: ds_en)
+ *            2  u16    ds_min
+ *            4  bank[4], 143 bytes each:
+ *                 u8 exp ch, u8 exp cc, u8 exp crv, u16 exp min, u16 exp max
+ *                 switch[8], 17 bytes each:
+ *                   u8 p[3], lp[3], l[3]        type, channel, value
+ *                   u8 pe, lpe, le, pm, lpm, lm, incl
+ *                   u8 flags                    PEDAL_SW_*
+ *          576  curve[4], 17 bytes each (version 2):
+ *                 u8 point count, u8 pts[8][2]  travel, output
+ *          644  u16 exp_usb_hz, u16 exp_ble_hz  (version 3)
+ *
+ * Newer versions may only append to the payload; readers ignore the tail.
+ * Older blobs still load and keep the sections they lack (curves before
+ * version 2, expression budgets before version 3) as they are in cfg.
+ *
+ * The global, exp and switch sections double as standalone records so a
+ * single edited switch can be persisted without rewriting the whole blob.
+ */
+#define PEDAL_BLOB_VERSION      3
+#define PEDAL_BLOB_HEADER_SIZE  12
+#define PEDAL_REC_GLOBAL_SIZE   4
+#define PEDAL_REC_EXP_SIZE      7
+#define PEDAL_REC_SW_SIZE       17
+#define PEDAL_REC_CURVE_SIZE    (1 + 2 * PEDAL_CURVE_MAX_PTS)
+#define PEDAL_REC_RATE_SIZE     4
+#define PEDAL_BLOB_BANK_SIZE    (PEDAL_REC_EXP_SIZE + PEDAL_NUM_SWITCHES * PEDAL_REC_SW_SIZE)
+#define PEDAL_BLOB_V1_PAYLOAD   (PEDAL_REC_GLOBAL_SIZE + PEDAL_NUM_BANKS * PEDAL_BLOB_BANK_SIZE)
+#define PEDAL_BLOB_V2_PAYLOAD   (PEDAL_BLOB_V1_PAYLOAD + PEDAL_NUM_BANKS * PEDAL_REC_CURVE_SIZE)
+#define PEDAL_BLOB_PAYLOAD_SIZE (PEDAL_BLOB_V2_PAYLOAD + PEDAL_REC_RATE_SIZE)
+#define PEDAL_BLOB_SIZE         (PEDAL_BLOB_HEADER_SIZE + PEDAL_BLOB_PAYLOAD_SIZE)
+
+// Record ids, also the bit positions of a dirty-record mask (uint64_t)
+#define PEDAL_REC_GLOBAL        0
+#define PEDAL_REC_EXP(b)        (1 + (b))
+#define PEDAL_REC_SW(b, i)      (1 + PEDAL_NUM_BANKS + (b) * PEDAL_NUM_SWITCHES + (i))
+#define PEDAL_REC_CURVE(b)      (PEDAL_REC_SW(PEDAL_NUM_BANKS, 0) + (b))
+#define PEDAL_REC_RATE          PEDAL_REC_CURVE(PEDAL_NUM_BANKS)
+#define PEDAL_REC_COUNT         (PEDAL_REC_RATE + 1)
+#define PEDAL_REC_MAX_SIZE      PEDAL_REC_SW_SIZE
+
+uint32_t pedal_crc32(uint32_t crc, const uint8_t *data, size_t len);
+
+// Returns the number of bytes written (PEDAL_BLOB_SIZE), or 0 if cap is too small.
+size_t pedal_blob_pack(const pedal_config_t *cfg, uint8_t *buf, size_t cap);
+
+// Returns 0 on success, -1 on bad magic/version/length/CRC (cfg untouched).
+int pedal_blob_unpack(pedal_config_t *cfg, const uint8_t *buf, size_t len);
+
+size_t pedal_record_size(int rec);
+
+// Returns the record size written to buf (at least PEDAL_REC_MAX_SIZE bytes), 0 for a bad id.
+size_t pedal_record_pack(const pedal_config_t *cfg, int rec, uint8_t *buf);
+
+// Returns 0 on success, -1 for a bad id or length.
+int pedal_record_unpack(pedal_config_t *cfg, int rec, const uint8_t *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
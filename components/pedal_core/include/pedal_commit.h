@@ -0,0 +1,76 @@
+#ifndef PEDAL_COMMIT_H
+#define PEDAL_COMMIT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pedal_blob.h"
+#include "pedal_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Coalescing queue between config edits and the flash writer.
+ *
+ * Edits are packed when they are staged, so the writer never reads the live
+ * config. Staging the same record again only replaces its bytes, and a full
+ * blob drops every record staged before it, so a burst of saves ends up as
+ * one write of the newest data. Every staging returns a generation; once
+ * pedal_commit_queue_t.saved has caught up with it, that edit is on flash.
+ * The queue does no locking of its own.
+ */
+#define PEDAL_COMMIT_SETTLE_MS    250    // quiet time before writing
+#define PEDAL_COMMIT_MAX_WAIT_MS  2000   // a steady stream of edits still lands this often
+
+// One write: the blob (if full), then the records in dirty as overrides.
+typedef struct {
+    bool full;
+    uint64_t dirty;
+    uint32_t gen;                        // newest generation included
+    uint16_t blob_len;
+    uint8_t blob[PEDAL_BLOB_SIZE];
+    uint8_t rec_len[PEDAL_REC_COUNT];
+    uint8_t rec[PEDAL_REC_COUNT][PEDAL_REC_MAX_SIZE];
+} pedal_commit_batch_t;
+
+typedef struct {
+    pedal_commit_batch_t pending;
+    uint32_t gen;                        // last generation handed out
+    uint32_t saved;                      // everything up to here is on flash
+    uint32_t first_ms;                   // first and last staging of the pending batch
+    uint32_t last_ms;
+    uint32_t requests;
+    uint32_t writes;
+} pedal_commit_queue_t;
+
+void pedal_commit_init(pedal_commit_queue_t *q);
+
+// Stages the whole config, or only the records in dirty. Returns the generation.
+uint32_t pedal_commit_stage(pedal_commit_queue_t *q, const pedal_config_t *cfg, bool full, uint64_t dirty,
+                            uint32_t now_ms);
+
+// ms until the pending batch is due: 0 now, -1 when nothing is pending.
+int32_t pedal_commit_due(const pedal_commit_queue_t *q, uint32_t now_ms);
+
+// Moves the pending batch to out. Returns false when nothing is pending.
+bool pedal_commit_take(pedal_commit_queue_t *q, pedal_commit_batch_t *out);
+
+/**
+ * Reports the outcome of a taken batch. On failure whatever in it was not
+ * staged again since goes back to the queue, to be retried after the
+ * settle time.
+ */
+void pedal_commit_done(pedal_commit_queue_t *q, const pedal_commit_batch_t *b, bool ok, uint32_t now_ms);
+
+// Wrap-safe "generation a is at or after b"
+static inline bool pedal_commit_reached(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) >= 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef PEDAL_CONFIG_H
+#define PEDAL_CONFIG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PEDAL_NUM_BANKS     4
+#define PEDAL_NUM_SWITCHES  8
+
+// Action types as used by the web UI (genMainTypes / genSecTypes)
+#define PEDAL_TYPE_NONE      0
+#define PEDAL_TYPE_NOTE_OFF  128
+#define PEDAL_TYPE_NOTE_ON   144
+#define PEDAL_TYPE_CC        176
+#define PEDAL_TYPE_PC        192
+#define PEDAL_TYPE_BANK_REV  250
+#define PEDAL_TYPE_BANK_FWD  251
+#define PEDAL_TYPE_BANK_1    252   // 252..255 select bank 1..4 directly
+
+// Trigger slots: p / lp / l in the settings document
+typedef enum {
+    PEDAL_TRIG_PRESS = 0,
+    PEDAL_TRIG_LONG,
+    PEDAL_TRIG_RELEASE,
+    PEDAL_TRIG_COUNT
+} pedal_trig_t;
+
+#define PEDAL_SW_TOGGLE       (1 << 0)   // "tog"
+#define PEDAL_SW_EDGE_RELEASE (1 << 1)   // "edge": 1 = short press fires on release
+#define PEDAL_SW_LONG_EN      (1 << 2)   // "lp_en"
+
+typedef struct {
+    uint8_t type;   // PEDAL_TYPE_*
+    uint8_t ch;     // 0-based MIDI channel
+    uint8_t val;    // note / controller / program number
+} pedal_action_t;
+
+typedef struct {
+    pedal_action_t act[PEDAL_TRIG_COUNT];
+    uint8_t excl[PEDAL_TRIG_COUNT];   // pe / lpe / le: exclusive group masks
+    uint8_t lead[PEDAL_TRIG_COUNT];   // pm / lpm / lm: lead (master) group masks
+    uint8_t incl;                     // groups this switch follows as a slave
+    uint8_t flags;                    // PEDAL_SW_*
+} pedal_switch_t;
+
+// Expression response curves ("crv")
+#define PEDAL_CURVE_LINEAR   0
+#define PEDAL_CURVE_EXP      1     // slow start / swell
+#define PEDAL_CURVE_LOG      2     // fast start
+#define PEDAL_CURVE_CUSTOM   3     // monotone spline through pts
+#define PEDAL_CURVE_MAX_PTS  8
+
+typedef struct {
+    uint8_t ch;
+    uint8_t cc;
+    uint8_t crv;    // PEDAL_CURVE_*
+    uint16_t min;
+    uint16_t max;
+    uint8_t npts;                          // 2..PEDAL_CURVE_MAX_PTS
+    uint8_t pts[PEDAL_CURVE_MAX_PTS][2];   // travel, output (0..255), travel ascending
+} pedal_exp_t;
+
+typedef struct {
+    pedal_switch_t sw[PEDAL_NUM_SWITCHES];
+    pedal_exp_t exp;
+} pedal_bank_t;
+
+// Expression update budget per transport, updates per second
+#define PEDAL_EXP_HZ_MIN       1
+#define PEDAL_EXP_HZ_MAX       1000
+
+static inline uint16_t pedal_exp_hz_clamp(long hz)
+{
+    return hz < PEDAL_EXP_HZ_MIN ? PEDAL_EXP_HZ_MIN : hz > PEDAL_EXP_HZ_MAX ? PEDAL_EXP_HZ_MAX : (uint16_t)hz;
+}
+
+typedef struct {
+    pedal_bank_t banks[PEDAL_NUM_BANKS];
+    uint8_t brightness;
+    bool ds_en;
+    uint16_t ds_min;
+    uint16_t exp_usb_hz;
+    uint16_t exp_ble_hz;
+} pedal_config_t;
+
+void pedal_config_defaults(pedal_config_t *cfg);
+
+/**
+ * Parse the settings document served by /api/settings and posted to /api/save.
+ * Unknown keys are skipped, missing keys keep the values already in cfg.
+ * Returns 0 on success, -1 on malformed input.
+ */
+int pedal_config_from_json(pedal_config_t *cfg, const char *json, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef PEDAL_CURVE_H
+#define PEDAL_CURVE_H
+
+#include <stdint.h>
+#include "pedal_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Expression curves. A bank's calibration (min/max) and curve are compiled
+ * into a lookup table indexed by the filtered pedal value (Q4 counts, see
+ * pedal_exp_filter.h), so a conversion is a shift and one load. Outputs are
+ * 14-bit; 7-bit CC values are the top seven bits.
+ */
+#define PEDAL_CURVE_LUT_BITS   11                     // 4 KB per bank
+#define PEDAL_CURVE_LUT_SIZE   (1 << PEDAL_CURVE_LUT_BITS)
+#define PEDAL_CURVE_LUT_SHIFT  (16 - PEDAL_CURVE_LUT_BITS)
+#define PEDAL_CURVE_OUT_MAX    16383
+
+// A curve prepared for direct evaluation (calibration and spline slopes)
+typedef struct {
+    uint8_t crv;
+    uint8_t n;
+    float lo, span;                        // ADC counts
+    float x[PEDAL_CURVE_MAX_PTS], y[PEDAL_CURVE_MAX_PTS], m[PEDAL_CURVE_MAX_PTS];
+} pedal_curve_t;
+
+void pedal_curve_prepare(pedal_curve_t *c, const pedal_exp_t *e);
+
+// 14-bit output for a reading in ADC counts, in floating point
+uint16_t pedal_curve_eval(const pedal_curve_t *c, float counts);
+
+void pedal_curve_compile(uint16_t lut[PEDAL_CURVE_LUT_SIZE], const pedal_exp_t *e);
+
+static inline uint16_t pedal_curve_map(const uint16_t *lut, uint16_t q4)
+{
+    return lut[q4 >> PEDAL_CURVE_LUT_SHIFT];
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
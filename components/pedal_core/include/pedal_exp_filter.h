@@ -0,0 +1,115 @@
+#ifndef PEDAL_EXP_FILTER_H
+#define PEDAL_EXP_FILTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PEDAL_CIC_SHIFT      5                       // decimate by 32
+#define PEDAL_CIC_R          (1 << PEDAL_CIC_SHIFT)
+#define PEDAL_EXP_FRAC_BITS  4                       // filtered values are 12-bit ADC counts in Q4
+#define PEDAL_EXP_FULL       (4095 << PEDAL_EXP_FRAC_BITS)
+#define PEDAL_EXP_HOLD       8                       // output deadband, Q4 (half an ADC count)
+
+// One-euro tuning for the CIC output of a 32 kHz conversion stream
+#define PEDAL_EXP_RATE_HZ          1000
+#define PEDAL_EXP_MIN_CUTOFF_MHZ   1000
+#define PEDAL_EXP_BETA_Q8          24
+#define PEDAL_EXP_D_CUTOFF_MHZ     1000
+
+/*
+ * Second-order CIC decimator for 12-bit ADC samples. Integrators run at
+ * the sample rate and are allowed to wrap; the combs run once per output,
+ * so a DMA frame costs two adds per sample plus four per output. The gain
+ * R^2 is divided back out leaving PEDAL_EXP_FRAC_BITS of the extra
+ * resolution the averaging bought.
+ */
+typedef struct {
+    uint32_t i1, i2;
+    uint32_t c1, c2;
+    uint32_t phase;
+} pedal_cic_t;
+
+void pedal_cic_init(pedal_cic_t *c);
+
+// Filters n samples into out (room for n / PEDAL_CIC_R + 1); returns how many outputs were written.
+size_t pedal_cic_frame(pedal_cic_t *c, const uint16_t *in, size_t n, uint16_t *out);
+
+/*
+ * One-euro filter (Casiez et al.) in fixed point: a low-pass whose cutoff
+ * rises with the pedal's speed, so a resting pedal is smoothed hard and a
+ * sweep follows with little lag. Values in and out are Q4 counts; the
+ * output only moves once the estimate is PEDAL_EXP_HOLD away from it, which
+ * after this much smoothing is enough to keep a parked pedal on one value
+ * even across a CC boundary.
+ */
+typedef struct {
+    uint32_t rate_hz;
+    uint32_t min_cutoff_mhz;
+    uint32_t max_cutoff_mhz;
+    uint32_t beta_q8;                    // extra cutoff, mHz per Q4 count/s of speed, Q8
+    uint32_t d_alpha_q16;                // speed smoothing
+    int32_t x;                           // Q4 << 8
+    int32_t dx;                          // Q4 << 8 per sample
+    uint16_t out;
+    bool primed;
+} pedal_euro_t;
+
+void pedal_euro_init(pedal_euro_t *e, uint32_t rate_hz, uint32_t min_cutoff_mhz, uint32_t beta_q8,
+                     uint32_t d_cutoff_mhz);
+
+uint16_t pedal_euro_step(pedal_euro_t *e, uint16_t x);
+
+// Low-pass coefficient for a cutoff at the given rate, Q16
+uint32_t pedal_euro_alpha(uint32_t cutoff_mhz, uint32_t rate_hz);
+
+// Jack check on the CIC output (PEDAL_EXP_RATE_HZ, one step per ms)
+#define PEDAL_JACK_SWING     (64 << PEDAL_EXP_FRAC_BITS)     // a move back by this much is a turn
+#define PEDAL_JACK_TURNS     3                               // this many turns ...
+#define PEDAL_JACK_TURN_MS   50                              // ... this close together: floating
+#define PEDAL_JACK_RAIL      (16 << PEDAL_EXP_FRAC_BITS)     // below this the tip sits on the pulldown
+#define PEDAL_JACK_OPEN_MS   300
+#define PEDAL_JACK_CLEAN_MS  100                             // quiet time before a floating input counts again
+
+enum {
+    PEDAL_JACK_OK,
+    PEDAL_JACK_OPEN,        // held on the pulldown: nothing plugged in
+    PEDAL_JACK_FLOATING,    // noise or hum: tip not connected to a pot
+};
+
+/*
+ * Tells an expression pedal from an empty or floating jack. A foot turns
+ * the pedal around a few times a second at most; a floating tip picks up
+ * mains hum and noise and swings back and forth many times faster.
+ * PEDAL_JACK_TURNS reversals of at least PEDAL_JACK_SWING within
+ * PEDAL_JACK_TURN_MS count as floating at once, and only a quiet
+ * PEDAL_JACK_CLEAN_MS later as OK again. An unplugged jack reads the
+ * pulldown; a pedal parked on its heel can read the same, which is
+ * harmless because its last value went out long before PEDAL_JACK_OPEN_MS.
+ */
+typedef struct {
+    uint32_t ms;
+    uint16_t extreme;                    // highest (rising) or lowest value since the last turn
+    bool rising;
+    bool primed;
+    uint32_t turn_ms[PEDAL_JACK_TURNS];  // ring of the latest turns
+    uint8_t turn;
+    uint32_t floating_ms;                // last time the turns were too close
+    uint16_t rail_ms;
+    uint8_t state;
+} pedal_jack_t;
+
+void pedal_jack_init(pedal_jack_t *j);
+
+// One CIC output (Q4 counts); returns PEDAL_JACK_*.
+uint8_t pedal_jack_step(pedal_jack_t *j, uint16_t x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
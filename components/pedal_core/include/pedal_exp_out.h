@@ -0,0 +1,58 @@
+#ifndef PEDAL_EXP_OUT_H
+#define PEDAL_EXP_OUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pedal_table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PEDAL_EXP_OUT_INTERVAL_MS  10      // high-resolution updates: at most 100/s
+#define PEDAL_EXP_OUT_NONE         0xFFFF  // previous value before the first
+
+/*
+ * When the expression value goes out. Called every logic tick with the
+ * bank's 14-bit curve output (pedal_table_exp); reports a value that
+ * changed at the stream's resolution, at most once per interval, so a
+ * sweep is sent as a few high-resolution steps and the resting value
+ * always follows once the interval has passed.
+ */
+typedef struct {
+    uint32_t interval_ms;
+    uint8_t shift;                       // 14 - resolution in bits
+    bool primed;
+    uint16_t sent;
+    uint32_t sent_ms;
+} pedal_exp_out_t;
+
+void pedal_exp_out_init(pedal_exp_out_t *o, uint8_t bits, uint32_t interval_ms);
+
+// true when v should be sent now; it then counts as sent and *prev gets the
+// value sent before (PEDAL_EXP_OUT_NONE for the first).
+bool pedal_exp_out_due(pedal_exp_out_t *o, uint16_t v, uint32_t now_ms, uint16_t *prev);
+
+/**
+ * MIDI 1.0 messages for a 14-bit value: for controllers 0-31 an MSB/LSB
+ * pair (MSB on cc, LSB on cc + 32; the MSB is left out while it equals
+ * that of prev), for other controllers a single 7-bit CC. Returns the
+ * number of messages written to out.
+ */
+int pedal_exp_cc14(uint8_t ch, uint8_t cc, uint16_t v, uint16_t prev, pedal_midi_msg_t out[2]);
+
+// Expression values that actually went out per second, for /api/status
+typedef struct {
+    uint32_t start_ms;
+    uint32_t count;
+    uint16_t hz;                         // over the last completed window
+} pedal_rate_t;
+
+// Counts n values sent at now_ms (n may be 0); call at least once a second.
+void pedal_rate_add(pedal_rate_t *r, uint32_t now_ms, uint32_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
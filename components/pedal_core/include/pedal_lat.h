@@ -0,0 +1,63 @@
+#ifndef PEDAL_LAT_H
+#define PEDAL_LAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PEDAL_LAT_BUCKETS  64
+
+// Carried with a message from the footswitch edge to the transport
+typedef struct {
+    uint32_t origin_us;                  // edge sampled; 0: not caused by an edge
+    uint32_t queued_us;                  // logic handed it to the transport
+} pedal_lat_stamp_t;
+
+/*
+ * Fixed-bucket latency histogram in microseconds: exact below 8 us, then
+ * four buckets per power of two (at most 25% wide) up to 131 ms, the last
+ * bucket also taking everything above. One writer; readers may see a
+ * sample half-added, which only skews a statistic by one.
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t hist[PEDAL_LAT_BUCKETS];
+} pedal_lat_t;
+
+static inline int pedal_lat_bucket(uint32_t us)
+{
+    if (us < 8) return us;
+    int e = 31 - __builtin_clz(us);
+    int b = 8 + (e - 3) * 4 + ((us >> (e - 2)) & 3);
+    return b < PEDAL_LAT_BUCKETS ? b : PEDAL_LAT_BUCKETS - 1;
+}
+
+// Smallest value of bucket b
+uint32_t pedal_lat_bucket_floor(int b);
+
+void pedal_lat_reset(pedal_lat_t *h);
+
+static inline void pedal_lat_add(pedal_lat_t *h, uint32_t us)
+{
+    if (!h->count || us < h->min_us) h->min_us = us;
+    if (us > h->max_us) h->max_us = us;
+    h->hist[pedal_lat_bucket(us)]++;
+    h->count++;
+}
+
+// Upper bound of the bucket holding the pct-th percentile, clamped to [min, max]; 0 when empty.
+uint32_t pedal_lat_percentile(const pedal_lat_t *h, unsigned pct);
+
+// {"n":..,"min":..,"p50":..,"p99":..,"max":..}; 0 if it does not fit.
+size_t pedal_lat_json(const pedal_lat_t *h, char *buf, size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
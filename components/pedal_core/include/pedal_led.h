@@ -0,0 +1,76 @@
+#ifndef PEDAL_LED_H
+#define PEDAL_LED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pedal_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// LED 1 shows the battery, LEDs 2-9 the switches in snake wiring order
+#define PEDAL_LED_COUNT   (1 + PEDAL_NUM_SWITCHES)
+#define PEDAL_LED_FRAME   (PEDAL_LED_COUNT * 3)      // GRB bytes as sent
+
+enum {
+    PEDAL_LED_BAT_UNKNOWN,                // no reading yet: LED 1 dark
+    PEDAL_LED_BAT_LOW,                    // < 3.6 V, blinks red
+    PEDAL_LED_BAT_OK,                     // < 3.9 V
+    PEDAL_LED_BAT_GOOD,
+};
+
+enum {
+    PEDAL_LED_ANIM_NONE,
+    PEDAL_LED_ANIM_BANK,                  // boot and bank change: three flashes in the bank's color
+    PEDAL_LED_ANIM_IDENTITY,              // new BLE identity: three purple flashes on every LED
+};
+
+typedef struct {
+    uint8_t bank;
+    uint8_t on;                           // bit n: switch n ON or held
+    uint8_t battery;                      // PEDAL_LED_BAT_*
+} pedal_led_state_t;
+
+/*
+ * LED frames from the pedal state. Each render composes the whole frame,
+ * bank colors with ON switches full and OFF ones dimmed, plus the battery
+ * LED and any running animation, through a brightness lookup table
+ * (squared for perceived brightness, scaled by the config's brightness),
+ * and reports it only when it differs from the last frame reported, so
+ * the caller sends nothing for an unchanged state. Animations and the
+ * low-battery blink are a function of time; the render says when the
+ * frame changes next on its own.
+ */
+typedef struct {
+    uint8_t brightness;
+    uint8_t lut[256];
+    uint8_t anim;
+    uint32_t anim_ms;
+    bool valid;                           // frame holds the last reported frame
+    uint8_t frame[PEDAL_LED_FRAME];
+} pedal_led_t;
+
+void pedal_led_init(pedal_led_t *l, uint8_t brightness);
+
+// Rebuilds the lookup table when brightness changed
+void pedal_led_brightness(pedal_led_t *l, uint8_t brightness);
+
+// Starts anim (PEDAL_LED_ANIM_*) at now_ms, replacing a running one
+void pedal_led_animate(pedal_led_t *l, uint8_t anim, uint32_t now_ms);
+
+/**
+ * Frame for s at now_ms. Returns true, with the frame in l->frame, when it
+ * differs from the last one returned. *next_ms is when the frame changes
+ * without a new state (animation step, blink), or 0 if it does not.
+ */
+bool pedal_led_render(pedal_led_t *l, const pedal_led_state_t *s, uint32_t now_ms, uint32_t *next_ms);
+
+// Battery level from the cell voltage, with 50 mV of hysteresis against prev
+uint8_t pedal_led_battery(uint8_t prev, uint32_t mv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef PEDAL_LOGIC_H
+#define PEDAL_LOGIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pedal_config.h"
+#include "pedal_table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PEDAL_LONG_PRESS_MS 500
+
+typedef void (*pedal_midi_sink_t)(void *ctx, const pedal_midi_msg_t *msg);
+
+/**
+ * Switch/group logic engine. Fed with debounced edges and a periodic tick
+ * from the scan loop; emits MIDI through the sink and tracks the per-bank
+ * on/off state that drives the LEDs. Runs entirely off a compiled
+ * pedal_table_t; recompile the table (not the engine) when the config changes.
+ */
+typedef struct {
+    const pedal_table_t *tbl;
+    pedal_midi_sink_t sink;
+    void *sink_ctx;
+    uint8_t bank;
+    uint8_t state[PEDAL_NUM_BANKS];   // bit n: switch n is ON
+    uint8_t held;                     // bit n: switch n is physically down
+    uint8_t armed;                    // bit n: momentary ON since press edge
+    uint8_t long_fired;               // bit n: long press already sent
+    uint32_t press_ms[PEDAL_NUM_SWITCHES];
+    uint8_t press_bank[PEDAL_NUM_SWITCHES];
+} pedal_logic_t;
+
+void pedal_logic_init(pedal_logic_t *lg, const pedal_table_t *tbl, pedal_midi_sink_t sink, void *sink_ctx);
+
+// Debounced edge for switch 0..7
+void pedal_logic_edge(pedal_logic_t *lg, uint8_t sw, bool down, uint32_t now_ms);
+
+// Long-press detection; call from every scan loop iteration
+void pedal_logic_tick(pedal_logic_t *lg, uint32_t now_ms);
+
+void pedal_logic_set_bank(pedal_logic_t *lg, uint8_t bank);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef PEDAL_MIDI_OUT_H
+#define PEDAL_MIDI_OUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "pedal_exp_out.h"
+#include "pedal_lat.h"
+#include "pedal_table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PEDAL_MIDI_QUEUE_LEN    64      // power of two
+#define PEDAL_BLE_MTU_DEFAULT   23      // until the central negotiates more
+#define PEDAL_BLE_ATT_OVERHEAD  3       // notification opcode + handle
+
+// Messages waiting for one transport, stamped with when they were produced
+typedef struct {
+    uint32_t ms;
+    pedal_midi_msg_t msg;
+    pedal_lat_stamp_t stamp;
+} pedal_midi_event_t;
+
+typedef struct {
+    pedal_midi_event_t ev[PEDAL_MIDI_QUEUE_LEN];
+    uint16_t head;
+    uint16_t tail;
+    uint32_t dropped;
+} pedal_midi_queue_t;
+
+// false (and counted in dropped) when the queue is full; stamp may be NULL
+bool pedal_midi_queue_push(pedal_midi_queue_t *q, const pedal_midi_msg_t *msg, uint32_t now_ms,
+                           const pedal_lat_stamp_t *stamp);
+
+static inline bool pedal_midi_queue_empty(const pedal_midi_queue_t *q)
+{
+    return q->head == q->tail;
+}
+
+/**
+ * BLE-MIDI transport. At most one notification per connection interval:
+ * everything queued by then goes out together, packed as
+ *
+ *   header  1 0 t12..t7            timestamp high bits of the first message
+ *   message 1 t6..t0 status data   timestamp low bits, full message
+ *           data                   same status and timestamp: running status
+ *
+ * up to the negotiated ATT MTU. A packet never spans more than 127 ms, so
+ * a receiver can always rebuild the timestamps.
+ *
+ * The expression pedal does not queue: pedal_ble_out_exp() replaces the
+ * value waiting in a single slot, which goes out only after every queued
+ * message and only whole, so footswitch messages never wait behind a
+ * sweep and the latest value is the one that is sent.
+ */
+typedef struct {
+    pedal_midi_queue_t q;
+    uint16_t mtu;
+    uint32_t interval_us;
+    uint32_t next_us;                    // earliest time for the next notification
+    uint32_t packets;
+    uint32_t msgs;
+    uint32_t bytes;
+    uint8_t max_msgs;                    // most messages seen in one packet
+    // expression slot
+    bool exp_pending;
+    uint8_t exp_ch, exp_cc;
+    uint16_t exp_val;
+    uint32_t exp_ms;
+    uint16_t exp_sent;                   // PEDAL_EXP_OUT_NONE: send the MSB too
+    uint32_t exp_updates;                // values sent
+    uint32_t exp_coalesced;              // values replaced before they went out
+} pedal_ble_out_t;
+
+void pedal_ble_out_init(pedal_ble_out_t *b, uint16_t mtu, uint32_t interval_us);
+
+// Call after every scan iteration. now_us only paces notifications; the
+// BLE timestamps come from the queued messages. Returns the notification
+// length, 0 if nothing is due.
+// Latest 14-bit expression value (MSB/LSB pair, see pedal_exp_cc14)
+void pedal_ble_out_exp(pedal_ble_out_t *b, uint8_t ch, uint8_t cc, uint16_t v, uint32_t now_ms);
+
+size_t pedal_ble_out_poll(pedal_ble_out_t *b, uint32_t now_us, uint8_t *pkt, size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
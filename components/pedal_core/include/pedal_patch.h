@@ -0,0 +1,62 @@
+#ifndef PEDAL_PATCH_H
+#define PEDAL_PATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "pedal_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Field-level edits posted to /api/patch: a batch of 5-byte operations
+ *
+ *   0  u8   bank   0..3, or PEDAL_PATCH_GLOBAL
+ *   1  u8   switch 0..7, or PEDAL_PATCH_EXP for the bank's expression settings
+ *   2  u8   field  (PEDAL_F_*, PEDAL_F_EXP_* or PEDAL_F_GLOB_*)
+ *   3  u16  value  little-endian
+ *
+ * A batch is applied all-or-nothing: every op is validated first.
+ */
+#define PEDAL_PATCH_OP_SIZE  5
+#define PEDAL_PATCH_GLOBAL   0xFF
+#define PEDAL_PATCH_EXP      0xFF
+
+// Switch fields. Actions are PEDAL_F_ACT(trig) + 0 type / 1 channel / 2 value.
+#define PEDAL_F_ACT(trig)    ((trig) * 3)
+#define PEDAL_F_EXCL(trig)   (9 + (trig))     // pe / lpe / le
+#define PEDAL_F_LEAD(trig)   (12 + (trig))    // pm / lpm / lm
+#define PEDAL_F_INCL         15
+#define PEDAL_F_TOG          16
+#define PEDAL_F_EDGE         17
+#define PEDAL_F_LP_EN        18
+
+// Expression fields
+#define PEDAL_F_EXP_CH       0
+#define PEDAL_F_EXP_CC       1
+#define PEDAL_F_EXP_CRV      2
+#define PEDAL_F_EXP_MIN      3
+#define PEDAL_F_EXP_MAX      4
+#define PEDAL_F_EXP_NPTS     5                // custom curve point count, 2..8
+#define PEDAL_F_EXP_PT(n)    (6 + (n))        // point n: travel | output << 8
+
+// Global fields
+#define PEDAL_F_GLOB_BRIGHTNESS 0
+#define PEDAL_F_GLOB_DS_EN      1
+#define PEDAL_F_GLOB_DS_MIN     2
+#define PEDAL_F_GLOB_EXP_USB_HZ 3                // PEDAL_EXP_HZ_MIN..MAX
+#define PEDAL_F_GLOB_EXP_BLE_HZ 4
+
+/**
+ * Apply a batch of ops to cfg. On success ORs the touched records
+ * (bit PEDAL_REC_* from pedal_blob.h) into *dirty and returns the number of
+ * ops; returns -1 without touching cfg if any op is malformed.
+ */
+int pedal_patch_apply(pedal_config_t *cfg, const uint8_t *ops, size_t len, uint64_t *dirty);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef PEDAL_POWER_H
+#define PEDAL_POWER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Expression movement (Q4 counts, 4 LSB of the 12-bit ADC) that counts as use
+#define PEDAL_IDLE_EXP_DEADBAND    64
+
+/*
+ * When the scan loop may stop the matrix scan and let the chip sleep. The
+ * loop steps it every iteration; it reports idle once no switch was down,
+ * no edge came in and the expression pedal stayed inside the deadband for
+ * idle_ms. A press then has to wake the chip through a column.
+ */
+typedef struct {
+    uint32_t idle_ms;                    // 0: never idle
+    uint32_t since_ms;                   // last activity
+    uint16_t exp;                        // pedal position at the last activity
+} pedal_idle_t;
+
+void pedal_idle_init(pedal_idle_t *d, uint32_t idle_ms, uint32_t now_ms, uint16_t exp);
+
+// held: switches down (bit n: switch n), edges: the iteration handled any
+bool pedal_idle_step(pedal_idle_t *d, uint32_t now_ms, uint8_t held, bool edges, uint16_t exp);
+
+static inline bool pedal_idle_moved(uint16_t from, uint16_t to)
+{
+    return (from > to ? from - to : to - from) > PEDAL_IDLE_EXP_DEADBAND;
+}
+
+/*
+ * Battery drain estimate. Fed with how long the chip was awake or in
+ * light sleep and which loads were on, it averages the current drawn.
+ * The figures are ESP32-S3 datasheet ballparks at 3.3 V: good for
+ * comparing settings and usage patterns, not a substitute for a meter.
+ */
+#define PEDAL_POWER_AWAKE_UA       21000   // scanning: CPU at 80 MHz between interrupts, ADC streaming
+#define PEDAL_POWER_ASLEEP_UA      800     // light sleep, XTAL kept up for BLE, ADC polled
+#define PEDAL_POWER_BLE_UA         2500    // a central connected at 7.5-15 ms, 0 dBm
+#define PEDAL_POWER_WIFI_UA        95000   // soft AP: the receiver never sleeps
+#define PEDAL_POWER_USB_UA         3000    // PHY up while the host polls
+
+enum {
+    PEDAL_POWER_BLE,
+    PEDAL_POWER_WIFI,
+    PEDAL_POWER_USB,
+    PEDAL_POWER_LOADS,
+};
+
+typedef struct {
+    uint64_t ms;
+    uint64_t asleep_ms;
+    uint64_t load_ms[PEDAL_POWER_LOADS];
+} pedal_power_t;
+
+void pedal_power_init(pedal_power_t *p);
+
+// ms of wall time, asleep_ms of them in light sleep; loads bit n: PEDAL_POWER_n on
+void pedal_power_add(pedal_power_t *p, uint32_t ms, uint32_t asleep_ms, uint8_t loads);
+
+// Average over everything added, uA
+uint32_t pedal_power_ua(const pedal_power_t *p);
+
+// Percent of the time asleep / with load n on
+uint32_t pedal_power_asleep_pct(const pedal_power_t *p);
+uint32_t pedal_power_load_pct(const pedal_power_t *p, int load);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
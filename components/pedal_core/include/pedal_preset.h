@@ -0,0 +1,106 @@
+#ifndef PEDAL_PRESET_H
+#define PEDAL_PRESET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "pedal_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Preset store: a log-structured ring of flash sectors holding presets as
+ * deltas against one base config.
+ *
+ *   sector   0  u32  magic "MBXP"
+ *            4  u32  sector sequence (the highest one is the write head)
+ *            8  entries, 4-byte aligned, until an erased (0xFF) header
+ *   entry    0  u8   type (PEDAL_PRESET_E_*)
+ *            1  u8   preset id
+ *            2  u16  payload length
+ *            4  u32  sequence (latest wins; relocation keeps it)
+ *            8  u32  CRC-32 of bytes 0..7 and the payload
+ *           12  u32  commit word, programmed only after the payload
+ *           16  payload
+ *
+ * Base payload: a packed config blob (pedal_blob.h).
+ * Preset payload: u8 name length, name, then for every record that differs
+ * from the base: u8 record id, u24 mask of changed bytes, the changed bytes.
+ *
+ * Saving never touches the previous copy of a preset: it stays valid until
+ * the new entry's commit word lands, so a reset mid-save recalls one or the
+ * other. Writes go round the ring; when the head fills, the oldest sector's
+ * live entries move to a fresh sector and it is erased, so every sector
+ * sees the same number of erases.
+ */
+#define PEDAL_PRESET_MAX        128
+#define PEDAL_PRESET_NAME_MAX   20
+#define PEDAL_PRESET_SECTOR     4096
+#define PEDAL_PRESET_MIN_SECTORS 4
+#define PEDAL_PRESET_HDR_SIZE   16
+#define PEDAL_PRESET_ENTRY_MAX  1024
+#define PEDAL_PRESET_NONE       0xFFFFFFFFu
+
+#define PEDAL_PRESET_E_BASE     1
+#define PEDAL_PRESET_E_PRESET   2
+#define PEDAL_PRESET_E_DELETE   3
+
+#define PEDAL_PRESET_OK         0
+#define PEDAL_PRESET_ERR_ID     (-1)   // bad id, or no preset stored there
+#define PEDAL_PRESET_ERR_FULL   (-2)
+#define PEDAL_PRESET_ERR_IO     (-3)   // flash op failed or stored entry corrupt
+
+/**
+ * Flash backend: a region of size bytes (whole sectors) addressed from 0.
+ * Each op returns 0 on success. write only clears bits, erase sets a whole
+ * PEDAL_PRESET_SECTOR-aligned sector to 0xFF.
+ */
+typedef struct {
+    int (*read)(void *ctx, uint32_t addr, void *buf, size_t len);
+    int (*write)(void *ctx, uint32_t addr, const void *buf, size_t len);
+    int (*erase)(void *ctx, uint32_t addr);
+    void *ctx;
+    uint32_t size;
+} pedal_flash_t;
+
+typedef struct {
+    uint32_t addr;                        // PEDAL_PRESET_NONE: empty slot
+    uint32_t seq;
+    uint16_t size;                        // whole entry, header included
+    char name[PEDAL_PRESET_NAME_MAX + 1];
+} pedal_preset_slot_t;
+
+// In-RAM index, rebuilt by one scan at mount; lists and recalls never scan.
+typedef struct {
+    const pedal_flash_t *fl;
+    uint32_t sectors;
+    uint32_t head;                        // sector being written
+    uint32_t head_off;                    // next free byte in it
+    uint32_t head_seq;
+    uint32_t seq;                         // next entry sequence
+    uint32_t live;                        // bytes of entries still referenced
+    pedal_preset_slot_t base_slot;
+    pedal_preset_slot_t slot[PEDAL_PRESET_MAX];
+    pedal_config_t base;
+    uint8_t buf[PEDAL_PRESET_ENTRY_MAX];
+} pedal_preset_store_t;
+
+// Scans the region and builds the index; formats it if it holds no store.
+int pedal_preset_mount(pedal_preset_store_t *st, const pedal_flash_t *fl);
+
+// The first save also fixes the base config every later preset is diffed against.
+int pedal_preset_save(pedal_preset_store_t *st, int id, const char *name, const pedal_config_t *cfg);
+
+int pedal_preset_load(pedal_preset_store_t *st, int id, pedal_config_t *cfg);
+
+int pedal_preset_delete(pedal_preset_store_t *st, int id);
+
+// NULL for an empty slot
+const char *pedal_preset_name(const pedal_preset_store_t *st, int id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef PEDAL_SCAN_H
+#define PEDAL_SCAN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PEDAL_SCAN_ROWS            2
+#define PEDAL_SCAN_COLS            4
+#define PEDAL_SCAN_EDGES           32      // queued edges, power of two
+#define PEDAL_SCAN_JITTER_BUCKETS  12
+
+// Switch sw (row * PEDAL_SCAN_COLS + col) went down or up at us
+typedef struct {
+    uint32_t us;
+    uint8_t sw;
+    bool down;
+} pedal_scan_edge_t;
+
+/*
+ * Deviation of each sample interval from the nominal period. Bucket 0
+ * counts exact hits, bucket b covers [2^(b-1), 2^b) us and the last one
+ * everything from 2^(BUCKETS-2) us up.
+ */
+typedef struct {
+    uint32_t hist[PEDAL_SCAN_JITTER_BUCKETS];
+    uint32_t samples;
+    uint32_t worst_us;
+} pedal_scan_jitter_t;
+
+/*
+ * Matrix scanner, fed one row at a time from a periodic timer interrupt.
+ * A switch reports its first changed sample at once and is then held for
+ * the debounce time, so bounce never adds latency. Edges go to the logic
+ * task through a single-producer single-consumer ring: the interrupt only
+ * writes head, the task only writes tail.
+ */
+typedef struct {
+    uint32_t period_us;                  // between two row samples
+    uint16_t lockout;                    // matrix scans a switch is held after an edge
+    // producer (interrupt)
+    uint8_t row;                         // row the next sample reads
+    uint8_t state;                       // debounced, bit n: switch n is down
+    uint16_t hold[PEDAL_SCAN_ROWS * PEDAL_SCAN_COLS];
+    uint32_t last_us;
+    bool resumed;                        // next sample starts a new interval
+    uint32_t dropped;                    // edges the full ring refused (retried next scan)
+    pedal_scan_jitter_t jitter;
+    // ring
+    pedal_scan_edge_t ev[PEDAL_SCAN_EDGES];
+    uint32_t head;
+    uint32_t tail;
+} pedal_scan_t;
+
+// rate_hz is full matrix scans per second; the timer runs PEDAL_SCAN_ROWS times faster.
+void pedal_scan_init(pedal_scan_t *s, uint32_t rate_hz, uint32_t debounce_ms);
+
+/**
+ * One sample of row s->row; bit c of cols is set when column c reads
+ * pressed. Advances s->row to the row to drive next, and returns true
+ * when an edge was queued.
+ */
+bool pedal_scan_row(pedal_scan_t *s, uint32_t now_us, uint8_t cols);
+
+// The timer was stopped and starts again: the gap is not jitter.
+void pedal_scan_resume(pedal_scan_t *s);
+
+// Oldest queued edge; consumer side.
+bool pedal_scan_pop(pedal_scan_t *s, pedal_scan_edge_t *e);
+
+static inline int pedal_scan_jitter_bucket(uint32_t dev_us)
+{
+    if (!dev_us) return 0;
+    int b = 32 - __builtin_clz(dev_us);
+    return b < PEDAL_SCAN_JITTER_BUCKETS ? b : PEDAL_SCAN_JITTER_BUCKETS - 1;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef PEDAL_SNAP_H
+#define PEDAL_SNAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Two immutable snapshots of whatever the real-time loop runs from (the
+ * compiled config), published by pointer swap.
+ *
+ * The reader (the scan loop) acquires the live snapshot at the top of an
+ * iteration and releases it at the end; in between it announces which one
+ * it holds, and re-checks that it is still live, so it never settles on a
+ * snapshot the writer might already be reusing. The writer builds the
+ * next snapshot in the spare buffer, which is only handed out while the
+ * reader does not hold it, and publishes it with one store. The reader
+ * never waits and nothing masks interrupts; the writer may have to wait
+ * for the reader to finish one iteration. Writers serialize among
+ * themselves.
+ */
+typedef struct {
+    void *buf[2];
+    void *live;                          // published snapshot
+    void *held;                          // reader's snapshot, NULL between iterations
+} pedal_snap_t;
+
+// first starts out live (fill it before the reader runs), second spare
+void pedal_snap_init(pedal_snap_t *s, void *first, void *second);
+
+// Reader
+const void *pedal_snap_acquire(pedal_snap_t *s);
+void pedal_snap_release(pedal_snap_t *s);
+
+// Writer: buffer for the next snapshot, or NULL while the reader holds it.
+void *pedal_snap_spare(pedal_snap_t *s);
+// Makes next (from pedal_snap_spare) the live snapshot.
+void pedal_snap_publish(pedal_snap_t *s, void *next);
+
+// Writer side view of the live snapshot; stays valid until the next publish.
+static inline const void *pedal_snap_live(const pedal_snap_t *s)
+{
+    return s->live;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef PEDAL_SPSC_H
+#define PEDAL_SPSC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Lock-free hand-off between the real-time core and core 0. Both kinds
+ * only manage indices; the records live in the caller's array, so one
+ * implementation serves any record type. Neither side ever waits for the
+ * other, and each field is written by one side only.
+ *
+ * pedal_spsc_t is a FIFO over len slots (a power of two): the producer
+ * fills pedal_spsc_slot() and publishes it with pedal_spsc_push(), the
+ * consumer reads pedal_spsc_front() and frees it with pedal_spsc_pop().
+ *
+ * pedal_latest_t passes only the newest value, over three slots: the
+ * producer overwrites its back slot and swaps it in; the consumer swaps
+ * out whatever was published last. For state that is replaced rather
+ * than queued (link parameters, live status), it never fills up.
+ */
+typedef struct {
+    uint32_t head;                       // producer
+    uint32_t tail;                       // consumer
+    uint32_t len;
+} pedal_spsc_t;
+
+void pedal_spsc_init(pedal_spsc_t *r, uint32_t len);
+
+// Producer: index of the slot to fill, or -1 while the ring is full.
+int pedal_spsc_slot(const pedal_spsc_t *r);
+// Publishes the slot returned by pedal_spsc_slot().
+void pedal_spsc_push(pedal_spsc_t *r);
+
+// Consumer: index of the oldest record, or -1 when empty.
+int pedal_spsc_front(const pedal_spsc_t *r);
+void pedal_spsc_pop(pedal_spsc_t *r);
+
+#define PEDAL_LATEST_SLOTS 3
+
+typedef struct {
+    uint8_t back;                        // producer's slot
+    uint8_t front;                       // consumer's slot
+    uint8_t mid;                         // exchanged; flagged once published
+} pedal_latest_t;
+
+// Static initializer, same as pedal_latest_init()
+#define PEDAL_LATEST_INITIALIZER { .back = 0, .front = 2, .mid = 1 }
+
+void pedal_latest_init(pedal_latest_t *x);
+
+// Producer: slot to write the next value into
+static inline int pedal_latest_back(const pedal_latest_t *x)
+{
+    return x->back;
+}
+
+void pedal_latest_publish(pedal_latest_t *x);
+
+/**
+ * Consumer: makes the newest published value the front slot. Returns false
+ * (front unchanged) when nothing was published since the last take.
+ */
+bool pedal_latest_take(pedal_latest_t *x);
+
+static inline int pedal_latest_front(const pedal_latest_t *x)
+{
+    return x->front;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef PEDAL_STATUS_H
+#define PEDAL_STATUS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PEDAL_STATUS_EXP_INTERVAL_MS  40   // expression updates are capped at 25/s
+#define PEDAL_STATUS_BAT_DEADBAND_MV  20   // ignore ADC noise on the battery divider
+#define PEDAL_STATUS_STATS_INTERVAL_MS 1000 // transport counters and rates
+#define PEDAL_STATUS_BLE_LINKS        3    // centrals reported
+
+// One connected BLE central
+typedef struct {
+    uint32_t interval_us;
+    uint32_t worst_us;   // longest a message can wait for this link's connection event
+    uint16_t latency;    // connection events the central lets us skip
+    uint16_t mtu;
+    uint8_t phy;         // 1: 1M, 2: 2M
+    uint32_t dropped;    // packets this central missed because it fell too far behind
+} pedal_ble_link_t;
+
+// Live values shown by the web UI
+typedef struct {
+    uint8_t bank;
+    uint8_t sw;          // bit n: switch n of the current bank is ON
+    uint16_t bat_mv;
+    uint16_t exp_raw;    // calibrated ADC reading, 0..4095
+    uint8_t exp_out;     // value last sent on the expression CC
+    uint8_t jack;        // PEDAL_JACK_* (pedal_exp_filter.h)
+    uint16_t exp_usb_hz; // expression values actually sent per second
+    uint16_t exp_ble_hz;
+    uint32_t saved;      // config commit generation known to be on flash
+    uint32_t ble_msgs;   // MIDI messages sent over BLE ...
+    uint32_t ble_pkts;   // ... in this many notifications
+    uint8_t ble_links;
+    pedal_ble_link_t ble[PEDAL_STATUS_BLE_LINKS];
+} pedal_status_t;
+
+// What the connected clients were last told
+typedef struct {
+    pedal_status_t sent;
+    uint32_t exp_sent_ms;
+    uint32_t stats_sent_ms;
+    uint32_t rate_sent_ms;
+    bool synced;
+} pedal_status_stream_t;
+
+// The next delta will carry every field (e.g. after a client connected).
+void pedal_status_stream_reset(pedal_status_stream_t *st);
+
+// Full snapshot as JSON, same keys as the deltas. Returns the length.
+size_t pedal_status_json(const pedal_status_t *cur, char *buf, size_t cap);
+
+/**
+ * JSON object with only the fields that changed since the last delta,
+ * with the expression value rate-limited and the battery deadbanded.
+ * Returns 0 (and leaves st alone) when there is nothing to send.
+ */
+size_t pedal_status_delta(pedal_status_stream_t *st, const pedal_status_t *cur, uint32_t now_ms, char *buf, size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
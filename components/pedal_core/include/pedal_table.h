@@ -0,0 +1,50 @@
+#ifndef PEDAL_TABLE_H
+#define PEDAL_TABLE_H
+
+#include <stdint.h>
+#include "pedal_config.h"
+#include "pedal_curve.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint8_t len;
+    uint8_t data[3];
+} pedal_midi_msg_t;
+
+/**
+ * One switch, resolved. Group masks are already expanded into the set of
+ * switches they affect, so applying a trigger is a couple of AND/OR
+ * operations on the bank state plus copying out prebuilt messages.
+ */
+typedef struct {
+    pedal_midi_msg_t on[2];      // press, long press (len 0: nothing to send)
+    pedal_midi_msg_t off;        // release slot, or the implicit off of the press action
+    uint8_t force_on[2];         // slaves turned ON by press / long press
+    uint8_t force_off[3];        // switches turned OFF by press / long press / turning off
+    uint8_t flags;               // PEDAL_SW_*
+    uint8_t bank_type;           // PEDAL_TYPE_BANK_* or 0 for a regular switch
+    uint8_t reserved;
+} pedal_sw_entry_t;
+
+typedef struct {
+    pedal_sw_entry_t sw[PEDAL_NUM_BANKS][PEDAL_NUM_SWITCHES];
+    uint16_t exp[PEDAL_NUM_BANKS][PEDAL_CURVE_LUT_SIZE];     // calibration + curve, see pedal_curve.h
+} pedal_table_t;
+
+// Rebuild the table; call whenever the config changes, never per press.
+void pedal_table_compile(pedal_table_t *tbl, const pedal_config_t *cfg);
+
+// 14-bit expression output of a bank for a filtered pedal value (Q4 counts)
+static inline uint16_t pedal_table_exp(const pedal_table_t *tbl, uint8_t bank, uint16_t q4)
+{
+    return pedal_curve_map(tbl->exp[bank], q4);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef PEDAL_UMP_H
+#define PEDAL_UMP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pedal_table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Universal MIDI Packets for USB MIDI 2.0 (alternate setting 1). Words are
+ * host order here and go over USB little-endian, message type in the top
+ * nibble:
+ *
+ *   MT 0  utility, 1 word (0: no-op, used as padding)
+ *   MT 2  MIDI 1.0 channel voice, 1 word: 2g ss d1 d2
+ *   MT 4  MIDI 2.0 channel voice, 2 words; control change:
+ *         4g Bc ii 00, then the 32-bit value
+ */
+#define PEDAL_UMP_NOOP       0x00000000u
+#define PEDAL_UMP_MAX_WORDS  2
+
+// MT 2 word for a MIDI 1.0 channel voice message; false for anything else
+bool pedal_ump_midi1(uint8_t group, const pedal_midi_msg_t *msg, uint32_t *word);
+
+// MT 4 control change
+void pedal_ump_cc(uint8_t group, uint8_t ch, uint8_t cc, uint32_t value, uint32_t ump[2]);
+
+// 14-bit value to 32 bits by min-center-max bit repetition (MIDI 2.0 spec):
+// 0, 0x2000 and 0x3FFF map to 0, 0x80000000 and 0xFFFFFFFF.
+uint32_t pedal_ump_scale14(uint16_t v);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
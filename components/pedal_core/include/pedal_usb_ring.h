@@ -0,0 +1,75 @@
+#ifndef PEDAL_USB_RING_H
+#define PEDAL_USB_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "pedal_lat.h"
+#include "pedal_table.h"
+#include "pedal_ump.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PEDAL_USB_RING_LEN      256     // events, power of two
+#define PEDAL_USB_EVENT_SIZE    4
+#define PEDAL_USB_XFER_EVENTS   16      // one 64-byte full-speed bulk packet
+
+/*
+ * Single-producer single-consumer ring of USB-MIDI event packets (cable 0).
+ * The real-time side encodes straight into the ring; the USB side hands
+ * contiguous runs of it to the stack, so nothing is copied in between.
+ * head is only written by the producer and tail only by the consumer; the
+ * counters are likewise owned by one side each.
+ *
+ * With ump set (host chose USB MIDI 2.0) a slot holds one UMP word instead
+ * of an event packet. Messages of several words are never split between
+ * two peeks, nor across the end of the ring.
+ */
+typedef struct {
+    uint8_t ev[PEDAL_USB_RING_LEN][PEDAL_USB_EVENT_SIZE];
+    pedal_lat_stamp_t stamp[PEDAL_USB_RING_LEN];
+    uint8_t more[PEDAL_USB_RING_LEN];    // the next slot belongs to the same message
+    uint32_t head;
+    uint32_t tail;
+    // producer
+    bool ump;
+    uint32_t dropped;                    // ring full
+    uint32_t high_water;                 // most events ever waiting
+    // consumer
+    uint32_t events;
+    uint32_t transfers;
+    uint32_t stalls;                     // USB took less than offered
+} pedal_usb_ring_t;
+
+// USB-MIDI event packet for a MIDI message; false for an empty or unsupported one.
+bool pedal_usb_event(const pedal_midi_msg_t *msg, uint8_t ev[PEDAL_USB_EVENT_SIZE]);
+
+// stamp may be NULL. In UMP mode channel voice messages go out as MT 2.
+bool pedal_usb_ring_push(pedal_usb_ring_t *r, const pedal_midi_msg_t *msg, const pedal_lat_stamp_t *stamp);
+
+// One UMP message of n words (UMP mode only); the stamp goes with the first word.
+bool pedal_usb_ring_push_ump(pedal_usb_ring_t *r, const uint32_t *words, size_t n, const pedal_lat_stamp_t *stamp);
+
+/**
+ * Oldest waiting events that are contiguous in memory, at most max of them.
+ * Returns the count; *span points into the ring until consumed.
+ */
+size_t pedal_usb_ring_peek(pedal_usb_ring_t *r, const uint8_t **span, size_t max);
+
+// Stamp of the k-th event returned by peek
+static inline const pedal_lat_stamp_t *pedal_usb_ring_stamp(const pedal_usb_ring_t *r, size_t k)
+{
+    return &r->stamp[(r->tail + k) & (PEDAL_USB_RING_LEN - 1)];
+}
+
+// Releases n events returned by peek. offered is how many were handed to
+// USB (0 when they are discarded, e.g. with no host attached).
+void pedal_usb_ring_consume(pedal_usb_ring_t *r, size_t n, size_t offered);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef PEDAL_WAKE_H
+#define PEDAL_WAKE_H
+
+#include <stdint.h>
+#include "pedal_config.h"
+#include "pedal_logic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * What the pedal keeps in RTC memory across deep sleep: the live config
+ * and where it left off (bank, toggle states, expression position), so a
+ * wake starts scanning from RAM instead of NVS and carries on where it
+ * stopped. Sealed with a CRC right before sleeping. A power-on, a reset
+ * while sealing or a firmware with a different layout fails the check and
+ * boots from NVS as before.
+ */
+#define PEDAL_WAKE_MAGIC 0x5758424Du   // "MBXW"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t size;                       // sizeof(pedal_wake_t) of the firmware that sealed it
+    uint32_t crc;                        // CRC-32 of everything after this field
+    pedal_config_t cfg;
+    uint16_t exp;                        // filtered pedal position, Q4 counts (exp_input)
+    uint8_t bank;
+    uint8_t state[PEDAL_NUM_BANKS];      // toggles ON; momentaries never survive a sleep
+} pedal_wake_t;
+
+void pedal_wake_seal(pedal_wake_t *w, const pedal_config_t *cfg, const pedal_logic_t *lg, uint16_t exp);
+
+// 0 if w holds a sealed state, -1 otherwise.
+int pedal_wake_check(const pedal_wake_t *w);
+
+// Bank and switch states into a freshly initialized engine; nothing is sent.
+void pedal_wake_resume(const pedal_wake_t *w, pedal_logic_t *lg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
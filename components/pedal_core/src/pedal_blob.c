@@ -0,0 +1,206 @@
+#include <string.h>
+#include "pedal_blob.h"
+
+static const uint8_t MAGIC[4] = { 'M', 'B', 'X', 'C' };
+
+// Nibble-table CRC-32: 64 bytes of table instead of 1 KB.
+uint32_t pedal_crc32(uint32_t crc, const uint8_t *data, size_t len)
+{
+    static const uint32_t tbl[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    crc = ~crc;
+    while (len--) {
+        crc ^= *data++;
+        crc = (crc >> 4) ^ tbl[crc & 0x0F];
+        crc = (crc >> 4) ^ tbl[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+static uint8_t *put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+    return p + 2;
+}
+
+static uint16_t get16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+// Record codecs: the blob payload is the global record followed by each
+// bank's exp record and its eight switch records, then the four curves
+// and the expression budgets.
+
+static uint8_t *pack_global(const pedal_config_t *cfg, uint8_t *p)
+{
+    *p++ = cfg->brightness;
+    *p++ = cfg->ds_en ? 1 : 0;
+    return put16(p, cfg->ds_min);
+}
+
+static const uint8_t *unpack_global(pedal_config_t *cfg, const uint8_t *p)
+{
+    cfg->brightness = p[0];
+    cfg->ds_en = p[1] & 1;
+    cfg->ds_min = get16(p + 2);
+    return p + PEDAL_REC_GLOBAL_SIZE;
+}
+
+static uint8_t *pack_exp(const pedal_exp_t *e, uint8_t *p)
+{
+    *p++ = e->ch;
+    *p++ = e->cc;
+    *p++ = e->crv;
+    p = put16(p, e->min);
+    return put16(p, e->max);
+}
+
+static const uint8_t *unpack_exp(pedal_exp_t *e, const uint8_t *p)
+{
+    e->ch = p[0] & 0x0F;
+    e->cc = p[1] & 0x7F;
+    e->crv = p[2];
+    e->min = get16(p + 3);
+    e->max = get16(p + 5);
+    return p + PEDAL_REC_EXP_SIZE;
+}
+
+static uint8_t *pack_switch(const pedal_switch_t *s, uint8_t *p)
+{
+    for (int t = 0; t < PEDAL_TRIG_COUNT; t++) {
+        *p++ = s->act[t].type;
+        *p++ = s->act[t].ch;
+        *p++ = s->act[t].val;
+    }
+    for (int t = 0; t < PEDAL_TRIG_COUNT; t++) *p++ = s->excl[t];
+    for (int t = 0; t < PEDAL_TRIG_COUNT; t++) *p++ = s->lead[t];
+    *p++ = s->incl;
+    *p++ = s->flags;
+    return p;
+}
+
+static const uint8_t *unpack_switch(pedal_switch_t *s, const uint8_t *p)
+{
+    for (int t = 0; t < PEDAL_TRIG_COUNT; t++) {
+        s->act[t].type = *p++;
+        s->act[t].ch = *p++ & 0x0F;
+        s->act[t].val = *p++ & 0x7F;
+    }
+    for (int t = 0; t < PEDAL_TRIG_COUNT; t++) s->excl[t] = *p++;
+    for (int t = 0; t < PEDAL_TRIG_COUNT; t++) s->lead[t] = *p++;
+    s->incl = *p++;
+    s->flags = *p++;
+    return p;
+}
+
+static uint8_t *pack_curve(const pedal_exp_t *e, uint8_t *p)
+{
+    *p++ = e->npts;
+    memcpy(p, e->pts, sizeof(e->pts));
+    return p + sizeof(e->pts);
+}
+
+static const uint8_t *unpack_curve(pedal_exp_t *e, const uint8_t *p)
+{
+    e->npts = p[0] < 2 ? 2 : p[0] > PEDAL_CURVE_MAX_PTS ? PEDAL_CURVE_MAX_PTS : p[0];
+    memcpy(e->pts, p + 1, sizeof(e->pts));
+    return p + PEDAL_REC_CURVE_SIZE;
+}
+
+static uint8_t *pack_rate(const pedal_config_t *cfg, uint8_t *p)
+{
+    p = put16(p, cfg->exp_usb_hz);
+    return put16(p, cfg->exp_ble_hz);
+}
+
+static const uint8_t *unpack_rate(pedal_config_t *cfg, const uint8_t *p)
+{
+    cfg->exp_usb_hz = pedal_exp_hz_clamp(get16(p));
+    cfg->exp_ble_hz = pedal_exp_hz_clamp(get16(p + 2));
+    return p + PEDAL_REC_RATE_SIZE;
+}
+
+size_t pedal_blob_pack(const pedal_config_t *cfg, uint8_t *buf, size_t cap)
+{
+    if (cap < PEDAL_BLOB_SIZE) return 0;
+
+    uint8_t *p = pack_global(cfg, buf + PEDAL_BLOB_HEADER_SIZE);
+    for (int b = 0; b < PEDAL_NUM_BANKS; b++) {
+        p = pack_exp(&cfg->banks[b].exp, p);
+        for (int i = 0; i < PEDAL_NUM_SWITCHES; i++) p = pack_switch(&cfg->banks[b].sw[i], p);
+    }
+    for (int b = 0; b < PEDAL_NUM_BANKS; b++) p = pack_curve(&cfg->banks[b].exp, p);
+    pack_rate(cfg, p);
+
+    memcpy(buf, MAGIC, sizeof(MAGIC));
+    buf[4] = PEDAL_BLOB_VERSION;
+    buf[5] = PEDAL_NUM_BANKS;
+    put16(buf + 6, PEDAL_BLOB_PAYLOAD_SIZE);
+    uint32_t crc = pedal_crc32(0, buf + PEDAL_BLOB_HEADER_SIZE, PEDAL_BLOB_PAYLOAD_SIZE);
+    put16(buf + 8, crc & 0xFFFF);
+    put16(buf + 10, crc >> 16);
+    return PEDAL_BLOB_SIZE;
+}
+
+int pedal_blob_unpack(pedal_config_t *cfg, const uint8_t *buf, size_t len)
+{
+    if (len < PEDAL_BLOB_HEADER_SIZE || memcmp(buf, MAGIC, sizeof(MAGIC)) != 0) return -1;
+    if (buf[4] < 1 || buf[5] != PEDAL_NUM_BANKS) return -1;
+    uint16_t payload = get16(buf + 6);
+    size_t need = buf[4] < 2 ? PEDAL_BLOB_V1_PAYLOAD : buf[4] < 3 ? PEDAL_BLOB_V2_PAYLOAD : PEDAL_BLOB_PAYLOAD_SIZE;
+    if (payload < need || len < (size_t)PEDAL_BLOB_HEADER_SIZE + payload) return -1;
+    uint32_t crc = get16(buf + 8) | ((uint32_t)get16(buf + 10) << 16);
+    if (pedal_crc32(0, buf + PEDAL_BLOB_HEADER_SIZE, payload) != crc) return -1;
+
+    const uint8_t *p = unpack_global(cfg, buf + PEDAL_BLOB_HEADER_SIZE);
+    for (int b = 0; b < PEDAL_NUM_BANKS; b++) {
+        p = unpack_exp(&cfg->banks[b].exp, p);
+        for (int i = 0; i < PEDAL_NUM_SWITCHES; i++) p = unpack_switch(&cfg->banks[b].sw[i], p);
+    }
+    if (need >= PEDAL_BLOB_V2_PAYLOAD) {
+        for (int b = 0; b < PEDAL_NUM_BANKS; b++) p = unpack_curve(&cfg->banks[b].exp, p);
+    }
+    if (need >= PEDAL_BLOB_PAYLOAD_SIZE) unpack_rate(cfg, p);
+    return 0;
+}
+
+size_t pedal_record_size(int rec)
+{
+    if (rec == PEDAL_REC_GLOBAL) return PEDAL_REC_GLOBAL_SIZE;
+    if (rec == PEDAL_REC_RATE) return PEDAL_REC_RATE_SIZE;
+    if (rec < PEDAL_REC_SW(0, 0)) return PEDAL_REC_EXP_SIZE;
+    if (rec >= PEDAL_REC_CURVE(0)) return PEDAL_REC_CURVE_SIZE;
+    return PEDAL_REC_SW_SIZE;
+}
+
+size_t pedal_record_pack(const pedal_config_t *cfg, int rec, uint8_t *buf)
+{
+    if (rec < 0 || rec >= PEDAL_REC_COUNT) return 0;
+    if (rec == PEDAL_REC_GLOBAL) pack_global(cfg, buf);
+    else if (rec == PEDAL_REC_RATE) pack_rate(cfg, buf);
+    else if (rec < PEDAL_REC_SW(0, 0)) pack_exp(&cfg->banks[rec - PEDAL_REC_EXP(0)].exp, buf);
+    else if (rec >= PEDAL_REC_CURVE(0)) pack_curve(&cfg->banks[rec - PEDAL_REC_CURVE(0)].exp, buf);
+    else {
+        int n = rec - PEDAL_REC_SW(0, 0);
+        pack_switch(&cfg->banks[n / PEDAL_NUM_SWITCHES].sw[n % PEDAL_NUM_SWITCHES], buf);
+    }
+    return pedal_record_size(rec);
+}
+
+int pedal_record_unpack(pedal_config_t *cfg, int rec, const uint8_t *buf, size_t len)
+{
+    if (rec < 0 || rec >= PEDAL_REC_COUNT || len != pedal_record_size(rec)) return -1;
+    if (rec == PEDAL_REC_GLOBAL) unpack_global(cfg, buf);
+    else if (rec == PEDAL_REC_RATE) unpack_rate(cfg, buf);
+    else if (rec < PEDAL_REC_SW(0, 0)) unpack_exp(&cfg->banks[rec - PEDAL_REC_EXP(0)].exp, buf);
+    else if (rec >= PEDAL_REC_CURVE(0)) unpack_curve(&cfg->banks[rec - PEDAL_REC_CURVE(0)].exp, buf);
+    else {
+        int n = rec - PEDAL_REC_SW(0, 0);
+        unpack_switch(&cfg->banks[n / PEDAL_NUM_SWITCHES].sw[n % PEDAL_NUM_SWITCHES], buf);
+    }
+    return 0;
+}
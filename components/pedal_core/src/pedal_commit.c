@@ -0,0 +1,95 @@
+#include <string.h>
+#include "pedal_commit.h"
+
+static bool batch_empty(const pedal_commit_batch_t *b)
+{
+    return !b->full && !b->dirty;
+}
+
+void pedal_commit_init(pedal_commit_queue_t *q)
+{
+    memset(q, 0, sizeof(*q));
+}
+
+uint32_t pedal_commit_stage(pedal_commit_queue_t *q, const pedal_config_t *cfg, bool full, uint64_t dirty,
+                            uint32_t now_ms)
+{
+    pedal_commit_batch_t *p = &q->pending;
+    if (batch_empty(p)) q->first_ms = now_ms;
+    q->last_ms = now_ms;
+    q->requests++;
+
+    if (full) {
+        p->blob_len = pedal_blob_pack(cfg, p->blob, sizeof(p->blob));
+        p->full = true;
+        p->dirty = 0;
+    } else {
+        for (int rec = 0; rec < PEDAL_REC_COUNT; rec++) {
+            if (dirty & (1ull << rec)) p->rec_len[rec] = pedal_record_pack(cfg, rec, p->rec[rec]);
+        }
+        p->dirty |= dirty;
+    }
+    p->gen = ++q->gen;
+    return p->gen;
+}
+
+int32_t pedal_commit_due(const pedal_commit_queue_t *q, uint32_t now_ms)
+{
+    if (batch_empty(&q->pending)) return -1;
+    int32_t settle = PEDAL_COMMIT_SETTLE_MS - (int32_t)(now_ms - q->last_ms);
+    int32_t cap = PEDAL_COMMIT_MAX_WAIT_MS - (int32_t)(now_ms - q->first_ms);
+    int32_t wait = settle < cap ? settle : cap;
+    return wait > 0 ? wait : 0;
+}
+
+bool pedal_commit_take(pedal_commit_queue_t *q, pedal_commit_batch_t *out)
+{
+    pedal_commit_batch_t *p = &q->pending;
+    if (batch_empty(p)) return false;
+
+    out->full = p->full;
+    out->dirty = p->dirty;
+    out->gen = p->gen;
+    if (p->full) {
+        out->blob_len = p->blob_len;
+        memcpy(out->blob, p->blob, p->blob_len);
+    }
+    for (int rec = 0; rec < PEDAL_REC_COUNT; rec++) {
+        if (!(p->dirty & (1ull << rec))) continue;
+        out->rec_len[rec] = p->rec_len[rec];
+        memcpy(out->rec[rec], p->rec[rec], p->rec_len[rec]);
+    }
+    p->full = false;
+    p->dirty = 0;
+    q->writes++;
+    return true;
+}
+
+void pedal_commit_done(pedal_commit_queue_t *q, const pedal_commit_batch_t *b, bool ok, uint32_t now_ms)
+{
+    if (ok) {
+        if (!pedal_commit_reached(q->saved, b->gen)) q->saved = b->gen;
+        return;
+    }
+
+    pedal_commit_batch_t *p = &q->pending;
+    // A blob staged since supersedes everything in the failed batch
+    if (p->full) return;
+    if (batch_empty(p)) {
+        p->gen = b->gen;
+        q->first_ms = now_ms;
+    }
+    q->last_ms = now_ms;
+    if (b->full) {
+        p->full = true;
+        p->blob_len = b->blob_len;
+        memcpy(p->blob, b->blob, b->blob_len);
+    }
+    uint64_t back = b->dirty & ~p->dirty;
+    for (int rec = 0; rec < PEDAL_REC_COUNT; rec++) {
+        if (!(back & (1ull << rec))) continue;
+        p->rec_len[rec] = b->rec_len[rec];
+        memcpy(p->rec[rec], b->rec[rec], b->rec_len[rec]);
+    }
+    p->dirty |= back;
+}
@@ -0,0 +1,283 @@
+#include <string.h>
+#include "pedal_config.h"
+
+void pedal_config_defaults(pedal_config_t *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    for (int b = 0; b < PEDAL_NUM_BANKS; b++) {
+        cfg->banks[b].exp = (pedal_exp_t){
+            .ch = 0, .cc = 11, .crv = PEDAL_CURVE_LINEAR, .min = 0, .max = 4095,
+            .npts = 2, .pts = { { 0, 0 }, { 255, 255 } },
+        };
+    }
+    cfg->brightness = 127;
+    cfg->ds_en = true;
+    cfg->ds_min = 5;
+    cfg->exp_usb_hz = 100;
+    cfg->exp_ble_hz = 50;
+}
+
+// --- Minimal in-place JSON reader ------------------------------------------
+// Walks the settings document once without building a tree, so parsing a
+// full config costs no heap at all.
+
+typedef struct {
+    const char *p;
+    const char *end;
+    bool err;
+} jp_t;
+
+static void jp_ws(jp_t *j)
+{
+    while (j->p < j->end && (*j->p == ' ' || *j->p == '\t' || *j->p == '\n' || *j->p == '\r')) j->p++;
+}
+
+static bool jp_peek(jp_t *j, char c)
+{
+    jp_ws(j);
+    return j->p < j->end && *j->p == c;
+}
+
+static bool jp_eat(jp_t *j, char c)
+{
+    if (!jp_peek(j, c)) return false;
+    j->p++;
+    return true;
+}
+
+static void jp_expect(jp_t *j, char c)
+{
+    if (!jp_eat(j, c)) j->err = true;
+}
+
+// Copies the string (escapes reduced to the escaped char) into buf, truncating.
+static void jp_string(jp_t *j, char *buf, size_t cap)
+{
+    size_t n = 0;
+    if (!jp_eat(j, '"')) { j->err = true; return; }
+    while (j->p < j->end && *j->p != '"') {
+        char c = *j->p++;
+        if (c == '\\' && j->p < j->end) {
+            c = *j->p++;
+            if (c == 'u') j->p += (j->end - j->p >= 4) ? 4 : (j->end - j->p);
+        }
+        if (buf && n + 1 < cap) buf[n++] = c;
+    }
+    if (buf && cap) buf[n] = 0;
+    if (j->p >= j->end) { j->err = true; return; }
+    j->p++;
+}
+
+static long jp_number(jp_t *j)
+{
+    jp_ws(j);
+    bool neg = false;
+    long v = 0;
+    if (j->p < j->end && *j->p == '-') { neg = true; j->p++; }
+    if (j->p >= j->end || *j->p < '0' || *j->p > '9') { j->err = true; return 0; }
+    while (j->p < j->end && *j->p >= '0' && *j->p <= '9') v = v * 10 + (*j->p++ - '0');
+    // Fractions and exponents never occur in the settings document; skip them.
+    while (j->p < j->end && (*j->p == '.' || *j->p == 'e' || *j->p == 'E' || *j->p == '+' || *j->p == '-' ||
+                             (*j->p >= '0' && *j->p <= '9'))) j->p++;
+    return neg ? -v : v;
+}
+
+static bool jp_literal(jp_t *j, const char *lit)
+{
+    size_t n = strlen(lit);
+    if ((size_t)(j->end - j->p) < n || memcmp(j->p, lit, n) != 0) return false;
+    j->p += n;
+    return true;
+}
+
+static void jp_skip(jp_t *j);
+
+// Accepts true/false/null as well as numbers (the UI is not strict about types).
+static long jp_scalar(jp_t *j)
+{
+    jp_ws(j);
+    if (jp_literal(j, "true")) return 1;
+    if (jp_literal(j, "false") || jp_literal(j, "null")) return 0;
+    if (jp_peek(j, '"')) {
+        char tmp[16];
+        jp_string(j, tmp, sizeof(tmp));
+        jp_t sub = { tmp, tmp + strlen(tmp), false };
+        long v = jp_number(&sub);
+        return sub.err ? 0 : v;
+    }
+    if (jp_peek(j, '{') || jp_peek(j, '[')) { jp_skip(j); return 0; }
+    return jp_number(j);
+}
+
+static void jp_skip(jp_t *j)
+{
+    jp_ws(j);
+    if (j->p >= j->end) { j->err = true; return; }
+    char c = *j->p;
+    if (c == '"') { jp_string(j, NULL, 0); return; }
+    if (c == '{' || c == '[') {
+        char close = (c == '{') ? '}' : ']';
+        j->p++;
+        if (jp_eat(j, close)) return;
+        do {
+            if (c == '{') { jp_string(j, NULL, 0); jp_expect(j, ':'); }
+            jp_skip(j);
+        } while (!j->err && jp_eat(j, ','));
+        jp_expect(j, close);
+        return;
+    }
+    jp_scalar(j);
+}
+
+// Object iteration: call jp_obj_begin once, then jp_obj_key until it returns false.
+static bool jp_obj_begin(jp_t *j)
+{
+    if (!jp_eat(j, '{')) { jp_skip(j); return false; }
+    return !jp_eat(j, '}');
+}
+
+static bool jp_obj_next(jp_t *j, char *key, size_t cap, bool first)
+{
+    if (j->err) return false;
+    if (!first) {
+        if (jp_eat(j, '}')) return false;
+        jp_expect(j, ',');
+    }
+    jp_string(j, key, cap);
+    jp_expect(j, ':');
+    return !j->err;
+}
+
+static bool jp_arr_begin(jp_t *j)
+{
+    if (!jp_eat(j, '[')) { jp_skip(j); return false; }
+    return !jp_eat(j, ']');
+}
+
+static bool jp_arr_next(jp_t *j, bool first)
+{
+    if (j->err) return false;
+    if (first) return true;
+    if (jp_eat(j, ']')) return false;
+    jp_expect(j, ',');
+    return !j->err;
+}
+
+#define JP_FOR_KEYS(j, key) \
+    for (bool _f = jp_obj_begin(j), _go = _f && jp_obj_next(j, key, sizeof(key), true); _go; \
+         _go = jp_obj_next(j, key, sizeof(key), false))
+
+#define JP_FOR_ITEMS(j, idx) \
+    for (int idx = 0, _go = jp_arr_begin(j) && jp_arr_next(j, true); _go; \
+         idx++, _go = jp_arr_next(j, false))
+
+static uint8_t clamp_u8(long v)
+{
+    return (v < 0) ? 0 : (v > 255) ? 255 : (uint8_t)v;
+}
+
+static uint16_t clamp_u16(long v)
+{
+    return (v < 0) ? 0 : (v > 65535) ? 65535 : (uint16_t)v;
+}
+
+static void parse_action(jp_t *j, pedal_action_t *a)
+{
+    JP_FOR_ITEMS(j, i) {
+        long v = jp_scalar(j);
+        if (i == 0) a->type = clamp_u8(v);
+        else if (i == 1) a->ch = clamp_u8(v) & 0x0F;
+        else if (i == 2) a->val = clamp_u8(v) & 0x7F;
+    }
+}
+
+static void set_flag(pedal_switch_t *s, uint8_t flag, long on)
+{
+    if (on) s->flags |= flag;
+    else s->flags &= ~flag;
+}
+
+static void parse_switch(jp_t *j, pedal_switch_t *s)
+{
+    char key[8];
+    JP_FOR_KEYS(j, key) {
+        if (!strcmp(key, "p")) parse_action(j, &s->act[PEDAL_TRIG_PRESS]);
+        else if (!strcmp(key, "lp")) parse_action(j, &s->act[PEDAL_TRIG_LONG]);
+        else if (!strcmp(key, "l")) parse_action(j, &s->act[PEDAL_TRIG_RELEASE]);
+        else if (!strcmp(key, "pe")) s->excl[PEDAL_TRIG_PRESS] = clamp_u8(jp_scalar(j));
+        else if (!strcmp(key, "lpe")) s->excl[PEDAL_TRIG_LONG] = clamp_u8(jp_scalar(j));
+        else if (!strcmp(key, "le")) s->excl[PEDAL_TRIG_RELEASE] = clamp_u8(jp_scalar(j));
+        else if (!strcmp(key, "pm")) s->lead[PEDAL_TRIG_PRESS] = clamp_u8(jp_scalar(j));
+        else if (!strcmp(key, "lpm")) s->lead[PEDAL_TRIG_LONG] = clamp_u8(jp_scalar(j));
+        else if (!strcmp(key, "lm")) s->lead[PEDAL_TRIG_RELEASE] = clamp_u8(jp_scalar(j));
+        else if (!strcmp(key, "incl")) s->incl = clamp_u8(jp_scalar(j));
+        else if (!strcmp(key, "tog")) set_flag(s, PEDAL_SW_TOGGLE, jp_scalar(j));
+        else if (!strcmp(key, "edge")) set_flag(s, PEDAL_SW_EDGE_RELEASE, jp_scalar(j));
+        else if (!strcmp(key, "lp_en")) set_flag(s, PEDAL_SW_LONG_EN, jp_scalar(j));
+        else jp_skip(j);
+    }
+}
+
+// "pts": [[travel, output], ...]; extra points are dropped
+static void parse_points(jp_t *j, pedal_exp_t *e)
+{
+    int n = 0;
+    JP_FOR_ITEMS(j, i) {
+        if (i >= PEDAL_CURVE_MAX_PTS) { jp_skip(j); continue; }
+        JP_FOR_ITEMS(j, k) {
+            long v = jp_scalar(j);
+            if (k < 2) e->pts[i][k] = clamp_u8(v);
+        }
+        n = i + 1;
+    }
+    if (n >= 2) e->npts = n;
+}
+
+static void parse_exp(jp_t *j, pedal_exp_t *e)
+{
+    char key[8];
+    JP_FOR_KEYS(j, key) {
+        if (!strcmp(key, "ch")) e->ch = clamp_u8(jp_scalar(j)) & 0x0F;
+        else if (!strcmp(key, "cc")) e->cc = clamp_u8(jp_scalar(j)) & 0x7F;
+        else if (!strcmp(key, "crv")) e->crv = clamp_u8(jp_scalar(j));
+        else if (!strcmp(key, "min")) e->min = clamp_u16(jp_scalar(j));
+        else if (!strcmp(key, "max")) e->max = clamp_u16(jp_scalar(j));
+        else if (!strcmp(key, "pts")) parse_points(j, e);
+        else jp_skip(j);
+    }
+}
+
+static void parse_bank(jp_t *j, pedal_bank_t *b)
+{
+    char key[12];
+    JP_FOR_KEYS(j, key) {
+        if (!strcmp(key, "exp")) parse_exp(j, &b->exp);
+        else if (!strcmp(key, "switches")) {
+            JP_FOR_ITEMS(j, i) {
+                if (i < PEDAL_NUM_SWITCHES) parse_switch(j, &b->sw[i]);
+                else jp_skip(j);
+            }
+        } else jp_skip(j);
+    }
+}
+
+int pedal_config_from_json(pedal_config_t *cfg, const char *json, size_t len)
+{
+    jp_t j = { json, json + len, false };
+    char key[16];
+    JP_FOR_KEYS(&j, key) {
+        if (!strcmp(key, "banks")) {
+            JP_FOR_ITEMS(&j, i) {
+                if (i < PEDAL_NUM_BANKS) parse_bank(&j, &cfg->banks[i]);
+                else jp_skip(&j);
+            }
+        }
+        else if (!strcmp(key, "brightness")) cfg->brightness = clamp_u8(jp_scalar(&j));
+        else if (!strcmp(key, "ds_en")) cfg->ds_en = jp_scalar(&j) != 0;
+        else if (!strcmp(key, "ds_min")) cfg->ds_min = clamp_u16(jp_scalar(&j));
+        else if (!strcmp(key, "exp_usb_hz")) cfg->exp_usb_hz = pedal_exp_hz_clamp(jp_scalar(&j));
+        else if (!strcmp(key, "exp_ble_hz")) cfg->exp_ble_hz = pedal_exp_hz_clamp(jp_scalar(&j));
+        else jp_skip(&j);
+    }
+    return j.err ? -1 : 0;
+}
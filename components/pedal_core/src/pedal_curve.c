@@ -0,0 +1,90 @@
+#include <math.h>
+#include "pedal_curve.h"
+
+#define EXP_K 4.0f      // steepness of the exponential / logarithmic presets
+
+static float swell(float t)
+{
+    return (expf(EXP_K * t) - 1.0f) / (expf(EXP_K) - 1.0f);
+}
+
+// Fritsch-Carlson slopes: the spline never overshoots between points, so a
+// rising curve stays rising and a flat stretch stays flat.
+static void spline_slopes(pedal_curve_t *c)
+{
+    float d[PEDAL_CURVE_MAX_PTS];
+    int n = c->n;
+    for (int k = 0; k < n - 1; k++) d[k] = (c->y[k + 1] - c->y[k]) / (c->x[k + 1] - c->x[k]);
+    c->m[0] = d[0];
+    c->m[n - 1] = d[n - 2];
+    for (int k = 1; k < n - 1; k++) c->m[k] = d[k - 1] * d[k] > 0 ? (d[k - 1] + d[k]) / 2 : 0;
+    for (int k = 0; k < n - 1; k++) {
+        if (d[k] == 0) {
+            c->m[k] = c->m[k + 1] = 0;
+            continue;
+        }
+        float a = c->m[k] / d[k], b = c->m[k + 1] / d[k], h = a * a + b * b;
+        if (h > 9) {
+            float tau = 3 / sqrtf(h);
+            c->m[k] = tau * a * d[k];
+            c->m[k + 1] = tau * b * d[k];
+        }
+    }
+}
+
+void pedal_curve_prepare(pedal_curve_t *c, const pedal_exp_t *e)
+{
+    c->crv = e->crv;
+    c->lo = e->min;
+    c->span = (float)e->max - e->min;
+    c->n = 0;
+    if (e->crv != PEDAL_CURVE_CUSTOM) return;
+
+    // Points out of travel order are skipped rather than rejected
+    int npts = e->npts > PEDAL_CURVE_MAX_PTS ? PEDAL_CURVE_MAX_PTS : e->npts, last = -1;
+    for (int k = 0; k < npts; k++) {
+        if (e->pts[k][0] <= last) continue;
+        last = e->pts[k][0];
+        c->x[c->n] = e->pts[k][0] / 255.0f;
+        c->y[c->n] = e->pts[k][1] / 255.0f;
+        c->n++;
+    }
+    if (c->n < 2) c->crv = PEDAL_CURVE_LINEAR;
+    else spline_slopes(c);
+}
+
+static float spline(const pedal_curve_t *c, float t)
+{
+    if (t <= c->x[0]) return c->y[0];
+    int k = 0;
+    while (k < c->n - 2 && t > c->x[k + 1]) k++;
+    if (t >= c->x[k + 1]) return c->y[k + 1];
+    float h = c->x[k + 1] - c->x[k], s = (t - c->x[k]) / h, s2 = s * s, s3 = s2 * s;
+    return (2 * s3 - 3 * s2 + 1) * c->y[k] + (s3 - 2 * s2 + s) * h * c->m[k] + (3 * s2 - 2 * s3) * c->y[k + 1] +
+           (s3 - s2) * h * c->m[k + 1];
+}
+
+uint16_t pedal_curve_eval(const pedal_curve_t *c, float counts)
+{
+    float t = c->span != 0 ? (counts - c->lo) / c->span : counts >= c->lo;
+    t = t < 0 ? 0 : t > 1 ? 1 : t;
+    float y;
+    switch (c->crv) {
+    case PEDAL_CURVE_EXP: y = swell(t); break;
+    case PEDAL_CURVE_LOG: y = 1 - swell(1 - t); break;
+    case PEDAL_CURVE_CUSTOM: y = spline(c, t); break;
+    default: y = t; break;
+    }
+    long v = lroundf(y * PEDAL_CURVE_OUT_MAX);
+    return v < 0 ? 0 : v > PEDAL_CURVE_OUT_MAX ? PEDAL_CURVE_OUT_MAX : (uint16_t)v;
+}
+
+void pedal_curve_compile(uint16_t lut[PEDAL_CURVE_LUT_SIZE], const pedal_exp_t *e)
+{
+    pedal_curve_t c;
+    pedal_curve_prepare(&c, e);
+    // Entry i covers Q4 values i << SHIFT and up. Sampling spreads 0..4095
+    // over the entries so the first and last give exactly the curve's ends.
+    const float step = 4095.0f / (PEDAL_CURVE_LUT_SIZE - 1);
+    for (int i = 0; i < PEDAL_CURVE_LUT_SIZE; i++) lut[i] = pedal_curve_eval(&c, i * step);
+}
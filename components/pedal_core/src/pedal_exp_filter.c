@@ -0,0 +1,108 @@
+#include "pedal_exp_filter.h"
+
+#define CIC_OUT_SHIFT (2 * PEDAL_CIC_SHIFT - PEDAL_EXP_FRAC_BITS)
+
+void pedal_cic_init(pedal_cic_t *c)
+{
+    *c = (pedal_cic_t){ 0 };
+}
+
+size_t pedal_cic_frame(pedal_cic_t *c, const uint16_t *in, size_t n, uint16_t *out)
+{
+    uint32_t i1 = c->i1, i2 = c->i2, phase = c->phase;
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++) {
+        i1 += in[i] & 0xFFF;
+        i2 += i1;
+        if (++phase < PEDAL_CIC_R) continue;
+        phase = 0;
+        uint32_t d1 = i2 - c->c1;
+        c->c1 = i2;
+        uint32_t d2 = d1 - c->c2;
+        c->c2 = d1;
+        out[k++] = d2 >> CIC_OUT_SHIFT;
+    }
+    c->i1 = i1;
+    c->i2 = i2;
+    c->phase = phase;
+    return k;
+}
+
+uint32_t pedal_euro_alpha(uint32_t cutoff_mhz, uint32_t rate_hz)
+{
+    // alpha = 1 / (1 + rate / (2 pi fc)) = w / (w + rate) with w = 2 pi fc
+    uint64_t w = (uint64_t)cutoff_mhz * 6283 / 1000;
+    return (uint32_t)((w << 16) / (w + (uint64_t)rate_hz * 1000));
+}
+
+void pedal_euro_init(pedal_euro_t *e, uint32_t rate_hz, uint32_t min_cutoff_mhz, uint32_t beta_q8,
+                     uint32_t d_cutoff_mhz)
+{
+    *e = (pedal_euro_t){
+        .rate_hz = rate_hz,
+        .min_cutoff_mhz = min_cutoff_mhz,
+        .max_cutoff_mhz = rate_hz * 1000 / 4,
+        .beta_q8 = beta_q8,
+        .d_alpha_q16 = pedal_euro_alpha(d_cutoff_mhz, rate_hz),
+    };
+}
+
+static int32_t lowpass(int32_t y, int32_t x, uint32_t alpha_q16)
+{
+    return y + (int32_t)(((int64_t)(x - y) * alpha_q16) >> 16);
+}
+
+uint16_t pedal_euro_step(pedal_euro_t *e, uint16_t x)
+{
+    int32_t xs = (int32_t)x << 8;
+    if (!e->primed) {
+        e->primed = true;
+        e->x = xs;
+        e->dx = 0;
+        e->out = x;
+        return x;
+    }
+    e->dx = lowpass(e->dx, xs - e->x, e->d_alpha_q16);
+    uint64_t speed = (uint64_t)(e->dx < 0 ? -e->dx : e->dx) * e->rate_hz >> 8;     // Q4 counts/s
+    uint64_t cutoff = e->min_cutoff_mhz + ((speed * e->beta_q8) >> 8);
+    if (cutoff > e->max_cutoff_mhz) cutoff = e->max_cutoff_mhz;
+    e->x = lowpass(e->x, xs, pedal_euro_alpha((uint32_t)cutoff, e->rate_hz));
+    int32_t y = (e->x + 128) >> 8;
+    if (y < 0) y = 0;
+    if (y > UINT16_MAX) y = UINT16_MAX;
+    if (y > e->out + PEDAL_EXP_HOLD || y < e->out - PEDAL_EXP_HOLD || y == 0 || y >= PEDAL_EXP_FULL) e->out = y;
+    return e->out;
+}
+
+void pedal_jack_init(pedal_jack_t *j)
+{
+    *j = (pedal_jack_t){ .state = PEDAL_JACK_OK };
+}
+
+uint8_t pedal_jack_step(pedal_jack_t *j, uint16_t x)
+{
+    uint32_t ms = ++j->ms;
+    if (!j->primed) {
+        j->extreme = x;
+        j->rising = true;
+        j->primed = true;
+        for (int k = 0; k < PEDAL_JACK_TURNS; k++) j->turn_ms[k] = ms - 2 * PEDAL_JACK_TURN_MS;
+        j->floating_ms = ms - 2 * PEDAL_JACK_CLEAN_MS;
+    }
+    if (j->rising ? x > j->extreme : x < j->extreme) {
+        j->extreme = x;
+    } else if ((j->rising ? j->extreme - x : x - j->extreme) >= PEDAL_JACK_SWING) {
+        j->rising = !j->rising;
+        j->extreme = x;
+        // The oldest of the last PEDAL_JACK_TURNS turns is the slot about to be reused
+        if (ms - j->turn_ms[j->turn] < PEDAL_JACK_TURN_MS) j->floating_ms = ms;
+        j->turn_ms[j->turn] = ms;
+        j->turn = (j->turn + 1) % PEDAL_JACK_TURNS;
+    }
+    if (x >= PEDAL_JACK_RAIL) j->rail_ms = 0;
+    else if (j->rail_ms < PEDAL_JACK_OPEN_MS) j->rail_ms++;
+
+    if (ms - j->floating_ms < PEDAL_JACK_CLEAN_MS) j->state = PEDAL_JACK_FLOATING;
+    else j->state = j->rail_ms >= PEDAL_JACK_OPEN_MS ? PEDAL_JACK_OPEN : PEDAL_JACK_OK;
+    return j->state;
+}
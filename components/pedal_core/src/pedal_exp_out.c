@@ -0,0 +1,45 @@
+#include "pedal_exp_out.h"
+
+void pedal_exp_out_init(pedal_exp_out_t *o, uint8_t bits, uint32_t interval_ms)
+{
+    *o = (pedal_exp_out_t){ .interval_ms = interval_ms, .shift = bits < 14 ? 14 - bits : 0 };
+}
+
+bool pedal_exp_out_due(pedal_exp_out_t *o, uint16_t v, uint32_t now_ms, uint16_t *prev)
+{
+    if (o->primed && (v >> o->shift == o->sent >> o->shift || now_ms - o->sent_ms < o->interval_ms)) return false;
+    *prev = o->primed ? o->sent : PEDAL_EXP_OUT_NONE;
+    o->primed = true;
+    o->sent = v;
+    o->sent_ms = now_ms;
+    return true;
+}
+
+static pedal_midi_msg_t cc_msg(uint8_t ch, uint8_t cc, uint8_t val)
+{
+    return (pedal_midi_msg_t){ 3, { 0xB0 | (ch & 0x0F), cc, val } };
+}
+
+int pedal_exp_cc14(uint8_t ch, uint8_t cc, uint16_t v, uint16_t prev, pedal_midi_msg_t out[2])
+{
+    uint8_t msb = (v >> 7) & 0x7F;
+    if (cc >= 32) {
+        out[0] = cc_msg(ch, cc, msb);
+        return 1;
+    }
+    int n = 0;
+    if (prev == PEDAL_EXP_OUT_NONE || msb != ((prev >> 7) & 0x7F)) out[n++] = cc_msg(ch, cc, msb);
+    out[n++] = cc_msg(ch, cc + 32, v & 0x7F);
+    return n;
+}
+
+void pedal_rate_add(pedal_rate_t *r, uint32_t now_ms, uint32_t n)
+{
+    uint32_t span = now_ms - r->start_ms;
+    if (span >= 1000) {
+        r->hz = (uint64_t)r->count * 1000 / span;
+        r->start_ms = now_ms;
+        r->count = 0;
+    }
+    r->count += n;
+}
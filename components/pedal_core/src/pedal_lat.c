@@ -0,0 +1,42 @@
+#include <stdio.h>
+#include <string.h>
+#include "pedal_lat.h"
+
+uint32_t pedal_lat_bucket_floor(int b)
+{
+    if (b < 8) return b;
+    int e = (b - 8) / 4 + 3;
+    return (uint32_t)(4 + (b - 8) % 4) << (e - 2);
+}
+
+void pedal_lat_reset(pedal_lat_t *h)
+{
+    memset(h, 0, sizeof(*h));
+}
+
+uint32_t pedal_lat_percentile(const pedal_lat_t *h, unsigned pct)
+{
+    uint32_t count = h->count;
+    if (!count) return 0;
+    uint64_t rank = ((uint64_t)count * pct + 99) / 100;
+    if (!rank) rank = 1;
+    uint64_t seen = 0;
+    int b = 0;
+    for (; b < PEDAL_LAT_BUCKETS - 1; b++) {
+        seen += h->hist[b];
+        if (seen >= rank) break;
+    }
+    uint32_t v = b < PEDAL_LAT_BUCKETS - 1 ? pedal_lat_bucket_floor(b + 1) - 1 : h->max_us;
+    if (v > h->max_us) v = h->max_us;
+    if (v < h->min_us) v = h->min_us;
+    return v;
+}
+
+size_t pedal_lat_json(const pedal_lat_t *h, char *buf, size_t cap)
+{
+    int n = snprintf(buf, cap, "{\"n\":%lu,\"min\":%lu,\"p50\":%lu,\"p99\":%lu,\"max\":%lu}",
+                     (unsigned long)h->count, (unsigned long)(h->count ? h->min_us : 0),
+                     (unsigned long)pedal_lat_percentile(h, 50), (unsigned long)pedal_lat_percentile(h, 99),
+                     (unsigned long)h->max_us);
+    return n > 0 && (size_t)n < cap ? (size_t)n : 0;
+}
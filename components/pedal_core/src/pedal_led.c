@@ -0,0 +1,117 @@
+#include <string.h>
+#include "pedal_led.h"
+
+#define FLASHES        3
+#define BANK_PHASE_MS  100      // on, off, on, ...
+#define ID_PHASE_MS    150
+#define BLINK_MS       500
+#define DIM_SHIFT      3        // OFF switches at 1/8
+#define BAT_LOW_MV     3600
+#define BAT_OK_MV      3900
+#define BAT_HYST_MV    50
+
+typedef struct {
+    uint8_t r, g, b;
+} rgb_t;
+
+// Bank 1 red, 2 green, 3 blue, 4 purple
+static const rgb_t s_bank_rgb[PEDAL_NUM_BANKS] = {
+    { 255, 0, 0 }, { 0, 255, 0 }, { 0, 0, 255 }, { 160, 0, 255 },
+};
+static const rgb_t s_purple = { 160, 0, 255 };
+static const rgb_t s_bat_rgb[] = {
+    [PEDAL_LED_BAT_UNKNOWN] = { 0, 0, 0 },
+    [PEDAL_LED_BAT_LOW] = { 255, 0, 0 },
+    [PEDAL_LED_BAT_OK] = { 255, 160, 0 },
+    [PEDAL_LED_BAT_GOOD] = { 0, 255, 0 },
+};
+// Switch shown by LEDs 2-9: Sw1 -> Sw2 -> Sw3 -> Sw4 -> Sw8 -> Sw7 -> Sw6 -> Sw5
+static const uint8_t s_led_sw[PEDAL_NUM_SWITCHES] = { 0, 1, 2, 3, 7, 6, 5, 4 };
+
+void pedal_led_init(pedal_led_t *l, uint8_t brightness)
+{
+    memset(l, 0, sizeof(*l));
+    l->brightness = ~brightness;
+    pedal_led_brightness(l, brightness);
+}
+
+void pedal_led_brightness(pedal_led_t *l, uint8_t brightness)
+{
+    if (brightness == l->brightness) return;
+    l->brightness = brightness;
+    for (uint32_t v = 0; v < 256; v++) l->lut[v] = (v * v * brightness + 255 * 255 / 2) / (255 * 255);
+    l->valid = false;
+}
+
+void pedal_led_animate(pedal_led_t *l, uint8_t anim, uint32_t now_ms)
+{
+    l->anim = anim;
+    l->anim_ms = now_ms;
+}
+
+static void put(pedal_led_t *l, uint8_t *out, int led, rgb_t c, int shift)
+{
+    out[led * 3 + 0] = l->lut[c.g >> shift];
+    out[led * 3 + 1] = l->lut[c.r >> shift];
+    out[led * 3 + 2] = l->lut[c.b >> shift];
+}
+
+// Next multiple of period after now, counted from start
+static uint32_t next_step(uint32_t start, uint32_t now, uint32_t period)
+{
+    return start + ((now - start) / period + 1) * period;
+}
+
+static void earliest(uint32_t *next, uint32_t t)
+{
+    if (!*next || (int32_t)(t - *next) < 0) *next = t;
+}
+
+bool pedal_led_render(pedal_led_t *l, const pedal_led_state_t *s, uint32_t now_ms, uint32_t *next_ms)
+{
+    uint8_t out[PEDAL_LED_FRAME];
+    rgb_t bank = s_bank_rgb[s->bank % PEDAL_NUM_BANKS];
+    uint32_t next = 0;
+
+    bool bat_on = true;
+    if (s->battery == PEDAL_LED_BAT_LOW) {
+        bat_on = !(now_ms / BLINK_MS & 1);
+        earliest(&next, next_step(0, now_ms, BLINK_MS));
+    }
+    put(l, out, 0, s_bat_rgb[s->battery <= PEDAL_LED_BAT_GOOD ? s->battery : 0], bat_on ? 0 : 8);
+    for (int i = 0; i < PEDAL_NUM_SWITCHES; i++)
+        put(l, out, 1 + i, bank, s->on >> s_led_sw[i] & 1 ? 0 : DIM_SHIFT);
+
+    if (l->anim != PEDAL_LED_ANIM_NONE) {
+        uint32_t phase = l->anim == PEDAL_LED_ANIM_BANK ? BANK_PHASE_MS : ID_PHASE_MS;
+        uint32_t t = now_ms - l->anim_ms;
+        if (t >= 2 * FLASHES * phase) {
+            l->anim = PEDAL_LED_ANIM_NONE;
+        } else {
+            bool lit = !(t / phase & 1);
+            if (l->anim == PEDAL_LED_ANIM_BANK) {
+                for (int i = 0; i < PEDAL_NUM_SWITCHES; i++) put(l, out, 1 + i, bank, lit ? 0 : 8);
+            } else {
+                for (int i = 0; i < PEDAL_LED_COUNT; i++) put(l, out, i, s_purple, lit ? 0 : 8);
+            }
+            earliest(&next, next_step(l->anim_ms, now_ms, phase));
+        }
+    }
+    *next_ms = next;
+
+    if (l->valid && !memcmp(out, l->frame, sizeof(out))) return false;
+    memcpy(l->frame, out, sizeof(out));
+    l->valid = true;
+    return true;
+}
+
+uint8_t pedal_led_battery(uint8_t prev, uint32_t mv)
+{
+    if (!mv) return prev;
+    // A level is only left once the voltage is clearly past its threshold
+    uint32_t low = BAT_LOW_MV, ok = BAT_OK_MV;
+    if (prev == PEDAL_LED_BAT_LOW) low += BAT_HYST_MV;
+    if (prev == PEDAL_LED_BAT_OK) low -= BAT_HYST_MV, ok += BAT_HYST_MV;
+    if (prev == PEDAL_LED_BAT_GOOD) ok -= BAT_HYST_MV;
+    return mv < low ? PEDAL_LED_BAT_LOW : mv < ok ? PEDAL_LED_BAT_OK : PEDAL_LED_BAT_GOOD;
+}
@@ -0,0 +1,138 @@
+#include <string.h>
+#include "pedal_logic.h"
+
+static inline void send(pedal_logic_t *lg, const pedal_midi_msg_t *m)
+{
+    if (m->len) lg->sink(lg->sink_ctx, m);
+}
+
+// Forced switches never cascade: each only sends its own prebuilt message.
+static void apply(pedal_logic_t *lg, uint8_t b, uint8_t force_off, uint8_t force_on)
+{
+    const pedal_sw_entry_t *row = lg->tbl->sw[b];
+    uint8_t off = force_off & lg->state[b];
+    lg->state[b] &= ~off;
+    lg->armed &= ~off;
+    while (off) {
+        uint8_t j = __builtin_ctz(off);
+        off &= off - 1;
+        send(lg, &row[j].off);
+    }
+    uint8_t on = force_on & ~lg->state[b];
+    lg->state[b] |= on;
+    while (on) {
+        uint8_t j = __builtin_ctz(on);
+        on &= on - 1;
+        send(lg, &row[j].on[0]);
+    }
+}
+
+static void switch_on(pedal_logic_t *lg, uint8_t b, uint8_t sw)
+{
+    const pedal_sw_entry_t *e = &lg->tbl->sw[b][sw];
+    lg->state[b] |= 1u << sw;
+    send(lg, &e->on[0]);
+    apply(lg, b, e->force_off[0], e->force_on[0]);
+}
+
+static void switch_off(pedal_logic_t *lg, uint8_t b, uint8_t sw)
+{
+    const pedal_sw_entry_t *e = &lg->tbl->sw[b][sw];
+    lg->state[b] &= ~(1u << sw);
+    send(lg, &e->off);
+    apply(lg, b, e->force_off[2], 0);
+}
+
+static void short_press(pedal_logic_t *lg, uint8_t b, uint8_t sw, bool at_press)
+{
+    const pedal_sw_entry_t *e = &lg->tbl->sw[b][sw];
+    uint8_t bit = 1u << sw;
+    if (e->flags & PEDAL_SW_TOGGLE) {
+        if (lg->state[b] & bit) switch_off(lg, b, sw);
+        else switch_on(lg, b, sw);
+    } else {
+        switch_on(lg, b, sw);
+        if (at_press) lg->armed |= bit;
+        else switch_off(lg, b, sw);
+    }
+}
+
+static void long_press(pedal_logic_t *lg, uint8_t b, uint8_t sw)
+{
+    const pedal_sw_entry_t *e = &lg->tbl->sw[b][sw];
+    send(lg, &e->on[1]);
+    apply(lg, b, e->force_off[1], e->force_on[1]);
+}
+
+static void bank_action(pedal_logic_t *lg, uint8_t type)
+{
+    if (type == PEDAL_TYPE_BANK_REV) lg->bank = (lg->bank + PEDAL_NUM_BANKS - 1) % PEDAL_NUM_BANKS;
+    else if (type == PEDAL_TYPE_BANK_FWD) lg->bank = (lg->bank + 1) % PEDAL_NUM_BANKS;
+    else lg->bank = (type - PEDAL_TYPE_BANK_1) % PEDAL_NUM_BANKS;
+}
+
+void pedal_logic_init(pedal_logic_t *lg, const pedal_table_t *tbl, pedal_midi_sink_t sink, void *sink_ctx)
+{
+    memset(lg, 0, sizeof(*lg));
+    lg->tbl = tbl;
+    lg->sink = sink;
+    lg->sink_ctx = sink_ctx;
+}
+
+void pedal_logic_set_bank(pedal_logic_t *lg, uint8_t bank)
+{
+    lg->bank = bank % PEDAL_NUM_BANKS;
+}
+
+void pedal_logic_edge(pedal_logic_t *lg, uint8_t sw, bool down, uint32_t now_ms)
+{
+    if (sw >= PEDAL_NUM_SWITCHES) return;
+    uint8_t bit = 1u << sw;
+
+    if (down) {
+        if (lg->held & bit) return;
+        lg->held |= bit;
+        lg->long_fired &= ~bit;
+        lg->press_ms[sw] = now_ms;
+        lg->press_bank[sw] = lg->bank;
+
+        const pedal_sw_entry_t *e = &lg->tbl->sw[lg->bank][sw];
+        if (e->bank_type) {
+            bank_action(lg, e->bank_type);
+            return;
+        }
+        if (!(e->flags & (PEDAL_SW_LONG_EN | PEDAL_SW_EDGE_RELEASE))) short_press(lg, lg->bank, sw, true);
+        return;
+    }
+
+    if (!(lg->held & bit)) return;
+    lg->held &= ~bit;
+
+    // A release belongs to the bank the switch was pressed in
+    uint8_t b = lg->press_bank[sw];
+    const pedal_sw_entry_t *e = &lg->tbl->sw[b][sw];
+    if (e->bank_type) return;
+
+    if (lg->armed & bit) {
+        lg->armed &= ~bit;
+        if (lg->state[b] & bit) switch_off(lg, b, sw);
+    } else if (!(lg->long_fired & bit) && (e->flags & (PEDAL_SW_LONG_EN | PEDAL_SW_EDGE_RELEASE))) {
+        short_press(lg, b, sw, false);
+    }
+}
+
+void pedal_logic_tick(pedal_logic_t *lg, uint32_t now_ms)
+{
+    uint8_t pending = lg->held & ~lg->long_fired;
+    while (pending) {
+        uint8_t sw = __builtin_ctz(pending);
+        uint8_t bit = 1u << sw;
+        pending &= ~bit;
+        uint8_t b = lg->press_bank[sw];
+        const pedal_sw_entry_t *e = &lg->tbl->sw[b][sw];
+        if (!(e->flags & PEDAL_SW_LONG_EN) || e->bank_type) continue;
+        if ((uint32_t)(now_ms - lg->press_ms[sw]) < PEDAL_LONG_PRESS_MS) continue;
+        lg->long_fired |= bit;
+        long_press(lg, b, sw);
+    }
+}
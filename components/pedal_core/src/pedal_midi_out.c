@@ -0,0 +1,105 @@
+#include "pedal_midi_out.h"
+
+#define QUEUE_MASK (PEDAL_MIDI_QUEUE_LEN - 1)
+
+bool pedal_midi_queue_push(pedal_midi_queue_t *q, const pedal_midi_msg_t *msg, uint32_t now_ms,
+                           const pedal_lat_stamp_t *stamp)
+{
+    if ((uint16_t)(q->head - q->tail) == PEDAL_MIDI_QUEUE_LEN) {
+        q->dropped++;
+        return false;
+    }
+    pedal_midi_event_t *e = &q->ev[q->head & QUEUE_MASK];
+    e->ms = now_ms;
+    e->msg = *msg;
+    e->stamp = stamp ? *stamp : (pedal_lat_stamp_t){ 0 };
+    q->head++;
+    return true;
+}
+
+void pedal_ble_out_init(pedal_ble_out_t *b, uint16_t mtu, uint32_t interval_us)
+{
+    *b = (pedal_ble_out_t){ .mtu = mtu, .interval_us = interval_us, .exp_sent = PEDAL_EXP_OUT_NONE };
+}
+
+void pedal_ble_out_exp(pedal_ble_out_t *b, uint8_t ch, uint8_t cc, uint16_t v, uint32_t now_ms)
+{
+    if (b->exp_pending) b->exp_coalesced++;
+    b->exp_ch = ch;
+    b->exp_cc = cc;
+    b->exp_val = v;
+    b->exp_ms = now_ms;
+    b->exp_pending = true;
+}
+
+typedef struct {
+    uint8_t *pkt;
+    size_t n, limit;
+    int status, stamp;
+} pkt_t;
+
+// Appends one message with its timestamp, running status where it can;
+// false when it does not fit.
+static bool put_msg(pkt_t *p, const pedal_midi_msg_t *m, uint32_t ms)
+{
+    int ts = 0x80 | (ms & 0x7F);
+    // System messages cancel running status
+    bool running = m->data[0] == p->status && ts == p->stamp && m->data[0] < 0xF0;
+    size_t need = running ? m->len - 1u : m->len + 1u;
+    if (p->n + need > p->limit) return false;
+
+    if (!running) p->pkt[p->n++] = ts;
+    for (int i = running ? 1 : 0; i < m->len; i++) p->pkt[p->n++] = m->data[i];
+    p->status = m->data[0] < 0xF0 ? m->data[0] : -1;
+    p->stamp = ts;
+    return true;
+}
+
+size_t pedal_ble_out_poll(pedal_ble_out_t *b, uint32_t now_us, uint8_t *pkt, size_t cap)
+{
+    pedal_midi_queue_t *q = &b->q;
+    bool queued = !pedal_midi_queue_empty(q);
+    if ((!queued && !b->exp_pending) || (int32_t)(now_us - b->next_us) < 0) return 0;
+
+    pkt_t p = { pkt, 1, b->mtu - PEDAL_BLE_ATT_OVERHEAD, -1, -1 };
+    if (p.limit > cap) p.limit = cap;
+    uint32_t first_ms = queued ? q->ev[q->tail & QUEUE_MASK].ms : b->exp_ms;
+    uint32_t last_ms = first_ms;
+    pkt[0] = 0x80 | ((first_ms >> 7) & 0x3F);
+    unsigned count = 0;
+
+    while (!pedal_midi_queue_empty(q)) {
+        const pedal_midi_event_t *e = &q->ev[q->tail & QUEUE_MASK];
+        if (e->ms - first_ms > 127 || !put_msg(&p, &e->msg, e->ms)) break;
+        last_ms = e->ms;
+        count++;
+        q->tail++;
+    }
+
+    // The expression value rides last, stamped no earlier than the message
+    // before it so the timestamps do not look wrapped
+    if (b->exp_pending && pedal_midi_queue_empty(q)) {
+        uint32_t ms = (int32_t)(b->exp_ms - last_ms) > 0 ? b->exp_ms : last_ms;
+        pedal_midi_msg_t m[2];
+        int k = pedal_exp_cc14(b->exp_ch, b->exp_cc, b->exp_val, b->exp_sent, m);
+        pkt_t undo = p;
+        bool fits = ms - first_ms <= 127;
+        for (int i = 0; i < k && fits; i++) fits = put_msg(&p, &m[i], ms);
+        if (fits) {
+            b->exp_pending = false;
+            b->exp_sent = b->exp_val;
+            b->exp_updates++;
+            count += k;
+        } else {
+            p = undo;
+        }
+    }
+    if (!count) return 0;     // cap below the smallest message
+
+    b->next_us = now_us + b->interval_us;
+    b->packets++;
+    b->msgs += count;
+    b->bytes += p.n;
+    if (count > b->max_msgs) b->max_msgs = count > 255 ? 255 : count;
+    return p.n;
+}
@@ -0,0 +1,92 @@
+#include "pedal_blob.h"
+#include "pedal_patch.h"
+
+static void set_flag(uint8_t *flags, uint8_t flag, uint16_t on)
+{
+    if (on) *flags |= flag;
+    else *flags &= ~flag;
+}
+
+// Validates one op; returns its record id or -1.
+static int op_record(const uint8_t *op)
+{
+    uint8_t bank = op[0], sw = op[1], field = op[2];
+    uint16_t val = op[3] | (op[4] << 8);
+
+    if (bank == PEDAL_PATCH_GLOBAL) {
+        if (field > PEDAL_F_GLOB_EXP_BLE_HZ) return -1;
+        if (field == PEDAL_F_GLOB_BRIGHTNESS && val > 255) return -1;
+        if (field >= PEDAL_F_GLOB_EXP_USB_HZ)
+            return val >= PEDAL_EXP_HZ_MIN && val <= PEDAL_EXP_HZ_MAX ? PEDAL_REC_RATE : -1;
+        return PEDAL_REC_GLOBAL;
+    }
+    if (bank >= PEDAL_NUM_BANKS) return -1;
+    if (sw == PEDAL_PATCH_EXP) {
+        if (field == PEDAL_F_EXP_NPTS) return val >= 2 && val <= PEDAL_CURVE_MAX_PTS ? PEDAL_REC_CURVE(bank) : -1;
+        if (field >= PEDAL_F_EXP_PT(0)) return field < PEDAL_F_EXP_PT(PEDAL_CURVE_MAX_PTS) ? PEDAL_REC_CURVE(bank) : -1;
+        if (field > PEDAL_F_EXP_MAX) return -1;
+        if (field <= PEDAL_F_EXP_CRV && val > 127) return -1;
+        return PEDAL_REC_EXP(bank);
+    }
+    if (sw >= PEDAL_NUM_SWITCHES || field > PEDAL_F_LP_EN || val > 255) return -1;
+    return PEDAL_REC_SW(bank, sw);
+}
+
+static void op_apply(pedal_config_t *cfg, const uint8_t *op)
+{
+    uint8_t bank = op[0], sw = op[1], field = op[2];
+    uint16_t val = op[3] | (op[4] << 8);
+
+    if (bank == PEDAL_PATCH_GLOBAL) {
+        if (field == PEDAL_F_GLOB_BRIGHTNESS) cfg->brightness = val;
+        else if (field == PEDAL_F_GLOB_DS_EN) cfg->ds_en = val != 0;
+        else if (field == PEDAL_F_GLOB_DS_MIN) cfg->ds_min = val;
+        else if (field == PEDAL_F_GLOB_EXP_USB_HZ) cfg->exp_usb_hz = val;
+        else cfg->exp_ble_hz = val;
+        return;
+    }
+    if (sw == PEDAL_PATCH_EXP) {
+        pedal_exp_t *e = &cfg->banks[bank].exp;
+        switch (field) {
+        case PEDAL_F_EXP_CH: e->ch = val & 0x0F; break;
+        case PEDAL_F_EXP_CC: e->cc = val; break;
+        case PEDAL_F_EXP_CRV: e->crv = val; break;
+        case PEDAL_F_EXP_MIN: e->min = val; break;
+        case PEDAL_F_EXP_MAX: e->max = val; break;
+        case PEDAL_F_EXP_NPTS: e->npts = val; break;
+        default:
+            e->pts[field - PEDAL_F_EXP_PT(0)][0] = val & 0xFF;
+            e->pts[field - PEDAL_F_EXP_PT(0)][1] = val >> 8;
+            break;
+        }
+        return;
+    }
+
+    pedal_switch_t *s = &cfg->banks[bank].sw[sw];
+    if (field < PEDAL_F_EXCL(0)) {
+        pedal_action_t *a = &s->act[field / 3];
+        if (field % 3 == 0) a->type = val;
+        else if (field % 3 == 1) a->ch = val & 0x0F;
+        else a->val = val & 0x7F;
+    }
+    else if (field < PEDAL_F_LEAD(0)) s->excl[field - PEDAL_F_EXCL(0)] = val;
+    else if (field < PEDAL_F_INCL) s->lead[field - PEDAL_F_LEAD(0)] = val;
+    else if (field == PEDAL_F_INCL) s->incl = val;
+    else if (field == PEDAL_F_TOG) set_flag(&s->flags, PEDAL_SW_TOGGLE, val);
+    else if (field == PEDAL_F_EDGE) set_flag(&s->flags, PEDAL_SW_EDGE_RELEASE, val);
+    else set_flag(&s->flags, PEDAL_SW_LONG_EN, val);
+}
+
+int pedal_patch_apply(pedal_config_t *cfg, const uint8_t *ops, size_t len, uint64_t *dirty)
+{
+    if (len % PEDAL_PATCH_OP_SIZE) return -1;
+    uint64_t touched = 0;
+    for (size_t i = 0; i < len; i += PEDAL_PATCH_OP_SIZE) {
+        int rec = op_record(ops + i);
+        if (rec < 0) return -1;
+        touched |= 1ull << rec;
+    }
+    for (size_t i = 0; i < len; i += PEDAL_PATCH_OP_SIZE) op_apply(cfg, ops + i);
+    *dirty |= touched;
+    return (int)(len / PEDAL_PATCH_OP_SIZE);
+}
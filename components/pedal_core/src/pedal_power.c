@@ -0,0 +1,56 @@
+#include <string.h>
+#include "pedal_power.h"
+
+static const uint32_t s_load_ua[PEDAL_POWER_LOADS] = {
+    [PEDAL_POWER_BLE] = PEDAL_POWER_BLE_UA,
+    [PEDAL_POWER_WIFI] = PEDAL_POWER_WIFI_UA,
+    [PEDAL_POWER_USB] = PEDAL_POWER_USB_UA,
+};
+
+void pedal_idle_init(pedal_idle_t *d, uint32_t idle_ms, uint32_t now_ms, uint16_t exp)
+{
+    d->idle_ms = idle_ms;
+    d->since_ms = now_ms;
+    d->exp = exp;
+}
+
+bool pedal_idle_step(pedal_idle_t *d, uint32_t now_ms, uint8_t held, bool edges, uint16_t exp)
+{
+    if (held || edges || pedal_idle_moved(d->exp, exp)) {
+        d->since_ms = now_ms;
+        d->exp = exp;
+        return false;
+    }
+    return d->idle_ms && now_ms - d->since_ms >= d->idle_ms;
+}
+
+void pedal_power_init(pedal_power_t *p)
+{
+    memset(p, 0, sizeof(*p));
+}
+
+void pedal_power_add(pedal_power_t *p, uint32_t ms, uint32_t asleep_ms, uint8_t loads)
+{
+    p->ms += ms;
+    p->asleep_ms += asleep_ms < ms ? asleep_ms : ms;
+    for (int n = 0; n < PEDAL_POWER_LOADS; n++)
+        if (loads & (1u << n)) p->load_ms[n] += ms;
+}
+
+uint32_t pedal_power_ua(const pedal_power_t *p)
+{
+    if (!p->ms) return 0;
+    uint64_t uams = (p->ms - p->asleep_ms) * PEDAL_POWER_AWAKE_UA + p->asleep_ms * PEDAL_POWER_ASLEEP_UA;
+    for (int n = 0; n < PEDAL_POWER_LOADS; n++) uams += p->load_ms[n] * s_load_ua[n];
+    return (uint32_t)(uams / p->ms);
+}
+
+uint32_t pedal_power_asleep_pct(const pedal_power_t *p)
+{
+    return p->ms ? (uint32_t)(p->asleep_ms * 100 / p->ms) : 0;
+}
+
+uint32_t pedal_power_load_pct(const pedal_power_t *p, int load)
+{
+    return p->ms ? (uint32_t)(p->load_ms[load] * 100 / p->ms) : 0;
+}
@@ -0,0 +1,413 @@
+#include <string.h>
+#include "pedal_blob.h"
+#include "pedal_preset.h"
+
+#define SECTOR_MAGIC    0x5058424Du   // "MBXP"
+#define SECTOR_HDR      8
+#define COMMIT_WORD     0x54494D43u   // "CMIT"
+#define ERASED32        0xFFFFFFFFu
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    put16(p, v & 0xFFFF);
+    put16(p + 2, v >> 16);
+}
+
+static uint16_t get16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static uint32_t entry_size(uint32_t len)
+{
+    return PEDAL_PRESET_HDR_SIZE + ((len + 3) & ~3u);
+}
+
+static uint32_t sector_addr(uint32_t s)
+{
+    return s * PEDAL_PRESET_SECTOR;
+}
+
+// Live bytes allowed, leaving the spare sector free and room for one
+// maximum-size entry of slack at the end of every sector
+static uint32_t capacity(const pedal_preset_store_t *st)
+{
+    return (st->sectors - 2) * (PEDAL_PRESET_SECTOR - SECTOR_HDR - PEDAL_PRESET_ENTRY_MAX);
+}
+
+static uint32_t entry_crc(const uint8_t *hdr, const uint8_t *payload, uint16_t len)
+{
+    return pedal_crc32(pedal_crc32(0, hdr, 8), payload, len);
+}
+
+static bool sector_valid(pedal_preset_store_t *st, uint32_t s, uint32_t *seq)
+{
+    uint8_t hdr[SECTOR_HDR];
+    if (st->fl->read(st->fl->ctx, sector_addr(s), hdr, sizeof(hdr)) != 0) return false;
+    if (get32(hdr) != SECTOR_MAGIC) return false;
+    if (seq) *seq = get32(hdr + 4);
+    return true;
+}
+
+static bool erased(const uint8_t *p, size_t len)
+{
+    while (len--) {
+        if (*p++ != 0xFF) return false;
+    }
+    return true;
+}
+
+// Erases sector s unless it already reads back fully erased
+static int make_blank(pedal_preset_store_t *st, uint32_t s)
+{
+    for (uint32_t off = 0; off < PEDAL_PRESET_SECTOR; off += sizeof(st->buf)) {
+        if (st->fl->read(st->fl->ctx, sector_addr(s) + off, st->buf, sizeof(st->buf)) != 0) return PEDAL_PRESET_ERR_IO;
+        if (!erased(st->buf, sizeof(st->buf))) {
+            return st->fl->erase(st->fl->ctx, sector_addr(s)) ? PEDAL_PRESET_ERR_IO : PEDAL_PRESET_OK;
+        }
+    }
+    return PEDAL_PRESET_OK;
+}
+
+static int open_sector(pedal_preset_store_t *st, uint32_t s, uint32_t seq)
+{
+    uint8_t hdr[SECTOR_HDR];
+    put32(hdr, SECTOR_MAGIC);
+    put32(hdr + 4, seq);
+    if (st->fl->write(st->fl->ctx, sector_addr(s), hdr, sizeof(hdr)) != 0) return PEDAL_PRESET_ERR_IO;
+    st->head = s;
+    st->head_seq = seq;
+    st->head_off = SECTOR_HDR;
+    return PEDAL_PRESET_OK;
+}
+
+// Copies a committed entry to the head, keeping its sequence. Like a new
+// entry, the copy only counts once its commit word is written.
+static int relocate(pedal_preset_store_t *st, pedal_preset_slot_t *slot)
+{
+    if (st->head_off + slot->size > PEDAL_PRESET_SECTOR) return PEDAL_PRESET_ERR_FULL;
+    uint32_t dst = sector_addr(st->head) + st->head_off;
+    uint8_t chunk[64];
+    for (uint32_t off = 0; off < slot->size; off += sizeof(chunk)) {
+        uint32_t n = slot->size - off < sizeof(chunk) ? slot->size - off : sizeof(chunk);
+        if (st->fl->read(st->fl->ctx, slot->addr + off, chunk, n) != 0) return PEDAL_PRESET_ERR_IO;
+        if (off == 0) put32(chunk + 12, ERASED32);
+        if (st->fl->write(st->fl->ctx, dst + off, chunk, n) != 0) return PEDAL_PRESET_ERR_IO;
+    }
+    put32(chunk, COMMIT_WORD);
+    if (st->fl->write(st->fl->ctx, dst + 12, chunk, 4) != 0) return PEDAL_PRESET_ERR_IO;
+    slot->addr = dst;
+    st->head_off += slot->size;
+    return PEDAL_PRESET_OK;
+}
+
+// Moves whatever is still referenced out of sector s, then erases it
+static int reclaim(pedal_preset_store_t *st, uint32_t s)
+{
+    if (!sector_valid(st, s, NULL)) return PEDAL_PRESET_OK;
+    uint32_t lo = sector_addr(s), hi = lo + PEDAL_PRESET_SECTOR;
+    if (st->base_slot.addr >= lo && st->base_slot.addr < hi) {
+        int err = relocate(st, &st->base_slot);
+        if (err) return err;
+    }
+    for (int id = 0; id < PEDAL_PRESET_MAX; id++) {
+        pedal_preset_slot_t *slot = &st->slot[id];
+        if (slot->addr == PEDAL_PRESET_NONE || slot->addr < lo || slot->addr >= hi) continue;
+        int err = relocate(st, slot);
+        if (err) return err;
+    }
+    return st->fl->erase(st->fl->ctx, lo) ? PEDAL_PRESET_ERR_IO : PEDAL_PRESET_OK;
+}
+
+// Moves the head into the spare sector and turns the oldest one into the new spare
+static int advance(pedal_preset_store_t *st)
+{
+    int err = open_sector(st, (st->head + 1) % st->sectors, st->head_seq + 1);
+    if (err) return err;
+    return reclaim(st, (st->head + 1) % st->sectors);
+}
+
+static int append(pedal_preset_store_t *st, uint8_t type, uint8_t id, const uint8_t *payload, uint16_t len,
+                  uint32_t *addr)
+{
+    uint32_t size = entry_size(len);
+    for (uint32_t n = 0; st->head_off + size > PEDAL_PRESET_SECTOR; n++) {
+        if (n == st->sectors) return PEDAL_PRESET_ERR_FULL;
+        int err = advance(st);
+        if (err) return err;
+    }
+
+    uint8_t hdr[PEDAL_PRESET_HDR_SIZE];
+    hdr[0] = type;
+    hdr[1] = id;
+    put16(hdr + 2, len);
+    put32(hdr + 4, st->seq);
+    put32(hdr + 8, entry_crc(hdr, payload, len));
+    put32(hdr + 12, ERASED32);
+
+    uint32_t at = sector_addr(st->head) + st->head_off;
+    if (st->fl->write(st->fl->ctx, at, hdr, sizeof(hdr)) != 0) return PEDAL_PRESET_ERR_IO;
+    if (len && st->fl->write(st->fl->ctx, at + PEDAL_PRESET_HDR_SIZE, payload, len) != 0) return PEDAL_PRESET_ERR_IO;
+    put32(hdr, COMMIT_WORD);
+    if (st->fl->write(st->fl->ctx, at + 12, hdr, 4) != 0) return PEDAL_PRESET_ERR_IO;
+
+    st->head_off += size;
+    st->seq++;
+    *addr = at;
+    return PEDAL_PRESET_OK;
+}
+
+// Reads the entry at addr into st->buf and checks it. Returns the payload length or -1.
+static int read_entry(pedal_preset_store_t *st, uint32_t addr)
+{
+    uint8_t *h = st->buf;
+    if (st->fl->read(st->fl->ctx, addr, h, PEDAL_PRESET_HDR_SIZE) != 0) return -1;
+    uint16_t len = get16(h + 2);
+    if (len > PEDAL_PRESET_ENTRY_MAX - PEDAL_PRESET_HDR_SIZE || get32(h + 12) != COMMIT_WORD) return -1;
+    if (st->fl->read(st->fl->ctx, addr + PEDAL_PRESET_HDR_SIZE, h + PEDAL_PRESET_HDR_SIZE, len) != 0) return -1;
+    if (entry_crc(h, h + PEDAL_PRESET_HDR_SIZE, len) != get32(h + 8)) return -1;
+    return len;
+}
+
+static void index_entry(pedal_preset_store_t *st, uint32_t addr, int len)
+{
+    const uint8_t *h = st->buf, *payload = h + PEDAL_PRESET_HDR_SIZE;
+    uint32_t seq = get32(h + 4);
+    if (seq >= st->seq) st->seq = seq + 1;
+
+    pedal_preset_slot_t *slot;
+    if (h[0] == PEDAL_PRESET_E_BASE) slot = &st->base_slot;
+    else if (h[1] < PEDAL_PRESET_MAX) slot = &st->slot[h[1]];
+    else return;
+    // Equal sequence: a relocated copy, found after its original
+    if (seq < slot->seq) return;
+
+    slot->seq = seq;
+    slot->size = entry_size(len);
+    slot->addr = (h[0] == PEDAL_PRESET_E_DELETE) ? PEDAL_PRESET_NONE : addr;
+    if (h[0] == PEDAL_PRESET_E_PRESET && len > 0 && payload[0] <= PEDAL_PRESET_NAME_MAX && payload[0] < len) {
+        memcpy(slot->name, payload + 1, payload[0]);
+        slot->name[payload[0]] = '\0';
+    }
+}
+
+static bool rest_erased(pedal_preset_store_t *st, uint32_t s, uint32_t off)
+{
+    while (off < PEDAL_PRESET_SECTOR) {
+        uint32_t n = PEDAL_PRESET_SECTOR - off < sizeof(st->buf) ? PEDAL_PRESET_SECTOR - off : sizeof(st->buf);
+        if (st->fl->read(st->fl->ctx, sector_addr(s) + off, st->buf, n) != 0 || !erased(st->buf, n)) return false;
+        off += n;
+    }
+    return true;
+}
+
+// Indexes every committed entry of sector s; returns where the free space
+// starts. After a torn write the scan resyncs word by word, so entries
+// written behind the garbage are still found and new ones never land on it.
+static uint32_t scan_sector(pedal_preset_store_t *st, uint32_t s)
+{
+    uint32_t off = SECTOR_HDR;
+    bool torn = false;
+    while (off + PEDAL_PRESET_HDR_SIZE <= PEDAL_PRESET_SECTOR) {
+        uint32_t addr = sector_addr(s) + off;
+        if (st->fl->read(st->fl->ctx, addr, st->buf, PEDAL_PRESET_HDR_SIZE) != 0) return PEDAL_PRESET_SECTOR;
+        if (erased(st->buf, PEDAL_PRESET_HDR_SIZE)) {
+            if (!torn || rest_erased(st, s, off)) return off;
+        } else {
+            uint32_t len = get16(st->buf + 2);
+            if (len <= PEDAL_PRESET_ENTRY_MAX - PEDAL_PRESET_HDR_SIZE && off + entry_size(len) <= PEDAL_PRESET_SECTOR) {
+                int n = read_entry(st, addr);
+                if (n >= 0) {
+                    index_entry(st, addr, n);
+                    off += entry_size(len);
+                    continue;
+                }
+            }
+            torn = true;
+        }
+        off += 4;
+    }
+    return PEDAL_PRESET_SECTOR;
+}
+
+static int format(pedal_preset_store_t *st)
+{
+    for (uint32_t s = 0; s < st->sectors; s++) {
+        int err = make_blank(st, s);
+        if (err) return err;
+    }
+    st->seq = 1;
+    return open_sector(st, 0, 1);
+}
+
+int pedal_preset_mount(pedal_preset_store_t *st, const pedal_flash_t *fl)
+{
+    memset(st, 0, sizeof(*st));
+    st->fl = fl;
+    st->sectors = fl->size / PEDAL_PRESET_SECTOR;
+    if (st->sectors < PEDAL_PRESET_MIN_SECTORS) return PEDAL_PRESET_ERR_IO;
+    st->base_slot.addr = PEDAL_PRESET_NONE;
+    for (int id = 0; id < PEDAL_PRESET_MAX; id++) st->slot[id].addr = PEDAL_PRESET_NONE;
+
+    bool found = false;
+    for (uint32_t s = 0; s < st->sectors; s++) {
+        uint32_t seq;
+        if (!sector_valid(st, s, &seq) || (found && seq <= st->head_seq)) continue;
+        found = true;
+        st->head = s;
+        st->head_seq = seq;
+    }
+    if (!found) return format(st);
+
+    // Oldest sector first, so relocated copies override their originals
+    st->seq = 1;
+    for (uint32_t k = 1; k <= st->sectors; k++) {
+        uint32_t s = (st->head + k) % st->sectors;
+        if (sector_valid(st, s, NULL)) {
+            uint32_t end = scan_sector(st, s);
+            if (s == st->head) st->head_off = end;
+        } else {
+            int err = make_blank(st, s);
+            if (err) return err;
+        }
+    }
+
+    st->live = st->base_slot.addr != PEDAL_PRESET_NONE ? st->base_slot.size : 0;
+    for (int id = 0; id < PEDAL_PRESET_MAX; id++) {
+        if (st->slot[id].addr != PEDAL_PRESET_NONE) st->live += st->slot[id].size;
+    }
+    if (st->base_slot.addr != PEDAL_PRESET_NONE) {
+        int len = read_entry(st, st->base_slot.addr);
+        if (len < 0 || pedal_blob_unpack(&st->base, st->buf + PEDAL_PRESET_HDR_SIZE, len) != 0) {
+            return PEDAL_PRESET_ERR_IO;
+        }
+    }
+
+    // A reset during reclaim leaves the spare sector holding data
+    return reclaim(st, (st->head + 1) % st->sectors);
+}
+
+static uint8_t *encode_delta(const pedal_config_t *base, const pedal_config_t *cfg, uint8_t *p)
+{
+    uint8_t a[PEDAL_REC_MAX_SIZE], b[PEDAL_REC_MAX_SIZE];
+    for (int rec = 0; rec < PEDAL_REC_COUNT; rec++) {
+        size_t n = pedal_record_pack(base, rec, a);
+        pedal_record_pack(cfg, rec, b);
+        uint32_t mask = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (a[i] != b[i]) mask |= 1u << i;
+        }
+        if (!mask) continue;
+        *p++ = rec;
+        *p++ = mask & 0xFF;
+        *p++ = (mask >> 8) & 0xFF;
+        *p++ = mask >> 16;
+        for (size_t i = 0; i < n; i++) {
+            if (mask & (1u << i)) *p++ = b[i];
+        }
+    }
+    return p;
+}
+
+static int apply_delta(pedal_config_t *cfg, const uint8_t *p, const uint8_t *end)
+{
+    uint8_t rec_buf[PEDAL_REC_MAX_SIZE];
+    while (p < end) {
+        if (end - p < 4 || p[0] >= PEDAL_REC_COUNT) return -1;
+        int rec = p[0];
+        uint32_t mask = p[1] | (p[2] << 8) | ((uint32_t)p[3] << 16);
+        p += 4;
+        size_t n = pedal_record_pack(cfg, rec, rec_buf);
+        for (size_t i = 0; i < n; i++) {
+            if (!(mask & (1u << i))) continue;
+            if (p >= end) return -1;
+            rec_buf[i] = *p++;
+        }
+        pedal_record_unpack(cfg, rec, rec_buf, n);
+    }
+    return 0;
+}
+
+int pedal_preset_save(pedal_preset_store_t *st, int id, const char *name, const pedal_config_t *cfg)
+{
+    if (id < 0 || id >= PEDAL_PRESET_MAX) return PEDAL_PRESET_ERR_ID;
+
+    if (st->base_slot.addr == PEDAL_PRESET_NONE) {
+        size_t len = pedal_blob_pack(cfg, st->buf, sizeof(st->buf));
+        if (st->live + entry_size(len) > capacity(st)) return PEDAL_PRESET_ERR_FULL;
+        int err = append(st, PEDAL_PRESET_E_BASE, 0, st->buf, len, &st->base_slot.addr);
+        if (err) return err;
+        st->base_slot.seq = st->seq - 1;
+        st->base_slot.size = entry_size(len);
+        st->live += st->base_slot.size;
+        st->base = *cfg;
+        pedal_blob_unpack(&st->base, st->buf, len);
+    }
+
+    size_t name_len = strnlen(name, PEDAL_PRESET_NAME_MAX);
+    uint8_t *p = st->buf;
+    *p++ = name_len;
+    memcpy(p, name, name_len);
+    p = encode_delta(&st->base, cfg, p + name_len);
+    uint16_t len = p - st->buf;
+
+    pedal_preset_slot_t *slot = &st->slot[id];
+    uint32_t old = slot->addr != PEDAL_PRESET_NONE ? slot->size : 0;
+    if (st->live - old + entry_size(len) > capacity(st)) return PEDAL_PRESET_ERR_FULL;
+    uint32_t addr;
+    int err = append(st, PEDAL_PRESET_E_PRESET, id, st->buf, len, &addr);
+    if (err) return err;
+
+    st->live += entry_size(len) - old;
+    slot->addr = addr;
+    slot->seq = st->seq - 1;
+    slot->size = entry_size(len);
+    memcpy(slot->name, name, name_len);
+    slot->name[name_len] = '\0';
+    return PEDAL_PRESET_OK;
+}
+
+int pedal_preset_load(pedal_preset_store_t *st, int id, pedal_config_t *cfg)
+{
+    if (id < 0 || id >= PEDAL_PRESET_MAX || st->slot[id].addr == PEDAL_PRESET_NONE) return PEDAL_PRESET_ERR_ID;
+    int len = read_entry(st, st->slot[id].addr);
+    if (len < 1) return PEDAL_PRESET_ERR_IO;
+    const uint8_t *payload = st->buf + PEDAL_PRESET_HDR_SIZE;
+    if (payload[0] >= len) return PEDAL_PRESET_ERR_IO;
+
+    pedal_config_t out = st->base;
+    if (apply_delta(&out, payload + 1 + payload[0], payload + len) != 0) return PEDAL_PRESET_ERR_IO;
+    *cfg = out;
+    return PEDAL_PRESET_OK;
+}
+
+int pedal_preset_delete(pedal_preset_store_t *st, int id)
+{
+    if (id < 0 || id >= PEDAL_PRESET_MAX || st->slot[id].addr == PEDAL_PRESET_NONE) return PEDAL_PRESET_ERR_ID;
+    uint32_t addr;
+    int err = append(st, PEDAL_PRESET_E_DELETE, id, NULL, 0, &addr);
+    if (err) return err;
+    pedal_preset_slot_t *slot = &st->slot[id];
+    st->live -= slot->size;
+    slot->addr = PEDAL_PRESET_NONE;
+    slot->seq = st->seq - 1;
+    slot->name[0] = '\0';
+    return PEDAL_PRESET_OK;
+}
+
+const char *pedal_preset_name(const pedal_preset_store_t *st, int id)
+{
+    if (id < 0 || id >= PEDAL_PRESET_MAX || st->slot[id].addr == PEDAL_PRESET_NONE) return NULL;
+    return st->slot[id].name;
+}
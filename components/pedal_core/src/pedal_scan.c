@@ -0,0 +1,69 @@
+#include <string.h>
+#include "pedal_scan.h"
+
+#define EDGE_MASK (PEDAL_SCAN_EDGES - 1)
+
+void pedal_scan_init(pedal_scan_t *s, uint32_t rate_hz, uint32_t debounce_ms)
+{
+    memset(s, 0, sizeof(*s));
+    s->period_us = 1000000u / (rate_hz * PEDAL_SCAN_ROWS);
+    uint32_t lockout = (debounce_ms * rate_hz + 999) / 1000;
+    s->lockout = lockout > UINT16_MAX ? UINT16_MAX : lockout;
+}
+
+static bool push(pedal_scan_t *s, uint32_t now_us, uint8_t sw, bool down)
+{
+    uint32_t head = s->head;
+    if (head - __atomic_load_n(&s->tail, __ATOMIC_ACQUIRE) == PEDAL_SCAN_EDGES) {
+        s->dropped++;
+        return false;
+    }
+    s->ev[head & EDGE_MASK] = (pedal_scan_edge_t){ .us = now_us, .sw = sw, .down = down };
+    __atomic_store_n(&s->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool pedal_scan_row(pedal_scan_t *s, uint32_t now_us, uint8_t cols)
+{
+    if (s->jitter.samples++ && !s->resumed) {
+        uint32_t d = now_us - s->last_us;
+        uint32_t dev = d > s->period_us ? d - s->period_us : s->period_us - d;
+        s->jitter.hist[pedal_scan_jitter_bucket(dev)]++;
+        if (dev > s->jitter.worst_us) s->jitter.worst_us = dev;
+    }
+    s->last_us = now_us;
+    s->resumed = false;
+
+    bool queued = false;
+    uint8_t first = s->row * PEDAL_SCAN_COLS;
+    for (uint8_t c = 0; c < PEDAL_SCAN_COLS; c++) {
+        uint8_t sw = first + c;
+        if (s->hold[sw]) {
+            s->hold[sw]--;
+            continue;
+        }
+        bool down = (cols >> c) & 1;
+        if (down == ((s->state >> sw) & 1)) continue;
+        // Ring full: leave the switch as it was, the next scan of the row retries
+        if (!push(s, now_us, sw, down)) continue;
+        s->state ^= 1u << sw;
+        s->hold[sw] = s->lockout;
+        queued = true;
+    }
+    s->row = (s->row + 1) % PEDAL_SCAN_ROWS;
+    return queued;
+}
+
+void pedal_scan_resume(pedal_scan_t *s)
+{
+    s->resumed = true;
+}
+
+bool pedal_scan_pop(pedal_scan_t *s, pedal_scan_edge_t *e)
+{
+    uint32_t tail = s->tail;
+    if (__atomic_load_n(&s->head, __ATOMIC_ACQUIRE) == tail) return false;
+    *e = s->ev[tail & EDGE_MASK];
+    __atomic_store_n(&s->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
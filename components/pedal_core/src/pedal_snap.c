@@ -0,0 +1,43 @@
+#include "pedal_snap.h"
+
+/*
+ * The reader stores held and then loads live; the writer stores live and
+ * then loads held. Both are sequentially consistent, so at least one side
+ * sees the other's store: either the reader notices the swap and moves on
+ * to the new snapshot, or the writer sees the old one held.
+ */
+
+void pedal_snap_init(pedal_snap_t *s, void *first, void *second)
+{
+    s->buf[0] = first;
+    s->buf[1] = second;
+    s->live = first;
+    s->held = NULL;
+}
+
+const void *pedal_snap_acquire(pedal_snap_t *s)
+{
+    void *p = __atomic_load_n(&s->live, __ATOMIC_SEQ_CST);
+    for (;;) {
+        __atomic_store_n(&s->held, p, __ATOMIC_SEQ_CST);
+        void *now = __atomic_load_n(&s->live, __ATOMIC_SEQ_CST);
+        if (now == p) return p;
+        p = now;
+    }
+}
+
+void pedal_snap_release(pedal_snap_t *s)
+{
+    __atomic_store_n(&s->held, NULL, __ATOMIC_RELEASE);
+}
+
+void *pedal_snap_spare(pedal_snap_t *s)
+{
+    void *spare = s->live == s->buf[0] ? s->buf[1] : s->buf[0];
+    return __atomic_load_n(&s->held, __ATOMIC_SEQ_CST) == spare ? NULL : spare;
+}
+
+void pedal_snap_publish(pedal_snap_t *s, void *next)
+{
+    __atomic_store_n(&s->live, next, __ATOMIC_SEQ_CST);
+}
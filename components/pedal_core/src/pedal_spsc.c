@@ -0,0 +1,54 @@
+#include "pedal_spsc.h"
+
+#define LATEST_FRESH 0x80
+
+void pedal_spsc_init(pedal_spsc_t *r, uint32_t len)
+{
+    r->head = r->tail = 0;
+    r->len = len;
+}
+
+int pedal_spsc_slot(const pedal_spsc_t *r)
+{
+    uint32_t head = r->head;
+    if (head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) == r->len) return -1;
+    return head & (r->len - 1);
+}
+
+void pedal_spsc_push(pedal_spsc_t *r)
+{
+    // Publish the record before the new head
+    __atomic_store_n(&r->head, r->head + 1, __ATOMIC_RELEASE);
+}
+
+int pedal_spsc_front(const pedal_spsc_t *r)
+{
+    uint32_t tail = r->tail;
+    if (__atomic_load_n(&r->head, __ATOMIC_ACQUIRE) == tail) return -1;
+    return tail & (r->len - 1);
+}
+
+void pedal_spsc_pop(pedal_spsc_t *r)
+{
+    // Done reading before the slot is handed back
+    __atomic_store_n(&r->tail, r->tail + 1, __ATOMIC_RELEASE);
+}
+
+void pedal_latest_init(pedal_latest_t *x)
+{
+    *x = (pedal_latest_t)PEDAL_LATEST_INITIALIZER;
+}
+
+void pedal_latest_publish(pedal_latest_t *x)
+{
+    uint8_t old = __atomic_exchange_n(&x->mid, x->back | LATEST_FRESH, __ATOMIC_ACQ_REL);
+    x->back = old & ~LATEST_FRESH;
+}
+
+bool pedal_latest_take(pedal_latest_t *x)
+{
+    if (!(__atomic_load_n(&x->mid, __ATOMIC_ACQUIRE) & LATEST_FRESH)) return false;
+    uint8_t old = __atomic_exchange_n(&x->mid, x->front, __ATOMIC_ACQ_REL);
+    x->front = old & ~LATEST_FRESH;
+    return true;
+}
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pedal_status.h"
+
+enum {
+    F_BANK = 1 << 0,
+    F_SW = 1 << 1,
+    F_BAT = 1 << 2,
+    F_EXP = 1 << 3,
+    F_SAVED = 1 << 4,
+    F_BLE = 1 << 5,
+    F_LINKS = 1 << 6,
+    F_JACK = 1 << 7,
+    F_RATE = 1 << 8,
+    F_ALL = F_BANK | F_SW | F_BAT | F_EXP | F_SAVED | F_BLE | F_LINKS | F_JACK | F_RATE,
+};
+
+static size_t write_fields(const pedal_status_t *cur, unsigned fields, char *buf, size_t cap)
+{
+    size_t n = 0;
+    char sep = '{';
+    if (fields & F_BANK) {
+        n += snprintf(buf + n, cap - n, "%c\"bank\":%u", sep, cur->bank);
+        sep = ',';
+    }
+    if ((fields & F_SW) && n < cap) {
+        n += snprintf(buf + n, cap - n, "%c\"sw\":%u", sep, cur->sw);
+        sep = ',';
+    }
+    if ((fields & F_BAT) && n < cap) {
+        n += snprintf(buf + n, cap - n, "%c\"bat\":%u.%02u", sep, cur->bat_mv / 1000, (cur->bat_mv % 1000) / 10);
+        sep = ',';
+    }
+    if ((fields & F_EXP) && n < cap) {
+        n += snprintf(buf + n, cap - n, "%c\"exp_raw\":%u,\"exp\":%u", sep, cur->exp_raw, cur->exp_out);
+        sep = ',';
+    }
+    if ((fields & F_JACK) && n < cap) {
+        n += snprintf(buf + n, cap - n, "%c\"jack\":%u", sep, cur->jack);
+        sep = ',';
+    }
+    if ((fields & F_RATE) && n < cap) {
+        n += snprintf(buf + n, cap - n, "%c\"exp_usb_hz\":%u,\"exp_ble_hz\":%u", sep, cur->exp_usb_hz,
+                      cur->exp_ble_hz);
+        sep = ',';
+    }
+    if ((fields & F_SAVED) && n < cap) {
+        n += snprintf(buf + n, cap - n, "%c\"saved\":%lu", sep, (unsigned long)cur->saved);
+        sep = ',';
+    }
+    if ((fields & F_BLE) && n < cap) {
+        n += snprintf(buf + n, cap - n, "%c\"ble_msgs\":%lu,\"ble_pkts\":%lu", sep, (unsigned long)cur->ble_msgs,
+                      (unsigned long)cur->ble_pkts);
+        sep = ',';
+    }
+    if ((fields & F_LINKS) && n < cap) {
+        n += snprintf(buf + n, cap - n, "%c\"links\":[", sep);
+        for (int i = 0; i < cur->ble_links && n < cap; i++) {
+            const pedal_ble_link_t *l = &cur->ble[i];
+            n += snprintf(buf + n, cap - n, "%s{\"int_us\":%lu,\"lat\":%u,\"mtu\":%u,\"phy\":%u,\"worst_us\":%lu,\"dropped\":%lu}",
+                          i ? "," : "", (unsigned long)l->interval_us, l->latency, l->mtu, l->phy,
+                          (unsigned long)l->worst_us, (unsigned long)l->dropped);
+        }
+        if (n < cap) n += snprintf(buf + n, cap - n, "]");
+    }
+    if (n + 2 > cap) return 0;
+    buf[n++] = '}';
+    buf[n] = 0;
+    return n;
+}
+
+void pedal_status_stream_reset(pedal_status_stream_t *st)
+{
+    st->synced = false;
+}
+
+size_t pedal_status_json(const pedal_status_t *cur, char *buf, size_t cap)
+{
+    return write_fields(cur, F_ALL, buf, cap);
+}
+
+size_t pedal_status_delta(pedal_status_stream_t *st, const pedal_status_t *cur, uint32_t now_ms, char *buf, size_t cap)
+{
+    unsigned fields = F_ALL;
+    if (st->synced) {
+        fields = 0;
+        if (cur->bank != st->sent.bank) fields |= F_BANK;
+        if (cur->sw != st->sent.sw || cur->bank != st->sent.bank) fields |= F_SW;
+        if (abs((int)cur->bat_mv - (int)st->sent.bat_mv) >= PEDAL_STATUS_BAT_DEADBAND_MV) fields |= F_BAT;
+        if ((cur->exp_raw != st->sent.exp_raw || cur->exp_out != st->sent.exp_out) &&
+            (uint32_t)(now_ms - st->exp_sent_ms) >= PEDAL_STATUS_EXP_INTERVAL_MS) fields |= F_EXP;
+        if (cur->jack != st->sent.jack) fields |= F_JACK;
+        if (cur->saved != st->sent.saved) fields |= F_SAVED;
+        if (cur->ble_links != st->sent.ble_links ||
+            memcmp(cur->ble, st->sent.ble, cur->ble_links * sizeof(cur->ble[0])) != 0) fields |= F_LINKS;
+        if (cur->ble_pkts != st->sent.ble_pkts &&
+            (uint32_t)(now_ms - st->stats_sent_ms) >= PEDAL_STATUS_STATS_INTERVAL_MS) fields |= F_BLE;
+        if ((cur->exp_usb_hz != st->sent.exp_usb_hz || cur->exp_ble_hz != st->sent.exp_ble_hz) &&
+            (uint32_t)(now_ms - st->rate_sent_ms) >= PEDAL_STATUS_STATS_INTERVAL_MS) fields |= F_RATE;
+        if (!fields) return 0;
+    }
+
+    size_t n = write_fields(cur, fields, buf, cap);
+    if (!n) return 0;
+    if (fields & F_BANK) st->sent.bank = cur->bank;
+    if (fields & F_SW) st->sent.sw = cur->sw;
+    if (fields & F_BAT) st->sent.bat_mv = cur->bat_mv;
+    if (fields & F_EXP) {
+        st->sent.exp_raw = cur->exp_raw;
+        st->sent.exp_out = cur->exp_out;
+        st->exp_sent_ms = now_ms;
+    }
+    if (fields & F_JACK) st->sent.jack = cur->jack;
+    if (fields & F_RATE) {
+        st->sent.exp_usb_hz = cur->exp_usb_hz;
+        st->sent.exp_ble_hz = cur->exp_ble_hz;
+        st->rate_sent_ms = now_ms;
+    }
+    if (fields & F_SAVED) st->sent.saved = cur->saved;
+    if (fields & F_LINKS) {
+        st->sent.ble_links = cur->ble_links;
+        memcpy(st->sent.ble, cur->ble, sizeof(cur->ble));
+    }
+    if (fields & F_BLE) {
+        st->sent.ble_msgs = cur->ble_msgs;
+        st->sent.ble_pkts = cur->ble_pkts;
+        st->stats_sent_ms = now_ms;
+    }
+    st->synced = true;
+    return n;
+}
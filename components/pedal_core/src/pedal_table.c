@@ -0,0 +1,78 @@
+#include <string.h>
+#include "pedal_table.h"
+
+// Message polarity: the press and long-press slots are sent "on" (Note On
+// velocity 127, CC value 127); the release slot, and the press action replayed
+// as an implicit release when no release action is set, are sent "off"
+// (velocity 0, CC value 0). PC and Note Off have no implicit off form.
+static pedal_midi_msg_t build_msg(const pedal_action_t *a, bool on, bool implicit)
+{
+    pedal_midi_msg_t m = { 0 };
+    switch (a->type) {
+    case PEDAL_TYPE_NOTE_ON:
+    case PEDAL_TYPE_CC:
+        m.len = 3;
+        m.data[0] = a->type | a->ch;
+        m.data[1] = a->val;
+        m.data[2] = on ? 127 : 0;
+        break;
+    case PEDAL_TYPE_NOTE_OFF:
+        if (implicit) break;
+        m.len = 3;
+        m.data[0] = PEDAL_TYPE_NOTE_OFF | a->ch;
+        m.data[1] = a->val;
+        break;
+    case PEDAL_TYPE_PC:
+        if (implicit) break;
+        m.len = 2;
+        m.data[0] = PEDAL_TYPE_PC | a->ch;
+        m.data[1] = a->val;
+        break;
+    default:
+        break;
+    }
+    return m;
+}
+
+// Switches other than self whose mask (selected by the caller) hits groups.
+static uint8_t members(const pedal_bank_t *bank, uint8_t self, uint8_t groups, bool by_incl)
+{
+    uint8_t set = 0;
+    if (!groups) return 0;
+    for (uint8_t j = 0; j < PEDAL_NUM_SWITCHES; j++) {
+        uint8_t mask = by_incl ? bank->sw[j].incl : bank->sw[j].excl[PEDAL_TRIG_PRESS];
+        if (j != self && (mask & groups)) set |= 1u << j;
+    }
+    return set;
+}
+
+void pedal_table_compile(pedal_table_t *tbl, const pedal_config_t *cfg)
+{
+    memset(tbl, 0, sizeof(*tbl));
+    for (uint8_t b = 0; b < PEDAL_NUM_BANKS; b++) {
+        const pedal_bank_t *bank = &cfg->banks[b];
+        pedal_curve_compile(tbl->exp[b], &bank->exp);
+        for (uint8_t i = 0; i < PEDAL_NUM_SWITCHES; i++) {
+            const pedal_switch_t *s = &bank->sw[i];
+            pedal_sw_entry_t *e = &tbl->sw[b][i];
+            e->flags = s->flags;
+            if (s->act[PEDAL_TRIG_PRESS].type >= PEDAL_TYPE_BANK_REV) {
+                // Bank switches only change the page; their masks are inert.
+                e->bank_type = s->act[PEDAL_TRIG_PRESS].type;
+                continue;
+            }
+            e->on[0] = build_msg(&s->act[PEDAL_TRIG_PRESS], true, false);
+            e->on[1] = build_msg(&s->act[PEDAL_TRIG_LONG], true, false);
+            if (s->act[PEDAL_TRIG_RELEASE].type != PEDAL_TYPE_NONE) e->off = build_msg(&s->act[PEDAL_TRIG_RELEASE], false, false);
+            else e->off = build_msg(&s->act[PEDAL_TRIG_PRESS], false, true);
+
+            e->force_on[0] = members(bank, i, s->lead[PEDAL_TRIG_PRESS], true);
+            e->force_on[1] = members(bank, i, s->lead[PEDAL_TRIG_LONG], true);
+            e->force_off[0] = members(bank, i, s->excl[PEDAL_TRIG_PRESS], false);
+            e->force_off[1] = members(bank, i, s->excl[PEDAL_TRIG_LONG], false);
+            // Turning a lead switch off releases every group it leads.
+            e->force_off[2] = members(bank, i, s->excl[PEDAL_TRIG_RELEASE], false) |
+                              members(bank, i, s->lead[PEDAL_TRIG_PRESS] | s->lead[PEDAL_TRIG_RELEASE], true);
+        }
+    }
+}
@@ -0,0 +1,30 @@
+#include "pedal_ump.h"
+
+bool pedal_ump_midi1(uint8_t group, const pedal_midi_msg_t *msg, uint32_t *word)
+{
+    if (!msg->len || msg->data[0] < 0x80 || msg->data[0] >= 0xF0) return false;
+    *word = 0x20000000u | (uint32_t)(group & 0xF) << 24 | (uint32_t)msg->data[0] << 16 |
+            (uint32_t)(msg->len > 1 ? msg->data[1] : 0) << 8 | (msg->len > 2 ? msg->data[2] : 0);
+    return true;
+}
+
+void pedal_ump_cc(uint8_t group, uint8_t ch, uint8_t cc, uint32_t value, uint32_t ump[2])
+{
+    ump[0] = 0x40000000u | (uint32_t)(group & 0xF) << 24 | (uint32_t)(0xB0 | (ch & 0xF)) << 16 |
+             (uint32_t)(cc & 0x7F) << 8;
+    ump[1] = value;
+}
+
+uint32_t pedal_ump_scale14(uint16_t v)
+{
+    v &= 0x3FFF;
+    uint32_t out = (uint32_t)v << 18;
+    if (v <= 0x2000) return out;
+    // Repeat the 13 bits below the top one into the low end
+    uint32_t rep = (uint32_t)(v & 0x1FFF) << 5;
+    while (rep) {
+        out |= rep;
+        rep >>= 13;
+    }
+    return out;
+}
@@ -0,0 +1,102 @@
+#include "pedal_usb_ring.h"
+
+#define RING_MASK (PEDAL_USB_RING_LEN - 1)
+
+bool pedal_usb_event(const pedal_midi_msg_t *msg, uint8_t ev[PEDAL_USB_EVENT_SIZE])
+{
+    if (!msg->len) return false;
+    uint8_t status = msg->data[0];
+    uint8_t cin;
+    if (status >= 0x80 && status < 0xF0) {
+        cin = status >> 4;                       // channel voice: CIN = message type
+    } else if (status >= 0xF8) {
+        cin = 0xF;                               // real time, single byte
+    } else if (status == 0xF1 || status == 0xF3) {
+        cin = 0x2;
+    } else if (status == 0xF2) {
+        cin = 0x3;
+    } else if (status == 0xF6) {
+        cin = 0x5;
+    } else {
+        return false;                            // SysEx is never produced here
+    }
+    ev[0] = cin;
+    ev[1] = status;
+    ev[2] = msg->len > 1 ? msg->data[1] : 0;
+    ev[3] = msg->len > 2 ? msg->data[2] : 0;
+    return true;
+}
+
+static void put_word(uint8_t *ev, uint32_t w)
+{
+    ev[0] = w;
+    ev[1] = w >> 8;
+    ev[2] = w >> 16;
+    ev[3] = w >> 24;
+}
+
+bool pedal_usb_ring_push(pedal_usb_ring_t *r, const pedal_midi_msg_t *msg, const pedal_lat_stamp_t *stamp)
+{
+    if (r->ump) {
+        uint32_t w;
+        return pedal_ump_midi1(0, msg, &w) && pedal_usb_ring_push_ump(r, &w, 1, stamp);
+    }
+    uint32_t head = r->head;
+    uint32_t used = head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+    if (used == PEDAL_USB_RING_LEN) {
+        r->dropped++;
+        return false;
+    }
+    if (!pedal_usb_event(msg, r->ev[head & RING_MASK])) return false;
+    r->stamp[head & RING_MASK] = stamp ? *stamp : (pedal_lat_stamp_t){ 0 };
+    r->more[head & RING_MASK] = 0;
+    if (used + 1 > r->high_water) r->high_water = used + 1;
+    // Publish the event before the new head
+    __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool pedal_usb_ring_push_ump(pedal_usb_ring_t *r, const uint32_t *words, size_t n, const pedal_lat_stamp_t *stamp)
+{
+    uint32_t head = r->head;
+    uint32_t used = head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+    // A message that would wrap starts after no-op padding instead
+    uint32_t to_end = PEDAL_USB_RING_LEN - (head & RING_MASK);
+    uint32_t pad = n > to_end ? to_end : 0;
+    if (!n || used + pad + n > PEDAL_USB_RING_LEN) {
+        r->dropped++;
+        return false;
+    }
+    for (uint32_t k = 0; k < pad + n; k++) {
+        uint32_t i = (head + k) & RING_MASK;
+        put_word(r->ev[i], k < pad ? PEDAL_UMP_NOOP : words[k - pad]);
+        r->stamp[i] = k == pad && stamp ? *stamp : (pedal_lat_stamp_t){ 0 };
+        r->more[i] = k >= pad && k + 1 < pad + n;
+    }
+    used += pad + n;
+    if (used > r->high_water) r->high_water = used;
+    __atomic_store_n(&r->head, head + pad + n, __ATOMIC_RELEASE);
+    return true;
+}
+
+size_t pedal_usb_ring_peek(pedal_usb_ring_t *r, const uint8_t **span, size_t max)
+{
+    uint32_t tail = r->tail;
+    uint32_t avail = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) - tail;
+    uint32_t to_end = PEDAL_USB_RING_LEN - (tail & RING_MASK);
+    size_t n = avail < to_end ? avail : to_end;
+    if (n > max) n = max;
+    while (n && r->more[(tail + n - 1) & RING_MASK]) n--;
+    *span = r->ev[tail & RING_MASK];
+    return n;
+}
+
+void pedal_usb_ring_consume(pedal_usb_ring_t *r, size_t n, size_t offered)
+{
+    if (offered) {
+        r->transfers++;
+        r->events += n;
+        if (n < offered) r->stalls++;
+    }
+    __atomic_store_n(&r->tail, r->tail + n, __ATOMIC_RELEASE);
+}
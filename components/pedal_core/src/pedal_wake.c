@@ -0,0 +1,41 @@
+#include <stddef.h>
+#include "pedal_blob.h"
+#include "pedal_wake.h"
+
+#define BODY_OFFSET offsetof(pedal_wake_t, cfg)
+
+static uint32_t body_crc(const pedal_wake_t *w)
+{
+    return pedal_crc32(0, (const uint8_t *)w + BODY_OFFSET, sizeof(*w) - BODY_OFFSET);
+}
+
+void pedal_wake_seal(pedal_wake_t *w, const pedal_config_t *cfg, const pedal_logic_t *lg, uint16_t exp)
+{
+    // Invalid until the CRC is in, should the pedal reset in between
+    w->magic = 0;
+    w->size = sizeof(*w);
+    w->cfg = *cfg;
+    w->exp = exp;
+    w->bank = lg->bank;
+    for (int b = 0; b < PEDAL_NUM_BANKS; b++) w->state[b] = lg->state[b];
+    // A momentary held down right now would come back on with nobody on it
+    for (uint8_t armed = lg->armed; armed; armed &= armed - 1) {
+        uint8_t sw = __builtin_ctz(armed);
+        w->state[lg->press_bank[sw]] &= ~(1u << sw);
+    }
+    w->crc = body_crc(w);
+    w->magic = PEDAL_WAKE_MAGIC;
+}
+
+int pedal_wake_check(const pedal_wake_t *w)
+{
+    if (w->magic != PEDAL_WAKE_MAGIC || w->size != sizeof(*w) || w->bank >= PEDAL_NUM_BANKS) return -1;
+    return w->crc == body_crc(w) ? 0 : -1;
+}
+
+void pedal_wake_resume(const pedal_wake_t *w, pedal_logic_t *lg)
+{
+    lg->bank = w->bank;
+    for (int b = 0; b < PEDAL_NUM_BANKS; b++) lg->state[b] = w->state[b];
+    lg->held = lg->armed = lg->long_fired = 0;
+}
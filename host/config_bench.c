@@ -0,0 +1,196 @@
+// Settings document vs packed blob: size, load cost and round-trip check.
+//
+//   config_bench <settings.json> [-n iters]
+//
+// Fails if the blob does not round-trip to the same compiled table, if a
+// corrupted blob is accepted, if a version 1 blob (no curves) or a
+// version 2 blob (no expression budgets) no longer loads, or if base blob + dirty records written by a patch do not
+// reproduce the patched config. Also checks that a burst of
+// saves through the commit queue becomes a single write of the final config.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bench_util.h"
+#include "pedal_blob.h"
+#include "pedal_commit.h"
+#include "pedal_config.h"
+#include "pedal_patch.h"
+#include "pedal_table.h"
+
+// The same config as an older version: the payload cut to its length
+static void make_old(uint8_t *out, const uint8_t *blob, size_t len, uint8_t version, uint16_t payload)
+{
+    memcpy(out, blob, len);
+    out[4] = version;
+    out[6] = payload & 0xFF;
+    out[7] = payload >> 8;
+    uint32_t crc = pedal_crc32(0, out + PEDAL_BLOB_HEADER_SIZE, payload);
+    for (int i = 0; i < 4; i++) out[8 + i] = crc >> (8 * i);
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    int iters = 20000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) iters = atoi(argv[++i]);
+        else path = argv[i];
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s <settings.json> [-n iters]\n", argv[0]);
+        return 2;
+    }
+
+    size_t json_len;
+    char *json = read_file(path, &json_len);
+    static pedal_config_t cfg, back;
+    pedal_config_defaults(&cfg);
+    if (!json || pedal_config_from_json(&cfg, json, json_len) != 0) {
+        fprintf(stderr, "cannot parse settings %s\n", path);
+        return 1;
+    }
+
+    static uint8_t blob[PEDAL_BLOB_SIZE], blob2[PEDAL_BLOB_SIZE];
+    size_t blob_len = pedal_blob_pack(&cfg, blob, sizeof(blob));
+    pedal_config_defaults(&back);
+    if (pedal_blob_unpack(&back, blob, blob_len) != 0 || pedal_blob_pack(&back, blob2, sizeof(blob2)) != blob_len ||
+        memcmp(blob, blob2, blob_len) != 0) {
+        fprintf(stderr, "blob does not round-trip\n");
+        return 1;
+    }
+    static pedal_table_t t1, t2;
+    pedal_table_compile(&t1, &cfg);
+    pedal_table_compile(&t2, &back);
+    if (memcmp(&t1, &t2, sizeof(t1)) != 0) {
+        fprintf(stderr, "compiled tables differ after round-trip\n");
+        return 1;
+    }
+    for (size_t i = 0; i < blob_len; i++) {
+        if (i == 4) continue;   // a newer version byte is accepted by design
+        blob2[i] ^= 0x10;
+        if (pedal_blob_unpack(&back, blob2, blob_len) == 0) {
+            fprintf(stderr, "corrupted byte %zu accepted\n", i);
+            return 1;
+        }
+        blob2[i] ^= 0x10;
+    }
+
+    // Version 1: the same payload without the curves
+    make_old(blob2, blob, blob_len, 1, PEDAL_BLOB_V1_PAYLOAD);
+    pedal_config_defaults(&back);
+    back.banks[0].exp.npts = 3;
+    if (pedal_blob_unpack(&back, blob2, PEDAL_BLOB_HEADER_SIZE + PEDAL_BLOB_V1_PAYLOAD) != 0 ||
+        back.banks[0].exp.npts != 3 || back.banks[3].exp.max != cfg.banks[3].exp.max) {
+        fprintf(stderr, "version 1 blob not loaded\n");
+        return 1;
+    }
+    // Version 2: curves, no expression budgets
+    make_old(blob2, blob, blob_len, 2, PEDAL_BLOB_V2_PAYLOAD);
+    pedal_config_defaults(&back);
+    back.exp_ble_hz = 7;
+    if (pedal_blob_unpack(&back, blob2, PEDAL_BLOB_HEADER_SIZE + PEDAL_BLOB_V2_PAYLOAD) != 0 ||
+        back.exp_ble_hz != 7 || back.banks[3].exp.npts != cfg.banks[3].exp.npts) {
+        fprintf(stderr, "version 2 blob not loaded\n");
+        return 1;
+    }
+
+    // A typical soundcheck tweak: one switch's CC number and toggle, an
+    // expression calibration point, a dragged curve point and a lower BLE
+    // expression budget.
+    static const uint8_t patch[] = {
+        1, 2, PEDAL_F_ACT(PEDAL_TRIG_PRESS) + 2, 42, 0,
+        1, 2, PEDAL_F_TOG, 1, 0,
+        1, PEDAL_PATCH_EXP, PEDAL_F_EXP_MIN, 0x34, 0x01,
+        1, PEDAL_PATCH_EXP, PEDAL_F_EXP_PT(1), 200, 90,
+        PEDAL_PATCH_GLOBAL, 0, PEDAL_F_GLOB_EXP_BLE_HZ, 30, 0,
+    };
+    static const uint8_t bad_patch[] = { 1, 2, PEDAL_F_TOG, 1, 0, 4, 0, 0, 0, 0 };
+    static const uint8_t bad_rate[] = { PEDAL_PATCH_GLOBAL, 0, PEDAL_F_GLOB_EXP_USB_HZ, 0, 0 };
+    static pedal_config_t patched, restored;
+    patched = cfg;
+    uint64_t dirty = 0;
+    if (pedal_patch_apply(&patched, bad_patch, sizeof(bad_patch), &dirty) != -1 ||
+        pedal_patch_apply(&patched, bad_rate, sizeof(bad_rate), &dirty) != -1 || dirty ||
+        memcmp(&patched, &cfg, sizeof(cfg)) != 0) {
+        fprintf(stderr, "malformed patch was applied\n");
+        return 1;
+    }
+    if (pedal_patch_apply(&patched, patch, sizeof(patch), &dirty) != 5 || patched.exp_ble_hz != 30 || patched.banks[1].sw[2].act[0].val != 42 ||
+        !(patched.banks[1].sw[2].flags & PEDAL_SW_TOGGLE) || patched.banks[1].exp.min != 0x134 ||
+        patched.banks[1].exp.pts[1][0] != 200 || patched.banks[1].exp.pts[1][1] != 90) {
+        fprintf(stderr, "patch not applied\n");
+        return 1;
+    }
+    size_t record_bytes = 0;
+    restored = back;
+    pedal_blob_unpack(&restored, blob, blob_len);
+    for (int rec = 0; rec < PEDAL_REC_COUNT; rec++) {
+        uint8_t rec_buf[PEDAL_REC_MAX_SIZE];
+        if (!(dirty & (1ull << rec))) continue;
+        size_t n = pedal_record_pack(&patched, rec, rec_buf);
+        record_bytes += n;
+        pedal_record_unpack(&restored, rec, rec_buf, n);
+    }
+    pedal_blob_pack(&patched, blob2, sizeof(blob2));
+    static uint8_t blob3[PEDAL_BLOB_SIZE];
+    pedal_blob_pack(&restored, blob3, sizeof(blob3));
+    if (memcmp(blob2, blob3, sizeof(blob3)) != 0) {
+        fprintf(stderr, "blob + dirty records differ from patched config\n");
+        return 1;
+    }
+
+    // Someone hammering save while tweaking: a full save, a few patches, a
+    // failed write that has to be retried, then another full save.
+    static pedal_commit_queue_t q;
+    static pedal_commit_batch_t batch;
+    pedal_commit_init(&q);
+    uint32_t ms = 0, ticket = 0;
+    int flash_writes = 0;
+    for (int i = 0; i < 20; i++, ms += 30) {
+        if (pedal_commit_due(&q, ms) == 0) flash_writes++;
+        ticket = pedal_commit_stage(&q, i & 1 ? &patched : &cfg, !(i & 3), dirty, ms);
+    }
+    int32_t wait = pedal_commit_due(&q, ms);
+    if (flash_writes || wait != PEDAL_COMMIT_SETTLE_MS - 30 || !pedal_commit_take(&q, &batch)) {
+        fprintf(stderr, "commit queue wrote during the burst\n");
+        return 1;
+    }
+    ticket = pedal_commit_stage(&q, &patched, false, dirty, ms);
+    pedal_commit_done(&q, &batch, false, ms);
+    if (!pedal_commit_take(&q, &batch) || pedal_commit_take(&q, &batch) || batch.gen != ticket) {
+        fprintf(stderr, "failed commit was not requeued\n");
+        return 1;
+    }
+    pedal_commit_done(&q, &batch, true, ms);
+    restored = back;
+    if (batch.full) pedal_blob_unpack(&restored, batch.blob, batch.blob_len);
+    for (int rec = 0; rec < PEDAL_REC_COUNT; rec++) {
+        if (batch.dirty & (1ull << rec)) pedal_record_unpack(&restored, rec, batch.rec[rec], batch.rec_len[rec]);
+    }
+    pedal_blob_pack(&restored, blob3, sizeof(blob3));
+    if (!pedal_commit_reached(q.saved, ticket) || memcmp(blob2, blob3, sizeof(blob3)) != 0) {
+        fprintf(stderr, "committed batch differs from the last save\n");
+        return 1;
+    }
+
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < iters; i++) pedal_config_from_json(&back, json, json_len);
+    uint64_t json_ns = now_ns() - t0;
+    t0 = now_ns();
+    for (int i = 0; i < iters; i++) pedal_blob_unpack(&back, blob, blob_len);
+    uint64_t unpack_ns = now_ns() - t0;
+    t0 = now_ns();
+    for (int i = 0; i < iters; i++) pedal_blob_pack(&cfg, blob2, sizeof(blob2));
+    uint64_t pack_ns = now_ns() - t0;
+
+    printf("json:   %6zu bytes  %8.0f ns/load\n", json_len, (double)json_ns / iters);
+    printf("blob:   %6zu bytes  %8.0f ns/load  %6.0f ns/save\n", blob_len, (double)unpack_ns / iters,
+           (double)pack_ns / iters);
+    printf("patch:  %6zu bytes  -> %zu bytes in %d dirty records (full save: %zu)\n", sizeof(patch),
+           record_bytes, __builtin_popcountll(dirty), blob_len);
+    printf("commit: %6u requests -> %u writes (one retried)\n", (unsigned)q.requests, (unsigned)q.writes);
+    free(json);
+    return 0;
+}
@@ -0,0 +1,152 @@
+// Expression curve LUTs: accuracy against direct evaluation, and cost.
+//
+//   curve_bench [-n conversions]
+//
+// Compiles every preset curve and a few drawn ones under full, narrow and
+// reversed calibrations, then checks each LUT entry against the curve
+// evaluated in floating point at both ends of the input span it covers,
+// checks that the curve is monotone where its points are, that the ends
+// of the calibrated travel give 0 and full scale, and that a drawn curve
+// passes through its points. Reports cycles (x86 TSC, else ns) per
+// conversion for the LUT and for per-sample float evaluation, and the cost
+// of compiling one bank, which is only paid when settings change.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+#include "bench_util.h"
+#include "pedal_curve.h"
+
+static uint64_t now_ticks(void)
+{
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return now_ns();
+#endif
+}
+
+typedef struct {
+    const char *name;
+    pedal_exp_t e;
+    int monotone;
+} curve_case_t;
+
+#define PTS(...) .pts = { __VA_ARGS__ }
+
+static const curve_case_t cases[] = {
+    { "linear", { .crv = PEDAL_CURVE_LINEAR, .min = 0, .max = 4095 }, 1 },
+    { "exp", { .crv = PEDAL_CURVE_EXP, .min = 0, .max = 4095 }, 1 },
+    { "log", { .crv = PEDAL_CURVE_LOG, .min = 0, .max = 4095 }, 1 },
+    { "exp narrow", { .crv = PEDAL_CURVE_EXP, .min = 1200, .max = 1700 }, 1 },
+    { "log reversed", { .crv = PEDAL_CURVE_LOG, .min = 3900, .max = 150 }, -1 },
+    { "s-curve", { .crv = PEDAL_CURVE_CUSTOM, .min = 80, .max = 4000, .npts = 5,
+                   PTS({ 0, 0 }, { 64, 20 }, { 128, 128 }, { 192, 235 }, { 255, 255 }) }, 1 },
+    { "plateau", { .crv = PEDAL_CURVE_CUSTOM, .min = 0, .max = 4095, .npts = 6,
+                   PTS({ 0, 10 }, { 40, 90 }, { 120, 90 }, { 121, 100 }, { 200, 250 }, { 255, 250 }) }, 1 },
+    { "bad order", { .crv = PEDAL_CURVE_CUSTOM, .min = 0, .max = 4095, .npts = 4,
+                     PTS({ 0, 0 }, { 200, 60 }, { 100, 255 }, { 255, 255 }) }, 1 },
+    { "v-shape", { .crv = PEDAL_CURVE_CUSTOM, .min = 0, .max = 4095, .npts = 3,
+                   PTS({ 0, 255 }, { 128, 0 }, { 255, 255 }) }, 0 },
+};
+
+static uint16_t s_lut[PEDAL_CURVE_LUT_SIZE];
+
+static int check(const curve_case_t *k)
+{
+    pedal_curve_t c;
+    pedal_curve_prepare(&c, &k->e);
+    pedal_curve_compile(s_lut, &k->e);
+    const float span = (float)(1 << PEDAL_CURVE_LUT_SHIFT) / 16;
+    int worst = 0;
+
+    for (int i = 0; i < PEDAL_CURVE_LUT_SIZE; i++) {
+        // Within its span an entry may be off by the curve's own rise across it
+        int a = pedal_curve_eval(&c, i * span), b = pedal_curve_eval(&c, (i + 1) * span);
+        int lo = a < b ? a : b, hi = a < b ? b : a, v = s_lut[i];
+        if (!k->monotone) lo = 0, hi = PEDAL_CURVE_OUT_MAX;
+        if (v < lo - 1 || v > hi + 1) {
+            fprintf(stderr, "%s: entry %d is %d, curve spans %d..%d\n", k->name, i, v, lo, hi);
+            return 1;
+        }
+        int d = abs(v - pedal_curve_eval(&c, (i + 0.5f) * span));     // against the middle of the span
+        if (d > worst) worst = d;
+        if (i && k->monotone && (v - s_lut[i - 1]) * k->monotone < 0) {
+            fprintf(stderr, "%s: not monotone at entry %d\n", k->name, i);
+            return 1;
+        }
+    }
+    uint16_t heel = k->e.min < k->e.max ? k->e.min : k->e.max, toe = k->e.min < k->e.max ? k->e.max : k->e.min;
+    uint16_t below = pedal_curve_map(s_lut, heel > 2 ? (heel - 2) << 4 : 0);
+    uint16_t above = pedal_curve_map(s_lut, toe < 4093 ? (toe + 2) << 4 : 4095 << 4);
+    if (k->e.crv != PEDAL_CURVE_CUSTOM && (k->monotone > 0 ? below != 0 || above != PEDAL_CURVE_OUT_MAX
+                                                            : below != PEDAL_CURVE_OUT_MAX || above != 0)) {
+        fprintf(stderr, "%s: ends give %u and %u\n", k->name, below, above);
+        return 1;
+    }
+    for (int p = 0; p < c.n; p++) {
+        float counts = k->e.min + c.x[p] * ((float)k->e.max - k->e.min);
+        if (abs(pedal_curve_eval(&c, counts) - (int)lroundf(c.y[p] * PEDAL_CURVE_OUT_MAX)) > 1) {
+            fprintf(stderr, "%s: misses point %d\n", k->name, p);
+            return 1;
+        }
+    }
+    printf("%-13s worst %3d of %d (%.2f%%)\n", k->name, worst, PEDAL_CURVE_OUT_MAX, 100.0 * worst / PEDAL_CURVE_OUT_MAX);
+    return 0;
+}
+
+static void cost(uint32_t n)
+{
+    uint16_t *in = malloc(n * sizeof(*in));
+    for (uint32_t i = 0; i < n; i++) in[i] = (uint16_t)(32768 + 30000 * sin(i * 1e-3) + rand() % 64);
+    const pedal_exp_t *e = &cases[5].e;
+    pedal_curve_t c;
+    pedal_curve_prepare(&c, e);
+    pedal_curve_compile(s_lut, e);
+    volatile uint32_t sink = 0;
+
+    uint64_t t0 = now_ticks();
+    for (uint32_t i = 0; i < n; i++) sink += pedal_curve_map(s_lut, in[i]);
+    double lut = (double)(now_ticks() - t0) / n;
+
+    t0 = now_ticks();
+    for (uint32_t i = 0; i < n; i++) sink += pedal_curve_eval(&c, in[i] / 16.0f);
+    double direct = (double)(now_ticks() - t0) / n;
+
+    int rounds = 200;
+    uint64_t c0 = now_ns();
+    for (int r = 0; r < rounds; r++) pedal_curve_compile(s_lut, &cases[r % 9].e);
+    double compile_us = (double)(now_ns() - c0) / rounds / 1000;
+    free(in);
+#ifdef HAVE_TSC
+    const char *unit = "cycles";
+#else
+    const char *unit = "ns";
+#endif
+    printf("per conversion: lut %.1f %s, float spline %.1f %s; compiling a bank %.1f us\n", lut, unit, direct, unit,
+           compile_us);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t n = 1000000;
+    if (argc == 3 && !strcmp(argv[1], "-n")) n = strtoul(argv[2], NULL, 10);
+    else if (argc != 1) {
+        fprintf(stderr, "usage: %s [-n conversions]\n", argv[0]);
+        return 2;
+    }
+    if (!n) n = 1;
+    srand(1);
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        if (check(&cases[i])) return 1;
+    }
+    cost(n);
+    return 0;
+}
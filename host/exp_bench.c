@@ -0,0 +1,207 @@
+// Expression filter quality and cost against the oversample + hysteresis
+// reader it replaces.
+//
+//   exp_bench [-n seconds]
+//
+// Synthesises the ADC stream of a pedal (12-bit, gaussian noise of 6
+// counts, travel calibrated a little inside the rails so clipped noise does
+// not bias the ends) and runs it through both pipelines:
+//
+//   legacy  16 one-shot reads averaged every 5 ms, EMA 1/4, hysteresis of
+//           EXP_HYSTERESIS (8) counts
+//   dma     32 kHz continuous conversion in 64-sample frames, CIC decimate
+//           by 32, one-euro filter at 1 kHz
+//
+// Checks, on the 7-bit CC value a linear curve would send: a parked pedal
+// (on and off a CC boundary) changes CC no more often than before; a fast
+// heel-to-toe sweep and a step reach the final CC sooner; the dma output
+// ends within one count of the pedal, also after a slow creep the
+// hysteresis swallows, and never leaves the input range. Reports ns of
+// filtering per input sample and per output value.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bench_util.h"
+#include "pedal_exp_filter.h"
+
+#define FS          32000
+#define FRAME       64
+#define NOISE       6.0
+#define LEGACY_OS   16
+#define LEGACY_US   5000
+#define LEGACY_HYST 8
+
+static double gauss(void)
+{
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+static uint16_t adc(double pos)
+{
+    long v = lround(pos + NOISE * gauss());
+    return v < 0 ? 0 : v > 4095 ? 4095 : v;
+}
+
+typedef double (*path_t)(double t);
+
+typedef struct {
+    int idle_changes;               // CC changes after settling
+    double settle_ms;               // time from the end of the move to the final CC
+    int cc_last;
+    double err;                     // final value against the pedal, ADC counts
+    int out_of_range;
+} result_t;
+
+typedef struct {
+    int cc, changes, cc_final;
+    double t_end, done_ms, value;
+} track_t;
+
+static void track(track_t *k, double t, double value)
+{
+    int cc = (int)value >> 5;
+    k->value = value;
+    if (cc != k->cc) {
+        if (t > k->t_end + 0.5) k->changes++;
+        k->cc = cc;
+    }
+    if (k->done_ms < 0 && t >= k->t_end && cc == k->cc_final) k->done_ms = (t - k->t_end) * 1000;
+    if (k->done_ms >= 0 && cc != k->cc_final) k->done_ms = -1;
+}
+
+static result_t run_legacy(path_t path, double t_end, double secs, int cc_final)
+{
+    track_t k = { .cc = -1, .cc_final = cc_final, .t_end = t_end, .done_ms = -1 };
+    int ema = -1, held = 0;
+    for (long us = 0; us < secs * 1e6; us += LEGACY_US) {
+        double t = us / 1e6;
+        int sum = 0;
+        for (int i = 0; i < LEGACY_OS; i++) sum += adc(path(t + i * 10e-6));
+        int avg = sum / LEGACY_OS;
+        ema = ema < 0 ? avg : ema + (avg - ema) / 4;
+        if (abs(ema - held) > LEGACY_HYST || ema == 0 || ema == 4095) held = ema;
+        track(&k, t, held);
+    }
+    return (result_t){ k.changes, k.done_ms, k.cc, fabs(k.value - path(secs)), 0 };
+}
+
+static void dma_init(pedal_cic_t *c, pedal_euro_t *e)
+{
+    pedal_cic_init(c);
+    pedal_euro_init(e, PEDAL_EXP_RATE_HZ, PEDAL_EXP_MIN_CUTOFF_MHZ, PEDAL_EXP_BETA_Q8, PEDAL_EXP_D_CUTOFF_MHZ);
+}
+
+static result_t run_dma(path_t path, double t_end, double secs, int cc_final)
+{
+    track_t k = { .cc = -1, .cc_final = cc_final, .t_end = t_end, .done_ms = -1 };
+    pedal_cic_t cic;
+    pedal_euro_t euro;
+    dma_init(&cic, &euro);
+    uint16_t frame[FRAME], dec[FRAME / PEDAL_CIC_R + 1];
+    int oor = 0;
+    long n = (long)(secs * FS);
+    for (long s = 0; s < n; s += FRAME) {
+        for (int i = 0; i < FRAME; i++) frame[i] = adc(path((double)(s + i) / FS));
+        size_t m = pedal_cic_frame(&cic, frame, FRAME, dec);
+        for (size_t j = 0; j < m; j++) {
+            uint16_t y = pedal_euro_step(&euro, dec[j]);
+            if (y > PEDAL_EXP_FULL) oor = 1;
+            track(&k, (double)(s + (j + 1) * PEDAL_CIC_R) / FS, y / 16.0);
+        }
+    }
+    return (result_t){ k.changes, k.done_ms, k.cc, fabs(k.value - path(secs)), oor };
+}
+
+static double s_park;
+static double park(double t) { (void)t; return s_park; }
+static double sweep(double t) { return t < 0.1 ? 16 : t < 0.3 ? 16 + (t - 0.1) / 0.2 * 4064 : 4080; }
+static double step(double t) { return t < 0.1 ? 4080 : 16; }
+static double creep(double t) { return t < 0.5 ? 1500 : t < 2.5 ? 1500 + (t - 0.5) * 3 : 1506; }
+
+static int compare(const char *name, path_t path, double t_end, double secs, int cc_final)
+{
+    result_t a = run_legacy(path, t_end, secs, cc_final);
+    result_t b = run_dma(path, t_end, secs, cc_final);
+    printf("%-14s legacy: %2d changes, final CC in %5.1f ms, off by %4.2f   "
+           "dma: %2d changes, final CC in %5.1f ms, off by %4.2f\n",
+           name, a.idle_changes, a.settle_ms, a.err, b.idle_changes, b.settle_ms, b.err);
+    if (b.out_of_range || b.cc_last != cc_final || b.settle_ms < 0 || b.err > 1) {
+        fprintf(stderr, "%s: dma output wrong (CC %d, want %d)\n", name, b.cc_last, cc_final);
+        return 1;
+    }
+    if (b.idle_changes > a.idle_changes || (t_end > 0 && a.settle_ms >= 0 && b.settle_ms > a.settle_ms)) {
+        fprintf(stderr, "%s: dma pipeline worse than legacy\n", name);
+        return 1;
+    }
+    return 0;
+}
+
+static int cost(double secs)
+{
+    long n = (long)(secs * FS);
+    n -= n % FRAME;
+    uint16_t *raw = malloc(n * sizeof(*raw));
+    for (long i = 0; i < n; i++) raw[i] = adc(2048 + 1500 * sin(i * 2e-4));
+    pedal_cic_t cic;
+    pedal_euro_t euro;
+    dma_init(&cic, &euro);
+    uint16_t dec[FRAME / PEDAL_CIC_R + 1];
+    volatile uint32_t sink = 0;
+    long outs = 0;
+
+    uint64_t t0 = now_ns();
+    for (long s = 0; s < n; s += FRAME) {
+        size_t m = pedal_cic_frame(&cic, raw + s, FRAME, dec);
+        for (size_t j = 0; j < m; j++) sink += pedal_euro_step(&euro, dec[j]);
+        outs += m;
+    }
+    uint64_t dma_ns = now_ns() - t0;
+
+    int ema = 0, held = 0;
+    long legacy_outs = n / LEGACY_OS;
+    t0 = now_ns();
+    for (long s = 0; s + LEGACY_OS <= n; s += LEGACY_OS) {
+        int sum = 0;
+        for (int i = 0; i < LEGACY_OS; i++) sum += raw[s + i];
+        ema += (sum / LEGACY_OS - ema) / 4;
+        if (abs(ema - held) > LEGACY_HYST) held = ema;
+        sink += held;
+    }
+    uint64_t legacy_ns = now_ns() - t0;
+    free(raw);
+    printf("cost: dma %.2f ns/sample, %.1f ns/output (%ld outputs, no blocking reads); "
+           "legacy %.1f ns/output + %d blocking one-shot reads\n",
+           (double)dma_ns / n, (double)dma_ns / outs, outs, (double)legacy_ns / legacy_outs, LEGACY_OS);
+    return outs != n / PEDAL_CIC_R;
+}
+
+int main(int argc, char **argv)
+{
+    double secs = 10;
+    if (argc == 3 && !strcmp(argv[1], "-n")) secs = atof(argv[2]);
+    else if (argc != 1) {
+        fprintf(stderr, "usage: %s [-n seconds]\n", argv[0]);
+        return 2;
+    }
+    if (secs < 1) secs = 1;
+    srand(1);
+
+    static const struct { const char *name; double pos; } parks[] = {
+        { "park heel:", 16 }, { "park mid:", 2000 }, { "park boundary:", 1024 }, { "park b+3:", 2051 },
+        { "park toe:", 4080 },
+    };
+    int err = 0;
+    for (size_t i = 0; i < sizeof(parks) / sizeof(parks[0]); i++) {
+        s_park = parks[i].pos;
+        int cc = run_dma(park, 0, 1, 0).cc_last;    // whichever side of the boundary it settles on
+        err |= compare(parks[i].name, park, 0, secs / 2, cc);
+    }
+    err |= compare("sweep 200 ms:", sweep, 0.3, 1, 127);
+    err |= compare("step down:", step, 0.1, 1, 0);
+    err |= compare("creep 6:", creep, 2.5, 4, 1506 >> 5);
+    return err || cost(secs);
+}
@@ -0,0 +1,213 @@
+// High-resolution expression output: USB traffic and decoding.
+//
+//   hires_bench [-n rounds]
+//
+// Sweeps the pedal heel to toe in 150 ms, 300 ms, 1 s and 3 s through a
+// linear bank curve and sends it the three ways midi_out can:
+//
+//   7-bit   one CC per change of the 7-bit value, as before
+//   cc14    MSB/LSB pair at most every PEDAL_EXP_OUT_INTERVAL_MS
+//   ump     MIDI 2.0 control change (32-bit value), same pacing
+//
+// Every 1 ms tick pushes to a pedal_usb_ring and drains it the way the USB
+// task does; each run handed over is one bulk transfer. Checks that the
+// receiver decodes every value sent (pairs back to 14 bits, UMP values back
+// through min-center-max scaling), that the resting value arrives exactly,
+// and that sweeps of up to a second take fewer transfers than the 7-bit
+// stream. Slower sweeps get up to 1000 / PEDAL_EXP_OUT_INTERVAL_MS updates
+// a second and are reported only. Also checks that a UMP message at the
+// end of the ring is padded instead of wrapped, that peek never ends a run
+// inside a message, and reports ns per tick of the send path.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bench_util.h"
+#include "pedal_curve.h"
+#include "pedal_exp_filter.h"
+#include "pedal_exp_out.h"
+#include "pedal_usb_ring.h"
+
+#define CH  0
+#define CC  11
+
+enum { MODE_7BIT, MODE_CC14, MODE_UMP };
+static const char *const mode_name[] = { "7-bit", "cc14", "ump" };
+
+typedef struct {
+    uint32_t transfers, bytes, values;
+    int msb, value;                 // receiver state
+    int err;
+} rx_t;
+
+static uint32_t get_word(const uint8_t *ev)
+{
+    return ev[0] | ev[1] << 8 | ev[2] << 16 | (uint32_t)ev[3] << 24;
+}
+
+// What a host makes of one run of events
+static void receive(rx_t *rx, int mode, const uint8_t *ev, size_t n)
+{
+    for (size_t k = 0; k < n; k++, ev += PEDAL_USB_EVENT_SIZE) {
+        if (mode != MODE_UMP) {
+            if (ev[0] != 0x0B || ev[1] != (0xB0 | CH)) rx->err = 1;
+            else if (ev[2] == CC && mode == MODE_7BIT) rx->value = ev[3] << 7, rx->values++;
+            else if (ev[2] == CC) rx->msb = ev[3];
+            else if (ev[2] == CC + 32) rx->value = rx->msb << 7 | ev[3], rx->values++;
+            else rx->err = 1;
+            continue;
+        }
+        uint32_t w = get_word(ev);
+        if (w == PEDAL_UMP_NOOP) continue;
+        if (k + 1 >= n || w != (0x40000000u | (0xB0u | CH) << 16 | CC << 8)) {
+            rx->err = 1;
+            continue;
+        }
+        uint32_t v32 = get_word(ev += PEDAL_USB_EVENT_SIZE);
+        k++;
+        rx->value = v32 >> 18;
+        if (pedal_ump_scale14(rx->value) != v32) rx->err = 1;
+        rx->values++;
+    }
+}
+
+static void send(pedal_usb_ring_t *r, int mode, uint16_t v, uint16_t prev)
+{
+    pedal_midi_msg_t m[2];
+    if (mode == MODE_UMP) {
+        uint32_t ump[2];
+        pedal_ump_cc(0, CH, CC, pedal_ump_scale14(v), ump);
+        pedal_usb_ring_push_ump(r, ump, 2, NULL);
+        return;
+    }
+    int n = 1;
+    if (mode == MODE_7BIT) m[0] = (pedal_midi_msg_t){ 3, { 0xB0 | CH, CC, v >> 7 } };
+    else n = pedal_exp_cc14(CH, CC, v, prev, m);
+    for (int k = 0; k < n; k++) pedal_usb_ring_push(r, &m[k], NULL);
+}
+
+static rx_t sweep(const uint16_t *lut, int mode, uint32_t sweep_ms)
+{
+    static pedal_usb_ring_t ring;
+    memset(&ring, 0, sizeof(ring));
+    ring.ump = mode == MODE_UMP;
+    pedal_exp_out_t o;
+    pedal_exp_out_init(&o, mode == MODE_7BIT ? 7 : 14, mode == MODE_7BIT ? 0 : PEDAL_EXP_OUT_INTERVAL_MS);
+
+    rx_t rx = { .value = -1 };
+    uint16_t v = 0;
+    for (uint32_t ms = 0; ms < sweep_ms + 100; ms++) {
+        uint32_t pos = ms < sweep_ms ? (uint64_t)PEDAL_EXP_FULL * ms / sweep_ms : PEDAL_EXP_FULL;
+        v = pedal_curve_map(lut, pos);
+        uint16_t prev;
+        if (pedal_exp_out_due(&o, v, ms, &prev)) send(&ring, mode, v, prev);
+
+        const uint8_t *span;
+        size_t n;
+        while ((n = pedal_usb_ring_peek(&ring, &span, PEDAL_USB_XFER_EVENTS))) {
+            receive(&rx, mode, span, n);
+            rx.transfers++;
+            rx.bytes += n * PEDAL_USB_EVENT_SIZE;
+            pedal_usb_ring_consume(&ring, n, n);
+        }
+    }
+    if (ring.dropped) rx.err = 1;
+    if (rx.value != (mode == MODE_7BIT ? v >> 7 << 7 : v)) rx.err = 1;
+    return rx;
+}
+
+static int check_ring(void)
+{
+    static pedal_usb_ring_t r;
+    memset(&r, 0, sizeof(r));
+    r.ump = true;
+    r.head = r.tail = PEDAL_USB_RING_LEN - 1;
+    uint32_t ump[2] = { 0x40B00B00u, 0xDEADBEEFu };
+    const uint8_t *span;
+    int err = !pedal_usb_ring_push_ump(&r, ump, 2, NULL) || r.head != PEDAL_USB_RING_LEN + 2;
+    // The padding comes alone, the message whole from the start of the ring
+    size_t n = pedal_usb_ring_peek(&r, &span, PEDAL_USB_XFER_EVENTS);
+    err |= n != 1 || get_word(span) != PEDAL_UMP_NOOP;
+    pedal_usb_ring_consume(&r, n, n);
+    n = pedal_usb_ring_peek(&r, &span, 1);
+    err |= n != 0;
+    n = pedal_usb_ring_peek(&r, &span, PEDAL_USB_XFER_EVENTS);
+    err |= n != 2 || span != r.ev[0] || get_word(span) != ump[0] || get_word(span + 4) != ump[1];
+    pedal_usb_ring_consume(&r, n, n);
+
+    // MIDI 1.0 messages become MT 2 words; a full ring drops the whole message
+    pedal_midi_msg_t pc = { 2, { 0xC3, 5 } };
+    err |= !pedal_usb_ring_push(&r, &pc, NULL);
+    n = pedal_usb_ring_peek(&r, &span, PEDAL_USB_XFER_EVENTS);
+    err |= n != 1 || get_word(span) != 0x20C30500u;
+    pedal_usb_ring_consume(&r, n, n);
+    r.tail = r.head - (PEDAL_USB_RING_LEN - 1);
+    err |= pedal_usb_ring_push_ump(&r, ump, 2, NULL) || r.dropped != 1;
+
+    err |= pedal_ump_scale14(0) != 0 || pedal_ump_scale14(0x2000) != 0x80000000u ||
+           pedal_ump_scale14(0x3FFF) != 0xFFFFFFFFu;
+    for (uint32_t v = 1; v < 0x4000; v++)
+        err |= pedal_ump_scale14(v) <= pedal_ump_scale14(v - 1) || pedal_ump_scale14(v) >> 18 != v;
+    if (err) fprintf(stderr, "UMP ring or scaling broken\n");
+    return err;
+}
+
+int main(int argc, char **argv)
+{
+    static const uint32_t sweeps_ms[] = { 150, 300, 1000, 3000 };
+    uint32_t rounds = 1000;
+    if (argc == 3 && !strcmp(argv[1], "-n")) rounds = strtoul(argv[2], NULL, 10);
+    else if (argc != 1) {
+        fprintf(stderr, "usage: %s [-n rounds]\n", argv[0]);
+        return 2;
+    }
+    if (!rounds) rounds = 1;
+    if (check_ring()) return 1;
+
+    pedal_config_t cfg;
+    pedal_config_defaults(&cfg);
+    cfg.banks[0].exp.crv = PEDAL_CURVE_LINEAR;
+    cfg.banks[0].exp.min = 0;
+    cfg.banks[0].exp.max = 4095;
+    static uint16_t lut[PEDAL_CURVE_LUT_SIZE];
+    pedal_curve_compile(lut, &cfg.banks[0].exp);
+
+    int err = 0;
+    for (size_t s = 0; s < sizeof(sweeps_ms) / sizeof(sweeps_ms[0]); s++) {
+        rx_t rx[3];
+        printf("sweep %4u ms:", sweeps_ms[s]);
+        for (int m = 0; m < 3; m++) {
+            rx[m] = sweep(lut, m, sweeps_ms[s]);
+            printf("  %s %u values %u transfers %u B", mode_name[m], rx[m].values, rx[m].transfers, rx[m].bytes);
+            if (rx[m].err) {
+                fprintf(stderr, "\n%s: decoded stream wrong\n", mode_name[m]);
+                err = 1;
+            }
+        }
+        printf("\n");
+        if (sweeps_ms[s] <= 1000 && (rx[MODE_CC14].transfers >= rx[MODE_7BIT].transfers ||
+                                     rx[MODE_UMP].transfers >= rx[MODE_7BIT].transfers)) {
+            fprintf(stderr, "high resolution takes more transfers than 7-bit\n");
+            err = 1;
+        }
+    }
+
+    // Send path per tick, value changing every time
+    pedal_exp_out_t o;
+    pedal_exp_out_init(&o, 14, PEDAL_EXP_OUT_INTERVAL_MS);
+    static pedal_usb_ring_t ring;
+    ring.ump = true;
+    uint32_t sends = 0;
+    uint64_t t0 = now_ns();
+    for (uint32_t i = 0; i < rounds; i++) {
+        uint16_t prev, v = pedal_curve_map(lut, (i * 37u) % PEDAL_EXP_FULL);
+        if (pedal_exp_out_due(&o, v, i, &prev)) {
+            send(&ring, MODE_UMP, v, prev);
+            sends++;
+            ring.tail = ring.head;
+        }
+    }
+    printf("send path: %.1f ns/tick (%u sent)\n", (double)(now_ns() - t0) / rounds, sends);
+    return err;
+}
@@ -0,0 +1,97 @@
+// Latency histogram accuracy and cost.
+//
+//   lat_bench [-n samples]
+//
+// Feeds pedal_lat with uniform, long-tailed and constant samples and
+// checks min, max and each reported percentile against the exact value
+// from the sorted samples: a percentile may only be off by the width of
+// its bucket (25% above 8 us). Also checks that every value up to the
+// last bucket lands in the bucket whose floor it is at or above, and
+// reports the cost of one add, which the firmware pays per stage and
+// message.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bench_util.h"
+#include "pedal_lat.h"
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int check_buckets(void)
+{
+    uint32_t top = pedal_lat_bucket_floor(PEDAL_LAT_BUCKETS - 1);
+    for (uint32_t us = 0; us <= top * 2; us++) {
+        int b = pedal_lat_bucket(us);
+        if (us < pedal_lat_bucket_floor(b) || (b < PEDAL_LAT_BUCKETS - 1 && us >= pedal_lat_bucket_floor(b + 1))) {
+            fprintf(stderr, "%u us in bucket %d [%u, %u)\n", us, b, pedal_lat_bucket_floor(b),
+                    pedal_lat_bucket_floor(b + 1));
+            return 1;
+        }
+    }
+    printf("buckets: %d, last from %u us\n", PEDAL_LAT_BUCKETS, top);
+    return 0;
+}
+
+static uint32_t sample(int dist)
+{
+    switch (dist) {
+    case 0: return rand() % 2000;                              // USB-like: within a ms or two
+    case 1: return 200 + (rand() % 100 ? rand() % 7500 : rand() % 60000);   // BLE with a tail
+    default: return 333;
+    }
+}
+
+static int run(const char *name, int dist, uint32_t n)
+{
+    static const unsigned pcts[] = { 50, 90, 99 };
+    uint32_t *v = malloc(n * sizeof(*v));
+    pedal_lat_t h;
+    pedal_lat_reset(&h);
+    for (uint32_t i = 0; i < n; i++) v[i] = sample(dist);
+
+    uint64_t t0 = now_ns();
+    for (uint32_t i = 0; i < n; i++) pedal_lat_add(&h, v[i]);
+    double ns = (double)(now_ns() - t0) / n;
+
+    qsort(v, n, sizeof(*v), cmp_u32);
+    int err = h.count != n || h.min_us != v[0] || h.max_us != v[n - 1];
+    printf("%-9s n %u  min %u  max %u", name, n, h.min_us, h.max_us);
+    for (size_t i = 0; i < sizeof(pcts) / sizeof(pcts[0]); i++) {
+        uint32_t exact = v[((uint64_t)n * pcts[i] + 99) / 100 - 1];
+        uint32_t got = pedal_lat_percentile(&h, pcts[i]);
+        int b = pedal_lat_bucket(exact);
+        uint32_t hi = b < PEDAL_LAT_BUCKETS - 1 ? pedal_lat_bucket_floor(b + 1) - 1 : h.max_us;
+        printf("  p%u %u (exact %u)", pcts[i], got, exact);
+        if (got < exact || got > hi) err = 1;
+    }
+    printf("  %.1f ns/add\n", ns);
+
+    char json[128];
+    if (!pedal_lat_json(&h, json, sizeof(json)) || pedal_lat_json(&h, json, 8)) err = 1;
+    free(v);
+    if (err) fprintf(stderr, "%s: histogram statistics off\n", name);
+    return err;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t n = 1000000;
+    if (argc == 3 && !strcmp(argv[1], "-n")) n = strtoul(argv[2], NULL, 10);
+    else if (argc != 1) {
+        fprintf(stderr, "usage: %s [-n samples]\n", argv[0]);
+        return 2;
+    }
+    if (!n) n = 1;
+    srand(1);
+
+    pedal_lat_t empty;
+    pedal_lat_reset(&empty);
+    if (pedal_lat_percentile(&empty, 99)) return 1;
+    return check_buckets() || run("uniform:", 0, n) || run("tail:", 1, n) || run("constant:", 2, n);
+}
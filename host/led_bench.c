@@ -0,0 +1,192 @@
+// LED frames: diffing, brightness table and animations.
+//
+//   led_bench [-n renders]
+//
+// Renders the same state once per scan-loop millisecond and fails if
+// anything but the first render asks for a transfer. Toggling a switch
+// must change exactly its own LED (snake order), a bank change every
+// switch LED, and a brightness change every lit byte, monotonically. The
+// bank and identity flashes must give three on/off pairs with the frame
+// timer landing on each step and end on the static frame; a low battery
+// blinks LED 1 every 500 ms. Battery levels must not flap around a
+// threshold. Reports the cost of one render.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bench_util.h"
+#include "pedal_led.h"
+
+static int changed_leds(const uint8_t *a, const uint8_t *b)
+{
+    int n = 0;
+    for (int i = 0; i < PEDAL_LED_COUNT; i++) n += memcmp(a + i * 3, b + i * 3, 3) != 0;
+    return n;
+}
+
+static int check_diff(void)
+{
+    pedal_led_t l;
+    pedal_led_init(&l, 127);
+    pedal_led_state_t s = { .bank = 0, .on = 0, .battery = PEDAL_LED_BAT_GOOD };
+    uint32_t next;
+    int pushes = 0;
+    for (uint32_t t = 0; t < 10000; t++) pushes += pedal_led_render(&l, &s, t, &next);
+    if (pushes != 1 || next) {
+        fprintf(stderr, "unchanged state: %d transfers, next %u\n", pushes, next);
+        return 1;
+    }
+
+    int err = 0;
+    uint8_t before[PEDAL_LED_FRAME];
+    // Switch 5 is the last LED in the snake, switch 8 the fifth switch LED
+    static const struct { uint8_t sw, led; } cases[] = { { 0, 1 }, { 3, 4 }, { 7, 5 }, { 4, 8 } };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        memcpy(before, l.frame, sizeof(before));
+        s.on ^= 1u << cases[i].sw;
+        if (!pedal_led_render(&l, &s, 10000, &next) || changed_leds(before, l.frame) != 1 ||
+            !memcmp(before + cases[i].led * 3, l.frame + cases[i].led * 3, 3)) {
+            fprintf(stderr, "switch %u did not change LED %u alone\n", cases[i].sw + 1, cases[i].led + 1);
+            err = 1;
+        }
+        s.on ^= 1u << cases[i].sw;
+        pedal_led_render(&l, &s, 10000, &next);
+    }
+    memcpy(before, l.frame, sizeof(before));
+    s.bank = 2;
+    if (!pedal_led_render(&l, &s, 10000, &next) || changed_leds(before, l.frame) != PEDAL_NUM_SWITCHES) {
+        fprintf(stderr, "bank change did not repaint the switch LEDs only\n");
+        err = 1;
+    }
+
+    // Brightness: 0 is dark, more is never dimmer
+    uint8_t prev[PEDAL_LED_FRAME] = { 0 };
+    s.on = 0x0F;
+    for (int b = 0; b <= 255; b += 15) {
+        pedal_led_brightness(&l, b);
+        pedal_led_render(&l, &s, 10000, &next);
+        for (int i = 0; i < PEDAL_LED_FRAME; i++) {
+            if ((b == 0 && l.frame[i]) || l.frame[i] < prev[i]) {
+                fprintf(stderr, "brightness %d: byte %d is %u, was %u\n", b, i, l.frame[i], prev[i]);
+                return 1;
+            }
+        }
+        memcpy(prev, l.frame, sizeof(prev));
+    }
+    if (l.frame[3 + 2] != 255) {
+        fprintf(stderr, "full brightness gives %u on an ON switch's blue\n", l.frame[3 + 2]);
+        err = 1;
+    }
+    if (!err) printf("diff:      10000 renders of one state, 1 transfer; switch, bank and brightness changes exact\n");
+    return err;
+}
+
+// Follows the frame timer: renders only at *next_ms, counts transfers
+static int run_timer(pedal_led_t *l, const pedal_led_state_t *s, uint32_t from, uint32_t until, uint32_t *last_change)
+{
+    uint32_t next, t = from;
+    int pushes = 0;
+    for (;;) {
+        if (pedal_led_render(l, s, t, &next)) {
+            pushes++;
+            *last_change = t;
+        }
+        if (!next || next >= until) break;
+        t = next;
+    }
+    return pushes;
+}
+
+static int check_anim(void)
+{
+    pedal_led_t l;
+    pedal_led_init(&l, 255);
+    pedal_led_state_t s = { .bank = 1, .on = 0x01, .battery = PEDAL_LED_BAT_GOOD };
+    uint32_t next, end = 0;
+    pedal_led_render(&l, &s, 0, &next);
+    uint8_t base[PEDAL_LED_FRAME];
+    memcpy(base, l.frame, sizeof(base));
+
+    int err = 0;
+    pedal_led_animate(&l, PEDAL_LED_ANIM_BANK, 1000);
+    int pushes = run_timer(&l, &s, 1000, 5000, &end);
+    // on, off, on, off, on, off, then back to the static frame
+    if (pushes != 7 || end != 1600 || memcmp(base, l.frame, sizeof(base))) {
+        fprintf(stderr, "bank flash: %d transfers, ended at %u ms\n", pushes, end);
+        err = 1;
+    }
+    pedal_led_animate(&l, PEDAL_LED_ANIM_IDENTITY, 2000);
+    pedal_led_render(&l, &s, 2000, &next);
+    for (int i = 0; i < PEDAL_LED_COUNT; i++) {
+        if (l.frame[i * 3 + 1] != 160 * 160 / 255 || l.frame[i * 3] || l.frame[i * 3 + 2] != 255) {
+            fprintf(stderr, "identity flash: LED %d not purple\n", i + 1);
+            err = 1;
+            break;
+        }
+    }
+    pushes = 1 + run_timer(&l, &s, next, 5000, &end);
+    if (pushes != 7 || end != 2900) {
+        fprintf(stderr, "identity flash: %d transfers, ended at %u ms\n", pushes, end);
+        err = 1;
+    }
+
+    // Low battery: 10 s of blinking is 20 transfers, LED 1 only
+    s.battery = PEDAL_LED_BAT_LOW;
+    pedal_led_render(&l, &s, 10000, &next);
+    memcpy(base, l.frame, sizeof(base));
+    pushes = run_timer(&l, &s, next, 20000, &end);
+    if (pushes != 19 || changed_leds(base, l.frame) != 1) {
+        fprintf(stderr, "low battery blink: %d transfers in 10 s\n", pushes + 1);
+        err = 1;
+    }
+    if (!err) printf("anim:      bank and identity flashes 3 x on/off on the frame timer, low battery blinks at 1 Hz\n");
+    return err;
+}
+
+static int check_battery(void)
+{
+    uint8_t level = PEDAL_LED_BAT_UNKNOWN;
+    int flips = 0;
+    level = pedal_led_battery(level, 0);
+    if (level != PEDAL_LED_BAT_UNKNOWN) return 1;
+    level = pedal_led_battery(level, 4100);
+    // Noise of +-30 mV while discharging slowly through both thresholds
+    for (int mv = 4100 * 10; mv > 3400 * 10; mv--) {
+        uint8_t next = pedal_led_battery(level, mv / 10 + (mv & 1 ? 30 : -30));
+        flips += next != level;
+        level = next;
+    }
+    if (flips != 2 || level != PEDAL_LED_BAT_LOW) {
+        fprintf(stderr, "battery level changed %d times down to 3.4 V, ended at %u\n", flips, level);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int iters = 200000;
+    if (argc == 3 && !strcmp(argv[1], "-n")) iters = atoi(argv[2]);
+    else if (argc != 1) {
+        fprintf(stderr, "usage: %s [-n renders]\n", argv[0]);
+        return 2;
+    }
+    if (iters < 1) iters = 1;
+    if (check_diff() || check_anim() || check_battery()) return 1;
+
+    pedal_led_t l;
+    pedal_led_init(&l, 127);
+    pedal_led_state_t s = { .bank = 0, .on = 0, .battery = PEDAL_LED_BAT_OK };
+    uint32_t next;
+    int pushes = 0;
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < iters; i++) {
+        s.on = (i >> 6) & 0xFF;
+        pushes += pedal_led_render(&l, &s, i, &next);
+    }
+    uint64_t t1 = now_ns();
+    printf("render:    %.1f ns per render, %d of %d renders changed the frame\n", (double)(t1 - t0) / iters, pushes,
+           iters);
+    return 0;
+}
@@ -0,0 +1,180 @@
+// Idle detection and battery drain estimate.
+//
+//   power_bench [-n minutes]
+//
+// Checks the idle detector: never idle while a switch is held, idle
+// exactly idle_ms after the last edge, not kept awake by expression noise
+// inside the deadband but by a real sweep. Then stops the scanner for long
+// enough to wrap the microsecond clock, presses a switch and resumes it:
+// the press must come out within one full scan, as it would while
+// scanning, with the gap left out of the jitter histogram. Finally plays
+// n minutes of a gig (a press every 5-40 s, a sweep now and then, a break
+// every few songs) with BLE connected and reports the time asleep and the
+// estimated drain against never sleeping.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pedal_power.h"
+#include "pedal_scan.h"
+
+#define IDLE_MS      2000
+#define SCAN_HZ      2000
+#define BATTERY_MAH  2000
+
+static uint32_t s_rand = 12345;
+
+static uint32_t rnd(uint32_t n)
+{
+    s_rand = s_rand * 1103515245u + 12345u;
+    return (s_rand >> 8) % n;
+}
+
+static int check_idle(void)
+{
+    pedal_idle_t d;
+    int err = 0;
+    pedal_idle_init(&d, IDLE_MS, 0, 1000);
+    // Held for 10 s: never idle, however long
+    for (uint32_t t = 0; t < 10000; t++) err |= pedal_idle_step(&d, t, 0x04, t == 0, 1000);
+    if (err) fprintf(stderr, "idle while a switch was held\n");
+    // Released at 10 s, noise inside the deadband after that
+    pedal_idle_step(&d, 10000, 0, true, 1000);
+    uint32_t idle_at = 0;
+    for (uint32_t t = 10001; t < 20000 && !idle_at; t++) {
+        uint16_t exp = 1000 + (t & 1 ? PEDAL_IDLE_EXP_DEADBAND : -PEDAL_IDLE_EXP_DEADBAND / 2);
+        if (pedal_idle_step(&d, t, 0, false, exp)) idle_at = t;
+    }
+    if (idle_at != 10000 + IDLE_MS) {
+        fprintf(stderr, "idle at %u ms, expected %u\n", idle_at, 10000 + IDLE_MS);
+        err = 1;
+    }
+    // A slow sweep keeps it awake, resting lets it go
+    pedal_idle_init(&d, IDLE_MS, 0, 0);
+    for (uint32_t t = 0; t < 5000; t++) {
+        if (pedal_idle_step(&d, t, 0, false, t * 4)) {
+            fprintf(stderr, "idle during a sweep at %u ms\n", t);
+            err = 1;
+            break;
+        }
+    }
+    if (pedal_idle_step(&d, 4999 + IDLE_MS - 100, 0, false, 4999 * 4) ||
+        !pedal_idle_step(&d, 4999 + IDLE_MS + 4, 0, false, 4999 * 4)) {
+        fprintf(stderr, "not idle %u ms after the sweep stopped\n", IDLE_MS);
+        err = 1;
+    }
+    pedal_idle_init(&d, 0, 0, 0);
+    if (pedal_idle_step(&d, 1u << 31, 0, false, 0)) {
+        fprintf(stderr, "idle with idle_ms 0\n");
+        err = 1;
+    }
+    if (!err) printf("idle:      held, expression noise and sweeps handled, idle %u ms after the last edge\n", IDLE_MS);
+    return err;
+}
+
+static int check_resume(void)
+{
+    static pedal_scan_t s;
+    pedal_scan_init(&s, SCAN_HZ, 5);
+    uint32_t now = 0;
+    for (int i = 0; i < 100; i++) pedal_scan_row(&s, now += s.period_us, 0);
+    pedal_scan_jitter_t before = s.jitter;
+
+    // Asleep for 3 hours: the 32-bit clock wrapped. Switch 6 is down when
+    // the column wakes us, with the row sampled next either one.
+    int worst = 0, err = 0;
+    for (int first = 0; first < PEDAL_SCAN_ROWS; first++) {
+        now += 3u * 3600 * 1000000;
+        pedal_scan_resume(&s);
+        s.row = first;
+        int samples = 0;
+        pedal_scan_edge_t e;
+        while (!pedal_scan_pop(&s, &e) && samples < 10) {
+            pedal_scan_row(&s, now += s.period_us, s.row == 1 ? 1u << 2 : 0);
+            samples++;
+        }
+        if (samples > worst) worst = samples;
+        if (e.sw != 6 || !e.down || e.us != now) err = 1;
+        // Released and debounced before the next sleep
+        for (int i = 0; i < 100; i++) pedal_scan_row(&s, now += s.period_us, 0);
+        while (pedal_scan_pop(&s, &e)) {}
+    }
+    if (err || worst > PEDAL_SCAN_ROWS) {
+        fprintf(stderr, "press after resume: %d row samples, wrong edge %d\n", worst, err);
+        err = 1;
+    }
+    if (s.jitter.worst_us != before.worst_us ||
+        memcmp(&s.jitter.hist[1], &before.hist[1], sizeof(before.hist) - sizeof(before.hist[0]))) {
+        fprintf(stderr, "sleep counted as jitter: worst %u us\n", s.jitter.worst_us);
+        err = 1;
+    }
+    printf("resume:    press out after %d row samples (%u us), awake worst case %d, no jitter from the gap\n", worst,
+           worst * s.period_us, PEDAL_SCAN_ROWS);
+    return err;
+}
+
+static int check_gig(uint32_t minutes)
+{
+    pedal_idle_t d;
+    pedal_power_t sleeping, awake;
+    pedal_idle_init(&d, IDLE_MS, 0, 0);
+    pedal_power_init(&sleeping);
+    pedal_power_init(&awake);
+
+    uint32_t end = minutes * 60000, next_press = 1000, sweep_end = 0, song_end = 240000, songs = 0, presses = 0;
+    uint16_t exp = 0;
+    bool asleep = false;
+    uint32_t slept = 0;
+    for (uint32_t t = 0; t < end; t++) {
+        bool edge = false;
+        if (t >= song_end) {
+            // Between songs; every fourth one a longer break
+            next_press = t + (++songs % 4 ? 30000 : 600000);
+            song_end = next_press + 180000 + rnd(120000);
+        }
+        if (t == next_press) {
+            edge = true;
+            presses++;
+            next_press = t + 5000 + rnd(35000);
+            if (!rnd(4)) sweep_end = t + 1500;
+        }
+        if (t < sweep_end) exp = (exp + 7) & 0x7FFF;
+        // Asleep, the scan loop does not run until a column or the pedal wakes it
+        if (asleep && (edge || t < sweep_end)) {
+            asleep = false;
+            pedal_idle_init(&d, IDLE_MS, t, exp);
+        }
+        if (!asleep) asleep = pedal_idle_step(&d, t, 0, edge, exp);
+        slept += asleep;
+        if (t % 1000 == 999) {
+            pedal_power_add(&sleeping, 1000, slept, 1u << PEDAL_POWER_BLE);
+            pedal_power_add(&awake, 1000, 0, 1u << PEDAL_POWER_BLE);
+            slept = 0;
+        }
+    }
+    uint32_t ua = pedal_power_ua(&sleeping), ua0 = pedal_power_ua(&awake);
+    printf("gig:       %u min, %u presses, %u%% asleep: %.1f mA (%.0f h on %u mAh), never sleeping %.1f mA (%.0f h)\n",
+           minutes, presses, pedal_power_asleep_pct(&sleeping), ua / 1000.0, BATTERY_MAH * 1000.0 / ua, BATTERY_MAH,
+           ua0 / 1000.0, BATTERY_MAH * 1000.0 / ua0);
+    if (pedal_power_load_pct(&sleeping, PEDAL_POWER_BLE) != 100 || ua0 != PEDAL_POWER_AWAKE_UA + PEDAL_POWER_BLE_UA) {
+        fprintf(stderr, "estimate off: %u uA awake with BLE\n", ua0);
+        return 1;
+    }
+    if (minutes >= 10 && (pedal_power_asleep_pct(&sleeping) < 50 || ua * 2 > ua0)) {
+        fprintf(stderr, "idle sleep saved too little\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t minutes = 120;
+    if (argc == 3 && !strcmp(argv[1], "-n")) minutes = strtoul(argv[2], NULL, 10);
+    else if (argc != 1) {
+        fprintf(stderr, "usage: %s [-n minutes]\n", argv[0]);
+        return 2;
+    }
+    if (!minutes) minutes = 1;
+    return check_idle() || check_resume() || check_gig(minutes);
+}
@@ -0,0 +1,306 @@
+// Preset store on a simulated 128 KB NOR partition: capacity, recall cost
+// as the setlist grows, wear spread and power loss at every byte.
+//
+//   preset_bench <settings.json> [-n churn]
+//
+// Fails if a recalled preset differs from what was saved, if a remount
+// changes the index, if flash is programmed without an erase, or if a
+// reset during a save loses anything but that save.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bench_util.h"
+#include "pedal_blob.h"
+#include "pedal_config.h"
+#include "pedal_preset.h"
+
+#define FLASH_SIZE  (128 * 1024)
+#define SECTORS     (FLASH_SIZE / PEDAL_PRESET_SECTOR)
+
+typedef struct {
+    uint8_t mem[FLASH_SIZE];
+    uint32_t erases[SECTORS];
+    uint64_t bytes_read;
+    long budget;        // bytes/erases left before a simulated power cut, -1: unlimited
+    int bad_writes;     // bits programmed from 0 back to 1
+} sim_t;
+
+static sim_t sim;
+
+static int sim_read(void *ctx, uint32_t addr, void *buf, size_t len)
+{
+    sim_t *s = ctx;
+    if (addr + len > FLASH_SIZE) return -1;
+    memcpy(buf, s->mem + addr, len);
+    s->bytes_read += len;
+    return 0;
+}
+
+static int sim_write(void *ctx, uint32_t addr, const void *buf, size_t len)
+{
+    sim_t *s = ctx;
+    const uint8_t *b = buf;
+    if (addr + len > FLASH_SIZE) return -1;
+    for (size_t i = 0; i < len; i++) {
+        if (s->budget == 0) return -1;
+        if (s->budget > 0) s->budget--;
+        if ((s->mem[addr + i] & b[i]) != b[i]) s->bad_writes++;
+        s->mem[addr + i] &= b[i];
+    }
+    return 0;
+}
+
+static int sim_erase(void *ctx, uint32_t addr)
+{
+    sim_t *s = ctx;
+    if (addr % PEDAL_PRESET_SECTOR || addr >= FLASH_SIZE || s->budget == 0) return -1;
+    if (s->budget > 0) s->budget--;
+    memset(s->mem + addr, 0xFF, PEDAL_PRESET_SECTOR);
+    s->erases[addr / PEDAL_PRESET_SECTOR]++;
+    return 0;
+}
+
+static const pedal_flash_t flash = { sim_read, sim_write, sim_erase, &sim, FLASH_SIZE };
+
+static pedal_config_t base;
+
+// Variation "v" of the base rig: what a song preset typically changes
+static void make_preset(unsigned v, pedal_config_t *out)
+{
+    *out = base;
+    pedal_switch_t *sw = &out->banks[v % PEDAL_NUM_BANKS].sw[(v / 4) % PEDAL_NUM_SWITCHES];
+    sw->act[PEDAL_TRIG_PRESS].val = v & 0x7F;
+    if (v % 3 == 0) sw->flags ^= PEDAL_SW_TOGGLE;
+    out->banks[(v / 3) % PEDAL_NUM_BANKS].exp.cc = (v * 7) & 0x7F;
+    if (v % 5 == 0) out->brightness = v & 0xFF;
+    if (v % 7 == 0) {
+        out->banks[v % PEDAL_NUM_BANKS].sw[v % PEDAL_NUM_SWITCHES].act[PEDAL_TRIG_LONG] =
+            (pedal_action_t){ PEDAL_TYPE_PC, v & 0x0F, (v * 3) & 0x7F };
+    }
+}
+
+static int same_config(const pedal_config_t *a, const pedal_config_t *b)
+{
+    static uint8_t ba[PEDAL_BLOB_SIZE], bb[PEDAL_BLOB_SIZE];
+    pedal_blob_pack(a, ba, sizeof(ba));
+    pedal_blob_pack(b, bb, sizeof(bb));
+    return memcmp(ba, bb, sizeof(ba)) == 0;
+}
+
+static pedal_preset_store_t st;
+static unsigned expect[PEDAL_PRESET_MAX];     // variation stored in each slot, 0: empty
+
+static int verify_all(const char *when)
+{
+    static pedal_config_t got, want;
+    for (int id = 0; id < PEDAL_PRESET_MAX; id++) {
+        int err = pedal_preset_load(&st, id, &got);
+        if (!expect[id]) {
+            if (err != PEDAL_PRESET_ERR_ID || pedal_preset_name(&st, id)) {
+                fprintf(stderr, "%s: slot %d should be empty\n", when, id);
+                return -1;
+            }
+            continue;
+        }
+        make_preset(expect[id], &want);
+        char name[PEDAL_PRESET_NAME_MAX + 1];
+        snprintf(name, sizeof(name), "Song %u", expect[id]);
+        const char *stored = pedal_preset_name(&st, id);
+        if (err || !same_config(&got, &want) || !stored || strcmp(stored, name)) {
+            fprintf(stderr, "%s: slot %d (variation %u) does not match (err %d)\n", when, id, expect[id], err);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int save(int id, unsigned v)
+{
+    static pedal_config_t cfg;
+    char name[PEDAL_PRESET_NAME_MAX + 1];
+    make_preset(v, &cfg);
+    snprintf(name, sizeof(name), "Song %u", v);
+    return pedal_preset_save(&st, id, name, &cfg);
+}
+
+// Average recall and listing cost over the presets stored right now
+static void time_recall(int count)
+{
+    static pedal_config_t cfg;
+    const int rounds = 200;
+    uint64_t read0 = sim.bytes_read;
+    uint64_t t0 = now_ns();
+    for (int r = 0; r < rounds; r++) {
+        for (int id = 0; id < count; id++) pedal_preset_load(&st, id, &cfg);
+    }
+    uint64_t recall_ns = now_ns() - t0;
+    uint64_t recall_read = sim.bytes_read - read0;
+    size_t listed = 0;
+    t0 = now_ns();
+    for (int r = 0; r < rounds; r++) {
+        for (int id = 0; id < PEDAL_PRESET_MAX; id++) {
+            const char *n = pedal_preset_name(&st, id);
+            if (n) listed += strlen(n);
+        }
+    }
+    uint64_t list_ns = now_ns() - t0;
+    printf("  %3d presets: recall %6.0f ns, %4.0f bytes read   list %6.0f ns, 0 bytes read%s\n", count,
+           (double)recall_ns / (rounds * count), (double)recall_read / (rounds * count), (double)list_ns / rounds,
+           listed ? "" : " (empty)");
+}
+
+// Runs one save on a scratch copy; returns the bytes it writes, -1 on failure
+static long dry_run(int id, unsigned v, bool *reclaimed)
+{
+    static sim_t saved;
+    static pedal_preset_store_t saved_st;
+    saved = sim;
+    saved_st = st;
+    sim.budget = 1L << 30;
+    int err = save(id, v);
+    long total = (1L << 30) - sim.budget;
+    *reclaimed = st.head != saved_st.head;
+    sim = saved;
+    st = saved_st;
+    return err ? -1 : total;
+}
+
+// Cuts power after every possible number of written bytes during one save
+// and checks that a remount recalls either the old or the new preset.
+static int power_cut_sweep(int id, unsigned v, long total)
+{
+    static sim_t saved;
+    static pedal_preset_store_t saved_st;
+    saved = sim;
+    saved_st = st;
+    unsigned old = expect[id];
+    for (long cut = 0; cut < total; cut++) {
+        sim = saved;
+        sim.budget = cut;
+        st = saved_st;
+        save(id, v);
+        sim.budget = -1;
+        if (pedal_preset_mount(&st, &flash) != PEDAL_PRESET_OK) {
+            fprintf(stderr, "remount failed after cut at %ld/%ld\n", cut, total);
+            return -1;
+        }
+        expect[id] = old;
+        if (verify_all("power cut") != 0) {
+            expect[id] = v;
+            if (verify_all("power cut") != 0) {
+                fprintf(stderr, "cut at %ld/%ld bytes lost data\n", cut, total);
+                return -1;
+            }
+        }
+    }
+    sim = saved;
+    st = saved_st;
+    expect[id] = old;
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    int churn = 5000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) churn = atoi(argv[++i]);
+        else path = argv[i];
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s <settings.json> [-n churn]\n", argv[0]);
+        return 2;
+    }
+
+    size_t json_len;
+    char *json = read_file(path, &json_len);
+    pedal_config_defaults(&base);
+    if (!json || pedal_config_from_json(&base, json, json_len) != 0) {
+        fprintf(stderr, "cannot parse settings %s\n", path);
+        return 1;
+    }
+    free(json);
+
+    memset(sim.mem, 0x5A, sizeof(sim.mem));    // factory-fresh flash is not necessarily erased
+    sim.budget = -1;
+    if (pedal_preset_mount(&st, &flash) != PEDAL_PRESET_OK || verify_all("blank") != 0) return 1;
+
+    // Fill a setlist, timing recall as it grows
+    printf("recall/list cost as the setlist grows:\n");
+    const int steps[] = { 10, 50, 120 };
+    int saved = 0;
+    for (size_t k = 0; k < sizeof(steps) / sizeof(steps[0]); k++) {
+        for (; saved < steps[k]; saved++) {
+            if (save(saved, saved + 1) != PEDAL_PRESET_OK) {
+                fprintf(stderr, "save %d failed\n", saved);
+                return 1;
+            }
+            expect[saved] = saved + 1;
+        }
+        time_recall(saved);
+    }
+    if (verify_all("filled") != 0) return 1;
+    uint32_t per_preset = (st.live - st.base_slot.size) / saved;
+    printf("stored: base %u bytes + %d presets, %u bytes each on average (full snapshot: %u)\n",
+           st.base_slot.size, saved, per_preset, PEDAL_BLOB_SIZE + PEDAL_PRESET_NAME_MAX);
+
+    if (pedal_preset_mount(&st, &flash) != PEDAL_PRESET_OK || verify_all("remount") != 0) return 1;
+
+    // Edits during rehearsals: overwrite and delete at random
+    srand(1);
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < churn; i++) {
+        int id = rand() % PEDAL_PRESET_MAX;
+        if (rand() % 8 == 0 && expect[id]) {
+            if (pedal_preset_delete(&st, id) != PEDAL_PRESET_OK) {
+                fprintf(stderr, "delete %d failed\n", id);
+                return 1;
+            }
+            expect[id] = 0;
+        } else {
+            unsigned v = 1 + rand() % 1000;
+            if (save(id, v) != PEDAL_PRESET_OK) {
+                fprintf(stderr, "churn save %d failed\n", i);
+                return 1;
+            }
+            expect[id] = v;
+        }
+    }
+    uint64_t churn_ns = now_ns() - t0;
+    if (verify_all("churn") != 0) return 1;
+    if (pedal_preset_mount(&st, &flash) != PEDAL_PRESET_OK || verify_all("churn remount") != 0) return 1;
+    uint32_t emin = UINT32_MAX, emax = 0;
+    for (int s = 0; s < SECTORS; s++) {
+        if (sim.erases[s] < emin) emin = sim.erases[s];
+        if (sim.erases[s] > emax) emax = sim.erases[s];
+    }
+    printf("churn: %d edits, %.0f ns/edit, sector erases min %u max %u\n", churn, (double)churn_ns / churn, emin,
+           emax);
+
+    // Power loss during a plain save and during one that reclaims a sector
+    int cuts = 0;
+    for (int i = 0; i < 2; i++) {
+        int id = 7 + i;
+        unsigned v = 3000 + i;
+        bool reclaimed;
+        long total = dry_run(id, v, &reclaimed);
+        // The second save gets a head too full to take it and a victim sector
+        // still holding live presets, so it has to relocate them first
+        while (i == 1 && total >= 0 && !(reclaimed && total > PEDAL_PRESET_SECTOR / 4) && cuts < 5000) {
+            if (save(40, 2000 + cuts) != PEDAL_PRESET_OK) return 1;
+            expect[40] = 2000 + cuts++;
+            total = dry_run(id, v, &reclaimed);
+        }
+        if (total < 0 || power_cut_sweep(id, v, total) != 0) return 1;
+        printf("power cut: after each of %5ld written bytes of a save%s, old or new preset recalled\n", total,
+               reclaimed ? " with reclaim" : "");
+    }
+
+    if (sim.bad_writes) {
+        fprintf(stderr, "%d bytes programmed without an erase\n", sim.bad_writes);
+        return 1;
+    }
+    return 0;
+}
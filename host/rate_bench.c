@@ -0,0 +1,271 @@
+// Expression rate control: budgets, footswitch priority and jack check.
+//
+//   rate_bench [-n seconds]
+//
+// BLE: a pedal swept heel to toe and back every 150 ms for n seconds while
+// a footswitch sends a program change and a CC every 97 ms, over a 7.5 ms
+// connection interval at the default 23-byte MTU. Compared with queueing
+// every 7-bit change as before, the budgeted slot must keep the footswitch
+// messages within one connection interval of their press, never exceed
+// the budget, drop nothing, and end on the pedal's final 14-bit value.
+// USB: the same sweep paced at its budget stays within it, and the rate
+// meter reports what was sent.
+//
+// Jack: the CIC output of a plugged-in pedal (sweeps, a stomp, parked) must
+// never leave PEDAL_JACK_OK; a floating tip (hum plus noise) must be caught
+// within PEDAL_JACK_TURN_MS and stay caught, and an empty jack on the pulldown
+// within PEDAL_JACK_OPEN_MS; nothing may be sent once either is caught.
+// Reports ns per jack step.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bench_util.h"
+#include "pedal_exp_filter.h"
+#include "pedal_midi_out.h"
+
+#define INTERVAL_US  7500
+#define SWEEP_MS     150
+#define PRESS_MS     97
+#define BLE_HZ       50
+#define USB_HZ       100
+#define CH           0
+#define CC           11
+
+static double gauss(void)
+{
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+// Pedal position at ms, 14-bit, heel to toe and back every SWEEP_MS
+static uint16_t sweep(uint32_t ms, uint32_t end_ms)
+{
+    if (ms >= end_ms) ms = end_ms;
+    uint32_t ph = ms % (2 * SWEEP_MS);
+    uint32_t t = ph < SWEEP_MS ? ph : 2 * SWEEP_MS - ph;
+    return 16383u * t / SWEEP_MS;
+}
+
+typedef struct {
+    uint32_t presses, press_sent, worst_ms, total_ms;
+    uint32_t exp_values, msgs, dropped;
+    int msb, value;
+    uint32_t pending[64];       // press times waiting for their program change
+    unsigned head, tail;
+} ble_rx_t;
+
+// Reads back one BLE-MIDI packet: program changes are the footswitch,
+// CC / CC + 32 the expression pedal
+static void receive(ble_rx_t *rx, const uint8_t *pkt, size_t len, uint32_t now_ms, bool pairs)
+{
+    int status = 0;
+    for (size_t i = 1; i < len;) {
+        if (pkt[i] & 0x80) {
+            i++;                                      // timestamp
+            if (i < len && (pkt[i] & 0x80)) status = pkt[i++];
+        }
+        int n = (status & 0xF0) == 0xC0 ? 1 : 2;
+        const uint8_t *d = &pkt[i];
+        i += n;
+        rx->msgs++;
+        if ((status & 0xF0) == 0xC0) {
+            uint32_t ms = now_ms - rx->pending[rx->tail++ % 64];
+            rx->press_sent++;
+            rx->total_ms += ms;
+            if (ms > rx->worst_ms) rx->worst_ms = ms;
+        } else if (d[0] == CC && pairs) {
+            rx->msb = d[1];
+        } else if (d[0] == CC) {
+            rx->value = d[1] << 7;
+            rx->exp_values++;
+        } else if (d[0] == CC + 32) {
+            rx->value = rx->msb << 7 | d[1];
+            rx->exp_values++;
+        }
+    }
+}
+
+static ble_rx_t run_ble(bool budget, uint32_t secs)
+{
+    static pedal_ble_out_t b;
+    pedal_ble_out_init(&b, PEDAL_BLE_MTU_DEFAULT, INTERVAL_US);
+    pedal_exp_out_t o;
+    pedal_exp_out_init(&o, budget ? 14 : 7, budget ? 1000 / BLE_HZ : 0);
+    ble_rx_t rx = { .value = -1 };
+    uint32_t end_ms = secs * 1000;
+    for (uint32_t ms = 0; ms < end_ms + 200; ms++) {
+        if (ms % PRESS_MS == 5 && ms < end_ms) {
+            static const pedal_midi_msg_t press[2] = { { 2, { 0xC0 | CH, 3 } }, { 3, { 0xB0 | CH, 80, 127 } } };
+            rx.pending[rx.head++ % 64] = ms;
+            rx.presses++;
+            for (int k = 0; k < 2; k++) pedal_midi_queue_push(&b.q, &press[k], ms, NULL);
+        }
+        uint16_t v = sweep(ms, end_ms), prev;
+        if (pedal_exp_out_due(&o, v, ms, &prev)) {
+            if (budget) {
+                pedal_ble_out_exp(&b, CH, CC, v, ms);
+            } else {
+                pedal_midi_msg_t m = { 3, { 0xB0 | CH, CC, v >> 7 } };
+                pedal_midi_queue_push(&b.q, &m, ms, NULL);
+            }
+        }
+        uint8_t pkt[128];
+        size_t len = pedal_ble_out_poll(&b, ms * 1000, pkt, sizeof(pkt));
+        if (len) receive(&rx, pkt, len, ms, budget);
+    }
+    rx.dropped = b.q.dropped;
+    return rx;
+}
+
+static int check_ble(uint32_t secs)
+{
+    ble_rx_t q = run_ble(false, secs), s = run_ble(true, secs);
+    uint16_t last = sweep(secs * 1000, secs * 1000);
+    for (int i = 0; i < 2; i++) {
+        const ble_rx_t *r = i ? &s : &q;
+        double avg = r->press_sent ? (double)r->total_ms / r->press_sent : 0.0;
+        printf("ble %-7s presses %u sent %u  latency avg %.1f worst %u ms  expression %.0f/s  dropped %u\n",
+               i ? "budget:" : "queued:", r->presses, r->press_sent, avg, r->worst_ms,
+               (double)r->exp_values / secs, r->dropped);
+    }
+    int err = 0;
+    if (s.press_sent != s.presses || s.dropped || s.worst_ms > INTERVAL_US / 1000 + 1) {
+        fprintf(stderr, "footswitch messages waited behind the expression pedal\n");
+        err = 1;
+    }
+    if (s.exp_values > (uint64_t)BLE_HZ * secs + 1) {
+        fprintf(stderr, "BLE expression over budget\n");
+        err = 1;
+    }
+    if (s.value != last) {
+        fprintf(stderr, "BLE ended on %d, pedal at %u\n", s.value, last);
+        err = 1;
+    }
+    return err;
+}
+
+static int check_usb(uint32_t secs)
+{
+    pedal_exp_out_t o;
+    pedal_exp_out_init(&o, 14, 1000 / USB_HZ);
+    pedal_rate_t r = { 0 };
+    uint32_t sent = 0, end_ms = secs * 1000, max_hz = 0;
+    for (uint32_t ms = 0; ms < end_ms; ms++) {
+        uint16_t prev;
+        bool due = pedal_exp_out_due(&o, sweep(ms, end_ms), ms, &prev);
+        sent += due;
+        pedal_rate_add(&r, ms, due);
+        if (r.hz > max_hz) max_hz = r.hz;
+    }
+    printf("usb:           expression %.0f/s, meter up to %u/s\n", (double)sent / secs, max_hz);
+    if (sent > USB_HZ * secs + 1 || max_hz > USB_HZ || (secs > 1 && max_hz < USB_HZ * 9 / 10)) {
+        fprintf(stderr, "USB expression rate or meter off\n");
+        return 1;
+    }
+    return 0;
+}
+
+// --- jack --------------------------------------------------------------
+
+typedef double (*source_t)(double t);
+
+static double src_pedal(double t)
+{
+    if (t < 0.6) return 40 + 4040 * fabs(fmod(t, 0.3) - 0.15) / 0.15;  // fast sweeps
+    if (t < 0.8) return t < 0.7 ? 4080 : 40;                           // a stomp
+    if (t < 2.0) return 2000 + 1500 * sin(2 * M_PI * 0.7 * t);          // slow rocking
+    return 400;                                                        // parked
+}
+
+static double src_float(double t)
+{
+    return 1800 + 300 * sin(2 * M_PI * 0.3 * t) + 200 * sin(2 * M_PI * 50 * t) + 60 * gauss();
+}
+
+static double src_open(double t)
+{
+    return t < 1.0 ? 0 : 2500;                                         // empty, then plugged in
+}
+
+// Runs 32 kHz samples through the CIC and the jack check; returns the
+// first ms in bad state and how many values a paced sender let out after
+// it, plus how many ms were spent in bad states overall.
+static void run_jack(source_t src, double secs, double noise, int *first_bad, int *bad_ms, int *leaked,
+                     double *ns)
+{
+    pedal_cic_t cic;
+    pedal_jack_t j;
+    pedal_exp_out_t o;
+    pedal_cic_init(&cic);
+    pedal_jack_init(&j);
+    pedal_exp_out_init(&o, 14, 10);
+    *first_bad = -1;
+    *bad_ms = *leaked = 0;
+    uint64_t spent = 0;
+    int steps = 0;
+    for (int ms = 0; ms < secs * 1000; ms++) {
+        uint16_t in[PEDAL_CIC_R], out[2];
+        for (int i = 0; i < PEDAL_CIC_R; i++) {
+            long v = lround(src(ms / 1000.0 + i / 32000.0) + noise * gauss());
+            in[i] = v < 0 ? 0 : v > 4095 ? 4095 : v;
+        }
+        size_t n = pedal_cic_frame(&cic, in, PEDAL_CIC_R, out);
+        for (size_t k = 0; k < n; k++) {
+            uint64_t t0 = now_ns();
+            uint8_t st = pedal_jack_step(&j, out[k]);
+            spent += now_ns() - t0;
+            steps++;
+            uint16_t prev;
+            if (st != PEDAL_JACK_OK) {
+                if (*first_bad < 0) *first_bad = ms;
+                ++*bad_ms;
+            } else if (pedal_exp_out_due(&o, out[k] >> 2, ms, &prev) && *first_bad >= 0 && src == src_float) {
+                ++*leaked;
+            }
+        }
+    }
+    *ns = steps ? (double)spent / steps : 0;
+}
+
+static int check_jack(void)
+{
+    int first, bad, leaked, err = 0;
+    double ns;
+    run_jack(src_pedal, 3.0, 6.0, &first, &bad, &leaked, &ns);
+    printf("jack pedal:    %d ms not OK  (%.1f ns/step)\n", bad, ns);
+    if (bad) {
+        fprintf(stderr, "plugged-in pedal taken for an empty or floating jack at %d ms\n", first);
+        err = 1;
+    }
+    run_jack(src_float, 2.0, 0, &first, &bad, &leaked, &ns);
+    printf("jack floating: caught after %d ms, OK for %d of 2000 ms after, %d values sent\n", first,
+           2000 - first - bad, leaked);
+    if (first < 0 || first > PEDAL_JACK_TURN_MS || bad != 2000 - first || leaked) {
+        fprintf(stderr, "floating jack not caught\n");
+        err = 1;
+    }
+    run_jack(src_open, 2.0, 6.0, &first, &bad, &leaked, &ns);
+    printf("jack empty:    caught after %d ms, cleared %d ms after plugging in\n", first,
+           first < 0 ? -1 : first + bad - 1000);
+    if (first < PEDAL_JACK_OPEN_MS - 2 || first > PEDAL_JACK_OPEN_MS + 2 || first + bad > 1000 + 2) {
+        fprintf(stderr, "empty jack not caught or not cleared\n");
+        err = 1;
+    }
+    return err;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t secs = 5;
+    if (argc == 3 && !strcmp(argv[1], "-n")) secs = strtoul(argv[2], NULL, 10);
+    else if (argc != 1) {
+        fprintf(stderr, "usage: %s [-n seconds]\n", argv[0]);
+        return 2;
+    }
+    if (!secs) secs = 1;
+    srand(1);
+    return check_ble(secs) | check_usb(secs) | check_jack();
+}
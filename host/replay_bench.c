@@ -0,0 +1,428 @@
+// Deterministic footswitch replay against a settings document.
+//
+//   replay_bench <settings.json> <timeline> [golden] [-n iters] [--update] [--ble interval_us]
+//
+// The timeline is a list of "<t_ms> d|u <switch 1-8>" or "<t_ms> bank <1-4>"
+// lines ('#' starts a comment). The engine is driven exactly like the firmware
+// fast loop: edges for a millisecond first, then one tick, once per ms.
+// The MIDI output ("<t_ms> <hex bytes>" and "<t_ms> bank <n>" lines) is
+// compared with the golden file, then the replay is repeated for timing.
+//
+// --ble also replays the timeline over a simulated BLE link, once with a
+// notification per message and once through the batching scheduler
+// (pedal_midi_out.h), decodes the packets and compares delivery latency and
+// notification count.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bench_util.h"
+#include "pedal_config.h"
+#include "pedal_logic.h"
+#include "pedal_midi_out.h"
+#include "pedal_table.h"
+
+#define MAX_EVENTS 4096
+
+typedef struct {
+    uint32_t t_ms;
+    char kind;      // 'd', 'u' or 'b'
+    uint8_t arg;    // 0-based switch or bank
+} tl_event_t;
+
+typedef struct {
+    char *buf;
+    size_t len, cap;
+    uint32_t now_ms;
+    uint32_t msgs;
+} capture_t;
+
+static int load_timeline(const char *path, tl_event_t *ev, int max)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    char line[128];
+    int n = 0;
+    while (fgets(line, sizeof(line), f)) {
+        char *hash = strchr(line, '#');
+        if (hash) *hash = 0;
+        unsigned t, arg;
+        char kind[8];
+        if (sscanf(line, "%u %7s %u", &t, kind, &arg) != 3) continue;
+        if (n == max || arg < 1 || arg > 8) { fclose(f); return -1; }
+        ev[n].t_ms = t;
+        ev[n].kind = kind[0];
+        ev[n].arg = arg - 1;
+        n++;
+    }
+    fclose(f);
+    return n;
+}
+
+__attribute__((format(printf, 2, 3)))
+static void cap_printf(capture_t *c, const char *fmt, ...)
+{
+    if (c->cap - c->len < 64) {
+        c->cap = c->cap ? c->cap * 2 : 4096;
+        c->buf = realloc(c->buf, c->cap);
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    c->len += vsnprintf(c->buf + c->len, c->cap - c->len, fmt, ap);
+    va_end(ap);
+}
+
+static void capture_sink(void *ctx, const pedal_midi_msg_t *m)
+{
+    capture_t *c = ctx;
+    cap_printf(c, "%u", c->now_ms);
+    for (int i = 0; i < m->len; i++) cap_printf(c, " %02x", m->data[i]);
+    cap_printf(c, "\n");
+}
+
+static void count_sink(void *ctx, const pedal_midi_msg_t *m)
+{
+    capture_t *c = ctx;
+    (void)m;
+    c->msgs++;
+}
+
+#define HIST_BUCKET_NS 8
+#define HIST_BUCKETS   512
+
+// Worst case on a desktop OS includes preemption, so p99 is reported as well.
+typedef struct {
+    uint64_t total_ns, max_ns, count;
+    uint32_t hist[HIST_BUCKETS];
+} cost_t;
+
+typedef struct {
+    cost_t edge;
+    cost_t tick;
+} bench_stats_t;
+
+static uint64_t clock_overhead_ns;
+
+// Smallest back-to-back clock reading, subtracted from every sample.
+static void calibrate_clock(void)
+{
+    clock_overhead_ns = UINT64_MAX;
+    for (int i = 0; i < 10000; i++) {
+        uint64_t t0 = now_ns();
+        uint64_t dt = now_ns() - t0;
+        if (dt < clock_overhead_ns) clock_overhead_ns = dt;
+    }
+}
+
+static void cost_add(cost_t *c, uint64_t dt)
+{
+    dt = (dt > clock_overhead_ns) ? dt - clock_overhead_ns : 0;
+    c->total_ns += dt;
+    c->count++;
+    if (dt > c->max_ns) c->max_ns = dt;
+    uint64_t b = dt / HIST_BUCKET_NS;
+    c->hist[b < HIST_BUCKETS ? b : HIST_BUCKETS - 1]++;
+}
+
+static uint64_t cost_p99(const cost_t *c)
+{
+    uint64_t want = c->count - c->count / 100, seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += c->hist[b];
+        if (seen >= want) return (uint64_t)(b + 1) * HIST_BUCKET_NS;
+    }
+    return c->max_ns;
+}
+
+static void cost_print(const char *name, const cost_t *c)
+{
+    if (!c->count) return;
+    printf("%-6s %9llu  %7.1f ns avg  p99 <%llu ns  worst %llu ns\n", name, (unsigned long long)c->count,
+           (double)c->total_ns / c->count, (unsigned long long)cost_p99(c), (unsigned long long)c->max_ns);
+}
+
+static void replay(const pedal_table_t *tbl, const tl_event_t *ev, int n, pedal_midi_sink_t sink,
+                   capture_t *cap, bench_stats_t *st)
+{
+    pedal_logic_t lg;
+    pedal_logic_init(&lg, tbl, sink, cap);
+    uint8_t bank = lg.bank;
+    uint32_t end = (n ? ev[n - 1].t_ms : 0) + PEDAL_LONG_PRESS_MS + 1;
+    int i = 0;
+    for (uint32_t t = 0; t <= end; t++) {
+        cap->now_ms = t;
+        for (; i < n && ev[i].t_ms == t; i++) {
+            uint64_t t0 = st ? now_ns() : 0;
+            if (ev[i].kind == 'b') pedal_logic_set_bank(&lg, ev[i].arg);
+            else pedal_logic_edge(&lg, ev[i].arg, ev[i].kind == 'd', t);
+            if (st) cost_add(&st->edge, now_ns() - t0);
+        }
+        uint64_t t0 = st ? now_ns() : 0;
+        pedal_logic_tick(&lg, t);
+        if (st) cost_add(&st->tick, now_ns() - t0);
+        if (!st && lg.bank != bank) {
+            bank = lg.bank;
+            cap_printf(cap, "%u bank %u\n", t, bank + 1);
+        }
+    }
+}
+
+// Simulated BLE link: connection events every interval_us (starting half an
+// interval in), each carrying one notification from the controller queue.
+#define LINK_QUEUE 4096
+
+typedef struct {
+    uint32_t interval_us;
+    uint32_t sent_us[LINK_QUEUE];        // when the notification was handed over
+    uint8_t pkt[LINK_QUEUE][PEDAL_BLE_MTU_DEFAULT];
+    uint8_t len[LINK_QUEUE];
+    int n;
+} ble_link_t;
+
+typedef struct {
+    pedal_ble_out_t out;
+    ble_link_t link;
+    uint32_t now_ms;
+    bool batch;
+    uint32_t gen_ms[MAX_EVENTS * 8];     // every message, in order
+    pedal_midi_msg_t gen[MAX_EVENTS * 8];
+    int ngen;
+} ble_sim_t;
+
+static void link_send(ble_link_t *l, uint32_t now_us, const uint8_t *pkt, size_t len)
+{
+    if (l->n == LINK_QUEUE) return;
+    l->sent_us[l->n] = now_us;
+    memcpy(l->pkt[l->n], pkt, len);
+    l->len[l->n++] = len;
+}
+
+static void ble_sink(void *ctx, const pedal_midi_msg_t *m)
+{
+    ble_sim_t *s = ctx;
+    if (s->ngen < MAX_EVENTS * 8) {
+        s->gen_ms[s->ngen] = s->now_ms;
+        s->gen[s->ngen++] = *m;
+    }
+    if (s->batch) {
+        pedal_midi_queue_push(&s->out.q, m, s->now_ms, NULL);
+    } else {
+        // One notification per message, sent straight away
+        uint8_t pkt[8] = { 0x80 | ((s->now_ms >> 7) & 0x3F), 0x80 | (s->now_ms & 0x7F) };
+        memcpy(pkt + 2, m->data, m->len);
+        link_send(&s->link, s->now_ms * 1000, pkt, 2 + m->len);
+    }
+}
+
+static int midi_len(uint8_t status)
+{
+    if (status >= 0xF0) return 1;
+    return (status & 0xE0) == 0xC0 ? 2 : 3;
+}
+
+typedef struct {
+    int notifications;
+    double avg_us;
+    uint32_t worst_us;
+} ble_result_t;
+
+// Delivers the link queue and checks that the decoded stream matches what was produced
+static int ble_deliver(const ble_sim_t *s, ble_result_t *r)
+{
+    const ble_link_t *l = &s->link;
+    uint32_t ce = l->interval_us / 2;
+    int k = 0;
+    double total = 0;
+    *r = (ble_result_t){ .notifications = l->n };
+    for (int p = 0; p < l->n; p++) {
+        while (ce < l->sent_us[p]) ce += l->interval_us;
+        const uint8_t *b = l->pkt[p];
+        uint32_t hi = b[0] & 0x3F;
+        int lo = -1, status = 0;
+        for (int i = 1; i < l->len[p];) {
+            if (b[i] & 0x80) {
+                int t = b[i++] & 0x7F;
+                if (lo >= 0 && t < lo) hi++;
+                lo = t;
+                if (i < l->len[p] && (b[i] & 0x80)) status = b[i++];
+            }
+            int len = midi_len(status);
+            if (k == s->ngen || s->gen[k].data[0] != status || s->gen[k].len != len ||
+                memcmp(s->gen[k].data + 1, b + i, len - 1) != 0 ||
+                ((hi << 7 | lo) & 0x1FFF) != (s->gen_ms[k] & 0x1FFF)) {
+                fprintf(stderr, "BLE stream differs at message %d (packet %d)\n", k, p);
+                return -1;
+            }
+            i += len - 1;
+            uint32_t lat = ce - s->gen_ms[k] * 1000;
+            total += lat;
+            if (lat > r->worst_us) r->worst_us = lat;
+            k++;
+        }
+        ce += l->interval_us;
+    }
+    if (k != s->ngen) {
+        fprintf(stderr, "BLE stream lost %d messages\n", s->ngen - k);
+        return -1;
+    }
+    r->avg_us = k ? total / k : 0;
+    return 0;
+}
+
+static int ble_replay(const pedal_table_t *tbl, const tl_event_t *ev, int n, uint32_t interval_us, bool batch,
+                      ble_sim_t *s, ble_result_t *r)
+{
+    memset(s, 0, sizeof(*s));
+    s->batch = batch;
+    s->link.interval_us = interval_us;
+    pedal_ble_out_init(&s->out, PEDAL_BLE_MTU_DEFAULT, interval_us);
+    pedal_logic_t lg;
+    pedal_logic_init(&lg, tbl, ble_sink, s);
+    uint32_t end = (n ? ev[n - 1].t_ms : 0) + PEDAL_LONG_PRESS_MS + 1;
+    int i = 0;
+    for (uint32_t t = 0; t <= end || !pedal_midi_queue_empty(&s->out.q); t++) {
+        s->now_ms = t;
+        for (; i < n && ev[i].t_ms == t; i++) {
+            if (ev[i].kind == 'b') pedal_logic_set_bank(&lg, ev[i].arg);
+            else pedal_logic_edge(&lg, ev[i].arg, ev[i].kind == 'd', t);
+        }
+        pedal_logic_tick(&lg, t);
+        uint8_t pkt[PEDAL_BLE_MTU_DEFAULT];
+        size_t len = pedal_ble_out_poll(&s->out, t * 1000, pkt, sizeof(pkt));
+        if (len) link_send(&s->link, t * 1000, pkt, len);
+    }
+    return ble_deliver(s, r);
+}
+
+static int ble_compare(const pedal_table_t *tbl, const tl_event_t *ev, int n, uint32_t interval_us)
+{
+    static ble_sim_t sim;
+    ble_result_t single, batched;
+    if (ble_replay(tbl, ev, n, interval_us, false, &sim, &single)) return -1;
+    if (ble_replay(tbl, ev, n, interval_us, true, &sim, &batched)) return -1;
+    printf("ble:    %u us interval, MTU %u, %d msgs\n", (unsigned)interval_us, PEDAL_BLE_MTU_DEFAULT, sim.ngen);
+    printf("  per message: %5d notifications  latency %7.0f us avg  worst %u us\n", single.notifications,
+           single.avg_us, (unsigned)single.worst_us);
+    printf("  batched:     %5d notifications  latency %7.0f us avg  worst %u us  (%.2f msgs/packet, max %u)\n",
+           batched.notifications, batched.avg_us, (unsigned)batched.worst_us,
+           (double)sim.out.msgs / (sim.out.packets ? sim.out.packets : 1), sim.out.max_msgs);
+    if (batched.notifications > single.notifications || batched.worst_us > single.worst_us) {
+        fprintf(stderr, "batching made BLE delivery worse\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Golden comparison ignores comment and blank lines on both sides.
+static const char *next_line(const char *p, const char **end)
+{
+    while (*p) {
+        const char *e = strchr(p, '\n');
+        if (!e) e = p + strlen(p);
+        if (e > p && *p != '#') { *end = e; return p; }
+        p = *e ? e + 1 : e;
+    }
+    return NULL;
+}
+
+static int compare_golden(const char *golden, const char *got)
+{
+    const char *ge, *oe;
+    const char *g = next_line(golden, &ge), *o = next_line(got, &oe);
+    int line = 1;
+    while (g && o) {
+        if (ge - g != oe - o || memcmp(g, o, ge - g) != 0) {
+            fprintf(stderr, "mismatch at output line %d:\n  expected: %.*s\n  got:      %.*s\n",
+                    line, (int)(ge - g), g, (int)(oe - o), o);
+            return -1;
+        }
+        g = next_line(*ge ? ge + 1 : ge, &ge);
+        o = next_line(*oe ? oe + 1 : oe, &oe);
+        line++;
+    }
+    if (g || o) {
+        fprintf(stderr, "mismatch at output line %d: %s\n", line, g ? "output too short" : "output too long");
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *paths[3] = { 0 };
+    int npaths = 0, iters = 2000;
+    uint32_t ble_us = 0;
+    bool update = false;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) iters = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--update")) update = true;
+        else if (!strcmp(argv[i], "--ble") && i + 1 < argc) ble_us = atoi(argv[++i]);
+        else if (npaths < 3) paths[npaths++] = argv[i];
+    }
+    if (npaths < 2) {
+        fprintf(stderr, "usage: %s <settings.json> <timeline> [golden] [-n iters] [--update] [--ble interval_us]\n", argv[0]);
+        return 2;
+    }
+
+    size_t json_len;
+    char *json = read_file(paths[0], &json_len);
+    pedal_config_t cfg;
+    pedal_config_defaults(&cfg);
+    if (!json || pedal_config_from_json(&cfg, json, json_len) != 0) {
+        fprintf(stderr, "cannot parse settings %s\n", paths[0]);
+        return 1;
+    }
+    free(json);
+
+    static pedal_table_t tbl;
+    uint64_t t0 = now_ns();
+    pedal_table_compile(&tbl, &cfg);
+    uint64_t compile_ns = now_ns() - t0;
+
+    static tl_event_t ev[MAX_EVENTS];
+    int n = load_timeline(paths[1], ev, MAX_EVENTS);
+    if (n < 0) {
+        fprintf(stderr, "cannot read timeline %s\n", paths[1]);
+        return 1;
+    }
+
+    capture_t cap = { 0 };
+    cap_printf(&cap, "%s", "");     // allocate, so an empty replay is still a string
+    replay(&tbl, ev, n, capture_sink, &cap, NULL);
+
+    int rc = 0;
+    if (paths[2] && update) {
+        FILE *f = fopen(paths[2], "w");
+        if (!f) return 1;
+        fwrite(cap.buf, 1, cap.len, f);
+        fclose(f);
+        printf("golden written: %s\n", paths[2]);
+    } else if (paths[2]) {
+        char *golden = read_file(paths[2], NULL);
+        if (!golden) {
+            fprintf(stderr, "cannot read golden %s\n", paths[2]);
+            return 1;
+        }
+        rc = compare_golden(golden, cap.buf) ? 1 : 0;
+        free(golden);
+        printf("golden: %s\n", rc ? "FAIL" : "ok");
+    } else {
+        fwrite(cap.buf, 1, cap.len, stdout);
+    }
+
+    static bench_stats_t st;
+    calibrate_clock();
+    capture_t counter = { 0 };
+    for (int i = 0; i < iters; i++) replay(&tbl, ev, n, count_sink, &counter, &st);
+    printf("table: %zu bytes, compiled in %llu ns\n", sizeof(tbl), (unsigned long long)compile_ns);
+    printf("clock overhead %llu ns subtracted\n", (unsigned long long)clock_overhead_ns);
+    cost_print("edges:", &st.edge);
+    cost_print("ticks:", &st.tick);
+    printf("msgs:   %u per replay\n", iters ? counter.msgs / iters : 0);
+    if (ble_us && ble_compare(&tbl, ev, n, ble_us)) rc = 1;
+
+    free(cap.buf);
+    return rc;
+}
@@ -0,0 +1,188 @@
+// Matrix scanner against bouncing switches.
+//
+//   scan_bench [-n presses] [-r rate_hz]
+//
+// Simulates the timer interrupt sampling one row per period, a few us
+// late at random, while random switches are pressed and released with up
+// to 3 ms of contact bounce after every transition. Fails unless each
+// press and release yields exactly one edge within one scan period plus
+// the bounce. Also checks the jitter histogram and dropped-edge
+// accounting, and reports the cost of one row sample.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bench_util.h"
+#include "pedal_scan.h"
+
+#define SWITCHES     (PEDAL_SCAN_ROWS * PEDAL_SCAN_COLS)
+#define DEBOUNCE_MS  5
+#define BOUNCE_US    3000
+#define LATE_US      8                   // interrupt latency spread
+#define MIN_HOLD_US  30000
+
+typedef struct {
+    uint32_t next_us;                    // next transition
+    uint32_t changed_us;                 // last transition
+    uint32_t bounce_until;
+    int down;
+    int pending;                         // transition not reported yet
+} sw_t;
+
+static uint32_t hold_us(void)
+{
+    return MIN_HOLD_US + rand() % 200000;
+}
+
+// What the column of s reads at t
+static int contact(sw_t *s, uint32_t t, uint32_t *transitions)
+{
+    if (t >= s->next_us) {
+        s->down = !s->down;
+        s->changed_us = s->next_us;
+        s->bounce_until = s->next_us + rand() % BOUNCE_US;
+        s->next_us += hold_us();
+        s->pending++;
+        (*transitions)++;
+    }
+    if (t < s->bounce_until) return rand() & 1;
+    return s->down;
+}
+
+static int run_bounce(uint32_t presses, uint32_t rate_hz)
+{
+    static pedal_scan_t scan;
+    pedal_scan_init(&scan, rate_hz, DEBOUNCE_MS);
+    sw_t sw[SWITCHES];
+    for (int i = 0; i < SWITCHES; i++) sw[i] = (sw_t){ .next_us = hold_us() };
+
+    uint32_t transitions = 0, edges = 0, worst_us = 0;
+    uint64_t lat_sum = 0, cost_ns = 0, samples = 0;
+    uint32_t limit = BOUNCE_US + PEDAL_SCAN_ROWS * scan.period_us + LATE_US;
+    for (uint32_t t = 0; transitions < presses * 2; t += scan.period_us) {
+        uint32_t at = t + rand() % LATE_US;
+        uint8_t cols = 0;
+        sw_t *row = &sw[scan.row * PEDAL_SCAN_COLS];
+        for (int c = 0; c < PEDAL_SCAN_COLS; c++) {
+            if (contact(&row[c], at, &transitions)) cols |= 1 << c;
+        }
+        uint64_t t0 = now_ns();
+        pedal_scan_row(&scan, at, cols);
+        cost_ns += now_ns() - t0;
+        samples++;
+
+        pedal_scan_edge_t e;
+        while (pedal_scan_pop(&scan, &e)) {
+            sw_t *s = &sw[e.sw];
+            uint32_t lat = e.us - s->changed_us;
+            if (s->pending != 1 || e.down != s->down || lat > limit) {
+                fprintf(stderr, "switch %u: unexpected %s edge %u us after its transition\n", e.sw,
+                        e.down ? "down" : "up", lat);
+                return 1;
+            }
+            s->pending = 0;
+            lat_sum += lat;
+            if (lat > worst_us) worst_us = lat;
+            edges++;
+        }
+    }
+    for (int i = 0; i < SWITCHES; i++) edges += sw[i].pending;     // still inside the scan period
+
+    printf("%u Hz: %u transitions -> %u edges, latency avg %.0f us, worst %u us (bound %u), %.1f ns/row sample\n",
+           rate_hz, transitions, edges, edges ? (double)lat_sum / edges : 0.0, worst_us, limit,
+           (double)cost_ns / samples);
+    if (edges != transitions || scan.dropped) {
+        fprintf(stderr, "%u edges for %u transitions, %u dropped\n", edges, transitions, scan.dropped);
+        return 1;
+    }
+    // Samples came 0..LATE_US-1 us late, so intervals are off by less than LATE_US
+    const pedal_scan_jitter_t *j = &scan.jitter;
+    uint32_t counted = 0;
+    for (int b = 0; b < PEDAL_SCAN_JITTER_BUCKETS; b++) counted += j->hist[b];
+    if (counted != j->samples - 1 || j->worst_us >= LATE_US ||
+        j->hist[pedal_scan_jitter_bucket(LATE_US)] != 0) {
+        fprintf(stderr, "jitter histogram off: %u of %u samples, worst %u us\n", counted, j->samples, j->worst_us);
+        return 1;
+    }
+    return 0;
+}
+
+static int check_buckets(void)
+{
+    static const struct { uint32_t us; int bucket; } cases[] = {
+        { 0, 0 }, { 1, 1 }, { 2, 2 }, { 3, 2 }, { 4, 3 }, { 1023, 10 }, { 1024, 11 }, { 100000, 11 },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        if (pedal_scan_jitter_bucket(cases[i].us) != cases[i].bucket) {
+            fprintf(stderr, "%u us in bucket %d, expected %d\n", cases[i].us,
+                    pedal_scan_jitter_bucket(cases[i].us), cases[i].bucket);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// A logic task that falls behind: edges beyond the ring are counted, not
+// corrupted, and a refused edge comes again once there is room, so what the
+// consumer sees always alternates and ends on the switches' real state
+static int check_overflow(void)
+{
+    static pedal_scan_t scan;
+    pedal_scan_init(&scan, 4000, 1);
+    uint32_t t = 0;
+    // Ends with the switches down, pressed while the ring was full
+    for (int i = 0; i < 384; i++) {
+        uint8_t cols = (i / 16) & 1 ? 0xF : 0;         // every switch flips every 8 scans
+        pedal_scan_row(&scan, t += scan.period_us, cols);
+    }
+    pedal_scan_edge_t e;
+    uint32_t popped = 0;
+    uint8_t seen = 0;
+    while (pedal_scan_pop(&scan, &e)) {
+        if (e.down == ((seen >> e.sw) & 1)) {
+            fprintf(stderr, "overflow: switch %u %s twice\n", e.sw, e.down ? "pressed" : "released");
+            return 1;
+        }
+        seen ^= 1u << e.sw;
+        popped++;
+    }
+    if (popped != PEDAL_SCAN_EDGES || !scan.dropped) {
+        fprintf(stderr, "overflow: %u popped, %u dropped\n", popped, scan.dropped);
+        return 1;
+    }
+    // Drained; every switch released by now. The refused edges are retried
+    for (int i = 0; i < 100; i++) {
+        pedal_scan_row(&scan, t += scan.period_us, 0);
+        while (pedal_scan_pop(&scan, &e)) {
+            if (e.down == ((seen >> e.sw) & 1)) {
+                fprintf(stderr, "overflow: switch %u %s twice\n", e.sw, e.down ? "pressed" : "released");
+                return 1;
+            }
+            seen ^= 1u << e.sw;
+        }
+    }
+    if (seen || scan.state) {
+        fprintf(stderr, "overflow: switches 0x%02x stuck (scan 0x%02x)\n", seen, scan.state);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t presses = 20000, rate = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "-n")) presses = strtoul(argv[i + 1], NULL, 10);
+        else if (!strcmp(argv[i], "-r")) rate = strtoul(argv[i + 1], NULL, 10);
+        else argc = 0;
+    }
+    if (argc % 2 == 0) {
+        fprintf(stderr, "usage: %s [-n presses] [-r rate_hz]\n", argv[0]);
+        return 2;
+    }
+    srand(1);
+    if (check_buckets() || check_overflow()) return 1;
+    if (rate) return run_bounce(presses, rate);
+    return run_bounce(presses, 1000) || run_bounce(presses, 2000) || run_bounce(presses, 4000);
+}
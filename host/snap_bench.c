@@ -0,0 +1,201 @@
+// Config snapshots: publish by pointer swap, reclaim behind the reader.
+//
+//   snap_bench [-n publishes]
+//
+// A reader thread runs scan iterations (acquire, read the whole snapshot,
+// release) while a writer thread publishes n snapshots, each built in the
+// spare buffer with every word set to its sequence number, the way
+// /api/save, /api/patch and /api/preset/load publish a compiled config.
+// Fails if the reader ever sees a torn snapshot, goes back to an older one,
+// or is not on the last one at the end. Reports the reader's cost per
+// acquire + release and how often the writer had to wait for the spare.
+//
+// Also runs a real config through it: each round a handler publishes a
+// recompiled table with switch 0 flipped between two program numbers and
+// a scan iteration presses the switch, which must send exactly one of them.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bench_util.h"
+#include "pedal_logic.h"
+#include "pedal_snap.h"
+
+#define SNAP_WORDS 1024
+
+typedef struct {
+    uint32_t w[SNAP_WORDS];
+} snap_t;
+
+typedef struct {
+    pedal_snap_t s;
+    snap_t buf[2];
+    uint32_t count;
+    volatile int done;
+    uint32_t iterations, waits, changes;
+    uint64_t acquire_ns;
+    int error;
+} bench_t;
+
+static void *reader(void *arg)
+{
+    bench_t *b = arg;
+    uint32_t last = 0;
+    for (;;) {
+        int done = __atomic_load_n(&b->done, __ATOMIC_ACQUIRE);
+        uint64_t t0 = now_ns();
+        const snap_t *p = pedal_snap_acquire(&b->s);
+        b->acquire_ns += now_ns() - t0;
+        uint32_t seq = p->w[0];
+        for (int k = 1; k < SNAP_WORDS; k++) {
+            if (p->w[k] != seq) {
+                fprintf(stderr, "torn snapshot: word %d is %u, word 0 %u\n", k, p->w[k], seq);
+                b->error = 1;
+                break;
+            }
+        }
+        if (seq < last) {
+            fprintf(stderr, "went back from %u to %u\n", last, seq);
+            b->error = 1;
+        }
+        b->changes += seq != last;
+        last = seq;
+        t0 = now_ns();
+        pedal_snap_release(&b->s);
+        b->acquire_ns += now_ns() - t0;
+        b->iterations++;
+        if (done || b->error) break;
+        sched_yield();
+    }
+    if (last != b->count) {
+        fprintf(stderr, "reader ended on %u, last published %u\n", last, b->count);
+        b->error = 1;
+    }
+    return NULL;
+}
+
+static void *writer(void *arg)
+{
+    bench_t *b = arg;
+    for (uint32_t seq = 1; seq <= b->count; seq++) {
+        snap_t *next;
+        while (!(next = pedal_snap_spare(&b->s))) {
+            b->waits++;
+            sched_yield();
+        }
+        for (int k = 0; k < SNAP_WORDS; k++) next->w[k] = seq;
+        pedal_snap_publish(&b->s, next);
+        sched_yield();
+    }
+    __atomic_store_n(&b->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static int run_threads(uint32_t count)
+{
+    static bench_t b;
+    memset(&b, 0, sizeof(b));
+    pedal_snap_init(&b.s, &b.buf[0], &b.buf[1]);
+    b.count = count;
+    pthread_t r, w;
+    pthread_create(&r, NULL, reader, &b);
+    pthread_create(&w, NULL, writer, &b);
+    pthread_join(w, NULL);
+    pthread_join(r, NULL);
+    printf("threads:   %u published, %u reader iterations saw %u of them, writer waited %u times, "
+           "%.1f ns per acquire + release\n",
+           count, b.iterations, b.changes, b.waits, b.iterations ? (double)b.acquire_ns / b.iterations : 0.0);
+    return b.error;
+}
+
+// Single-threaded interleavings: the spare is never the held snapshot
+static int check_reclaim(void)
+{
+    pedal_snap_t s;
+    int a, c;
+    pedal_snap_init(&s, &a, &c);
+    int err = pedal_snap_acquire(&s) != &a || pedal_snap_spare(&s) != &c;
+    pedal_snap_publish(&s, &c);
+    // Still holding a: it is the spare now, and not to be handed out
+    err |= pedal_snap_spare(&s) != NULL;
+    pedal_snap_release(&s);
+    err |= pedal_snap_spare(&s) != &a;
+    // The next iteration moved on to c, so a is free again while c is held
+    err |= pedal_snap_acquire(&s) != &c || pedal_snap_spare(&s) != &a;
+    pedal_snap_release(&s);
+    if (err) fprintf(stderr, "spare handed out while held\n");
+    return err;
+}
+
+// --- a real config -------------------------------------------------------
+
+typedef struct {
+    pedal_config_t cfg;
+    pedal_table_t table;
+} config_snap_t;
+
+static int sent_pc, sent_other;
+
+static void sink(void *ctx, const pedal_midi_msg_t *msg)
+{
+    (void)ctx;
+    if ((msg->data[0] & 0xF0) != 0xC0) return;
+    if (msg->data[1] == 10 || msg->data[1] == 20) sent_pc++;
+    else sent_other++;
+}
+
+static int check_config(uint32_t rounds)
+{
+    static config_snap_t snaps[2];
+    pedal_snap_t s;
+    pedal_snap_init(&s, &snaps[0], &snaps[1]);
+    pedal_config_defaults(&snaps[0].cfg);
+    snaps[0].cfg.banks[0].sw[0].act[PEDAL_TRIG_PRESS] = (pedal_action_t){ PEDAL_TYPE_PC, 0, 10 };
+    pedal_table_compile(&snaps[0].table, &snaps[0].cfg);
+
+    pedal_logic_t lg;
+    pedal_logic_init(&lg, &snaps[0].table, sink, NULL);
+    sent_pc = sent_other = 0;
+    uint64_t compile_ns = 0;
+    for (uint32_t i = 0; i < rounds; i++) {
+        // Handler: the other program number, compiled off to the side
+        config_snap_t *next = pedal_snap_spare(&s);
+        if (!next) return 1;
+        const config_snap_t *live = pedal_snap_live(&s);
+        next->cfg = live->cfg;
+        next->cfg.banks[0].sw[0].act[PEDAL_TRIG_PRESS].val = live->cfg.banks[0].sw[0].act[PEDAL_TRIG_PRESS].val == 10 ? 20 : 10;
+        uint64_t t0 = now_ns();
+        pedal_table_compile(&next->table, &next->cfg);
+        compile_ns += now_ns() - t0;
+        pedal_snap_publish(&s, next);
+
+        // Scan loop iteration: press and release switch 0
+        const config_snap_t *snap = pedal_snap_acquire(&s);
+        lg.tbl = &snap->table;
+        pedal_logic_edge(&lg, 0, true, i * 10);
+        pedal_logic_edge(&lg, 0, false, i * 10 + 5);
+        pedal_snap_release(&s);
+    }
+    printf("config:    %u swaps, %d program changes sent, %.1f us per compile (handler side)\n", rounds, sent_pc,
+           rounds ? compile_ns / 1e3 / rounds : 0.0);
+    if (sent_pc != (int)rounds || sent_other) {
+        fprintf(stderr, "presses sent %d expected and %d other program changes\n", sent_pc, sent_other);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t count = 100000;
+    if (argc == 3 && !strcmp(argv[1], "-n")) count = strtoul(argv[2], NULL, 10);
+    else if (argc != 1) {
+        fprintf(stderr, "usage: %s [-n publishes]\n", argv[0]);
+        return 2;
+    }
+    if (!count) count = 1;
+    return check_reclaim() || run_threads(count) || check_config(count < 1000 ? count : 1000);
+}
@@ -0,0 +1,242 @@
+// Cross-core hand-off: pedal_spsc rings and pedal_latest under two threads.
+//
+//   spsc_bench [-n records]
+//
+// ring:   a producer fills packet-sized records into a 4-slot ring (the
+//         BLE packet ring) while a consumer drains it; once waiting for
+//         room, once never waiting as the real-time side does, against a
+//         consumer that now and then sleeps. Fails if a record arrives
+//         torn, out of order, twice, or goes missing without the producer
+//         having seen the ring full.
+// latest: a producer publishes status-sized records while a consumer
+//         keeps taking the newest. Fails if a taken record is torn or
+//         older than one taken before, or if the last one published is
+//         not what the consumer ends on. Reports the producer's cost per
+//         publish, average and worst.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bench_util.h"
+#include "pedal_spsc.h"
+#include "pedal_status.h"
+
+#define RING_SLOTS  4
+#define PKT_WORDS   32              // a 128-byte BLE packet
+#define STATUS_WORDS ((sizeof(pedal_status_t) + 3) / 4)
+
+// Every word of record i holds i, so a torn read shows
+static void fill(uint32_t *w, size_t n, uint32_t i)
+{
+    for (size_t k = 0; k < n; k++) w[k] = i;
+}
+
+static int torn(const uint32_t *w, size_t n)
+{
+    for (size_t k = 1; k < n; k++)
+        if (w[k] != w[0]) return 1;
+    return 0;
+}
+
+// --- ring ---------------------------------------------------------------
+
+typedef struct {
+    pedal_spsc_t ring;
+    uint32_t slot[RING_SLOTS][PKT_WORDS];
+    uint32_t count, full, received;
+    int wait;
+    volatile int done;
+    int error;
+} ring_t;
+
+static void *ring_producer(void *arg)
+{
+    ring_t *b = arg;
+    for (uint32_t i = 0; i < b->count; i++) {
+        int s;
+        while ((s = pedal_spsc_slot(&b->ring)) < 0) {
+            if (!b->wait) break;
+            sched_yield();
+        }
+        if (s < 0) {
+            b->full++;
+            continue;
+        }
+        fill(b->slot[s], PKT_WORDS, i);
+        pedal_spsc_push(&b->ring);
+        if (!b->wait) {
+            struct timespec ts = { 0, 1000 };       // the rest of a scan iteration
+            nanosleep(&ts, NULL);
+        }
+    }
+    __atomic_store_n(&b->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void *ring_consumer(void *arg)
+{
+    ring_t *b = arg;
+    int64_t last = -1;
+    for (;;) {
+        int done = __atomic_load_n(&b->done, __ATOMIC_ACQUIRE);
+        int s = pedal_spsc_front(&b->ring);
+        if (s < 0) {
+            if (done) break;
+            sched_yield();
+            continue;
+        }
+        const uint32_t *w = b->slot[s];
+        if (torn(w, PKT_WORDS) || (int64_t)w[0] <= last || (b->wait && w[0] != last + 1)) {
+            fprintf(stderr, "record %u after %lld\n", w[0], (long long)last);
+            b->error = 1;
+            return NULL;
+        }
+        last = w[0];
+        b->received++;
+        pedal_spsc_pop(&b->ring);
+        if (!b->wait && !(b->received & 15)) {
+            struct timespec ts = { 0, 20000 };      // core 0 busy elsewhere
+            nanosleep(&ts, NULL);
+        }
+    }
+    return NULL;
+}
+
+static int run_ring(uint32_t count, int wait)
+{
+    static ring_t b;
+    memset(&b, 0, sizeof(b));
+    pedal_spsc_init(&b.ring, RING_SLOTS);
+    b.count = count;
+    b.wait = wait;
+    pthread_t p, c;
+    uint64_t t0 = now_ns();
+    pthread_create(&c, NULL, ring_consumer, &b);
+    pthread_create(&p, NULL, ring_producer, &b);
+    pthread_join(p, NULL);
+    pthread_join(c, NULL);
+    double s = (now_ns() - t0) / 1e9;
+    printf("ring %-8s %8u records  %5.2f M/s  full %u\n", wait ? "waiting:" : "never:", b.received,
+           b.received / s / 1e6, b.full);
+    if (b.error) return 1;
+    if (b.received + b.full != count) {
+        fprintf(stderr, "%u received + %u refused != %u produced\n", b.received, b.full, count);
+        return 1;
+    }
+    return 0;
+}
+
+// --- newest value ---------------------------------------------------------
+
+typedef struct {
+    pedal_latest_t x;
+    uint32_t slot[PEDAL_LATEST_SLOTS][STATUS_WORDS];
+    uint32_t count, taken;
+    volatile int done;
+    int error;
+    uint64_t pub_ns, worst_ns;
+} latest_t;
+
+static void *latest_producer(void *arg)
+{
+    latest_t *b = arg;
+    for (uint32_t i = 0; i < b->count; i++) {
+        uint64_t t0 = now_ns();
+        fill(b->slot[pedal_latest_back(&b->x)], STATUS_WORDS, i);
+        pedal_latest_publish(&b->x);
+        uint64_t ns = now_ns() - t0;
+        b->pub_ns += ns;
+        if (ns > b->worst_ns) b->worst_ns = ns;
+        sched_yield();
+    }
+    __atomic_store_n(&b->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void *latest_consumer(void *arg)
+{
+    latest_t *b = arg;
+    uint32_t copy[STATUS_WORDS];
+    int64_t last = -1;
+    for (;;) {
+        int done = __atomic_load_n(&b->done, __ATOMIC_ACQUIRE);
+        pedal_latest_take(&b->x);
+        memcpy(copy, b->slot[pedal_latest_front(&b->x)], sizeof(copy));
+        if (torn(copy, STATUS_WORDS) || (int64_t)copy[0] < last) {
+            fprintf(stderr, "took %u after %lld\n", copy[0], (long long)last);
+            b->error = 1;
+            return NULL;
+        }
+        if ((int64_t)copy[0] > last) b->taken++;
+        last = copy[0];
+        if (done) break;
+        sched_yield();
+    }
+    // Everything is published by now: the consumer must end on the last one
+    if (last != (int64_t)b->count - 1) {
+        fprintf(stderr, "ended on %lld, last published %u\n", (long long)last, b->count - 1);
+        b->error = 1;
+    }
+    return NULL;
+}
+
+static int run_latest(uint32_t count)
+{
+    static latest_t b;
+    memset(&b, 0, sizeof(b));
+    pedal_latest_init(&b.x);
+    // Zeroed slots read as record 0, so a take before the first publish is consistent
+    b.count = count;
+    pthread_t p, c;
+    pthread_create(&c, NULL, latest_consumer, &b);
+    pthread_create(&p, NULL, latest_producer, &b);
+    pthread_join(p, NULL);
+    pthread_join(c, NULL);
+    printf("latest:       %8u published  %8u taken  publish avg %.1f ns worst %.1f us\n", count, b.taken,
+           (double)b.pub_ns / count, b.worst_ns / 1e3);
+    return b.error;
+}
+
+static int check_single(void)
+{
+    // Ring bookkeeping without threads: full at len, empty after draining
+    pedal_spsc_t r;
+    pedal_spsc_init(&r, RING_SLOTS);
+    int err = pedal_spsc_front(&r) != -1;
+    for (int i = 0; i < RING_SLOTS; i++) {
+        err |= pedal_spsc_slot(&r) != i;
+        pedal_spsc_push(&r);
+    }
+    err |= pedal_spsc_slot(&r) != -1 || pedal_spsc_front(&r) != 0;
+    pedal_spsc_pop(&r);
+    err |= pedal_spsc_slot(&r) != 0;
+
+    // Nothing new, nothing taken; two publishes, only the second is seen
+    pedal_latest_t x;
+    pedal_latest_init(&x);
+    int front = pedal_latest_front(&x);
+    err |= pedal_latest_take(&x) || pedal_latest_front(&x) != front;
+    int first = pedal_latest_back(&x);
+    pedal_latest_publish(&x);
+    int second = pedal_latest_back(&x);
+    pedal_latest_publish(&x);
+    err |= second == first || !pedal_latest_take(&x) || pedal_latest_front(&x) != second ||
+           pedal_latest_take(&x) || pedal_latest_back(&x) == second;
+    if (err) fprintf(stderr, "ring or exchange bookkeeping wrong\n");
+    return err;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t count = 1000000;
+    if (argc == 3 && !strcmp(argv[1], "-n")) count = strtoul(argv[2], NULL, 10);
+    else if (argc != 1) {
+        fprintf(stderr, "usage: %s [-n records]\n", argv[0]);
+        return 2;
+    }
+    if (!count) count = 1;
+    return check_single() || run_ring(count, 1) || run_ring(count / 16, 0) || run_latest(count);
+}
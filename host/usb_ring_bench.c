@@ -0,0 +1,136 @@
+// USB-MIDI transmit ring under two threads.
+//
+//   usb_ring_bench [-n events]
+//
+// A producer thread encodes CC messages into the ring while a consumer
+// thread drains it in transfer-sized runs, as the TinyUSB side does. Run
+// once with the consumer keeping up and once with it stalling, so the ring
+// overflows. Fails if an event arrives out of order, is duplicated or is
+// lost without being counted as dropped.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bench_util.h"
+#include "pedal_usb_ring.h"
+
+typedef struct {
+    pedal_usb_ring_t ring;
+    uint32_t count;
+    int slow;                            // consumer stalls every transfer
+    volatile int done;
+    uint32_t received;
+    int error;
+} bench_t;
+
+// Event i as a CC message: channel, controller and value carry 18 bits of i
+static pedal_midi_msg_t message(uint32_t i)
+{
+    return (pedal_midi_msg_t){ 3, { 0xB0 | ((i >> 14) & 0xF), i & 0x7F, (i >> 7) & 0x7F } };
+}
+
+static uint32_t decode(const uint8_t *ev)
+{
+    return (uint32_t)(ev[1] & 0xF) << 14 | ev[3] << 7 | ev[2];
+}
+
+static void *producer(void *arg)
+{
+    bench_t *b = arg;
+    for (uint32_t i = 0; i < b->count; i++) {
+        pedal_midi_msg_t m = message(i);
+        // Keeping up: wait for room. Stalling: the real-time side never waits.
+        while (!pedal_usb_ring_push(&b->ring, &m, NULL) && !b->slow) {
+            b->ring.dropped--;           // retried, not lost
+            sched_yield();
+        }
+    }
+    __atomic_store_n(&b->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    bench_t *b = arg;
+    int64_t last = -1;
+    for (;;) {
+        int done = __atomic_load_n(&b->done, __ATOMIC_ACQUIRE);
+        const uint8_t *span;
+        size_t n = pedal_usb_ring_peek(&b->ring, &span, PEDAL_USB_XFER_EVENTS);
+        if (!n) {
+            if (done) break;
+            sched_yield();
+            continue;
+        }
+        // A stalled host takes only part of what is offered
+        size_t took = b->slow ? (n + 1) / 2 : n;
+        for (size_t k = 0; k < took; k++) {
+            const uint8_t *ev = span + k * PEDAL_USB_EVENT_SIZE;
+            int64_t seq = decode(ev);
+            if (ev[0] != 0xB || seq <= last || (!b->slow && seq != last + 1)) {
+                fprintf(stderr, "event %lld after %lld\n", (long long)seq, (long long)last);
+                b->error = 1;
+                return NULL;
+            }
+            last = seq;
+        }
+        b->received += took;
+        pedal_usb_ring_consume(&b->ring, took, n);
+        if (b->slow) {
+            struct timespec ts = { 0, 2000 };
+            nanosleep(&ts, NULL);
+        }
+    }
+    return NULL;
+}
+
+static int run(uint32_t count, int slow)
+{
+    static bench_t b;
+    memset(&b, 0, sizeof(b));
+    b.count = count;
+    b.slow = slow;
+    pthread_t p, c;
+    uint64_t t0 = now_ns();
+    pthread_create(&c, NULL, consumer, &b);
+    pthread_create(&p, NULL, producer, &b);
+    pthread_join(p, NULL);
+    pthread_join(c, NULL);
+    double s = (now_ns() - t0) / 1e9;
+
+    const pedal_usb_ring_t *r = &b.ring;
+    printf("%-9s %8u events  %6.1f Mev/s  %5.2f events/transfer  stalls %u  dropped %u  high water %u\n",
+           slow ? "stalling:" : "keeping:", (unsigned)b.received, b.received / s / 1e6,
+           r->transfers ? (double)r->events / r->transfers : 0.0, (unsigned)r->stalls, (unsigned)r->dropped,
+           (unsigned)r->high_water);
+    if (b.error) return 1;
+    if (b.received + r->dropped != count || r->events != b.received) {
+        fprintf(stderr, "%u received + %u dropped != %u produced\n", (unsigned)b.received, (unsigned)r->dropped,
+                (unsigned)count);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t count = 1000000;
+    if (argc == 3 && !strcmp(argv[1], "-n")) count = strtoul(argv[2], NULL, 10);
+    else if (argc != 1) {
+        fprintf(stderr, "usage: %s [-n events]\n", argv[0]);
+        return 2;
+    }
+    if (count > 1u << 18) count = 1u << 18;     // what the sequence fits in
+
+    pedal_midi_msg_t pc = { 2, { 0xC3, 5 } }, none = { 0 };
+    uint8_t ev[PEDAL_USB_EVENT_SIZE];
+    if (!pedal_usb_event(&pc, ev) || ev[0] != 0xC || ev[1] != 0xC3 || ev[2] != 5 || ev[3] != 0 ||
+        pedal_usb_event(&none, ev)) {
+        fprintf(stderr, "bad USB-MIDI event encoding\n");
+        return 1;
+    }
+    return run(count, 0) || run(count / 8, 1);
+}
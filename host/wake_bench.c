@@ -0,0 +1,166 @@
+// Deep-sleep wake: runtime state sealed into RTC memory and resumed.
+//
+//   wake_bench <settings.json> [-n iters]
+//
+// Seals a config with a toggle left ON, a momentary held down and another
+// bank selected, and resumes it into a fresh engine. Fails if the bank or
+// the toggle are lost, if the held momentary comes back ON, if the next
+// press of the toggle does not turn it off, or if a record with any single
+// byte changed, a different size or no magic is accepted. Reports what a
+// wake costs to get the config live (check + table compile) against a cold
+// boot from the NVS blob (unpack + compile, flash read not included).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bench_util.h"
+#include "pedal_blob.h"
+#include "pedal_logic.h"
+#include "pedal_table.h"
+#include "pedal_wake.h"
+
+static pedal_midi_msg_t s_last;
+static int s_sent;
+
+static void sink(void *ctx, const pedal_midi_msg_t *msg)
+{
+    (void)ctx;
+    s_last = *msg;
+    s_sent++;
+}
+
+static int same_msg(const pedal_midi_msg_t *a, const pedal_midi_msg_t *b)
+{
+    return a->len == b->len && !memcmp(a->data, b->data, a->len);
+}
+
+static int check_resume(const pedal_config_t *cfg)
+{
+    static pedal_table_t tbl;
+    static pedal_wake_t w;
+    pedal_table_compile(&tbl, cfg);
+
+    pedal_logic_t lg;
+    pedal_logic_init(&lg, &tbl, sink, NULL);
+    pedal_logic_edge(&lg, 0, true, 10);             // toggle ON
+    pedal_logic_edge(&lg, 0, false, 20);
+    pedal_logic_edge(&lg, 1, true, 30);             // momentary, still down
+    pedal_logic_set_bank(&lg, 2);
+    if (!(lg.state[0] & 1) || !(lg.state[0] & 2)) {
+        fprintf(stderr, "setup did not turn switches 0 and 1 on\n");
+        return 1;
+    }
+    pedal_wake_seal(&w, cfg, &lg, 1234 << 4);
+    if (pedal_wake_check(&w) != 0) {
+        fprintf(stderr, "sealed state rejected\n");
+        return 1;
+    }
+
+    // What the next boot sees: a new engine on the table compiled from w.cfg
+    static pedal_table_t tbl2;
+    pedal_table_compile(&tbl2, &w.cfg);
+    pedal_logic_t lg2;
+    pedal_logic_init(&lg2, &tbl2, sink, NULL);
+    s_sent = 0;
+    pedal_wake_resume(&w, &lg2);
+    int err = 0;
+    if (lg2.bank != 2 || lg2.state[0] != 1 || w.exp != 1234 << 4 || s_sent) {
+        fprintf(stderr, "resumed bank %u, bank 1 switches %02x, exp %u, %d messages sent\n", lg2.bank, lg2.state[0],
+                w.exp, s_sent);
+        err = 1;
+    }
+    pedal_logic_set_bank(&lg2, 0);
+    pedal_logic_edge(&lg2, 0, true, 10);
+    if (s_sent != 1 || !same_msg(&s_last, &tbl2.sw[0][0].off) || lg2.state[0] & 1) {
+        fprintf(stderr, "first press after the wake did not turn the toggle off\n");
+        err = 1;
+    }
+
+    // Any single changed byte, a foreign layout or a missing magic is a cold boot
+    int accepted = 0;
+    uint8_t *raw = (uint8_t *)&w;
+    for (size_t i = 0; i < sizeof(w); i++) {
+        raw[i] ^= 0x10;
+        accepted += pedal_wake_check(&w) == 0;
+        raw[i] ^= 0x10;
+    }
+    w.size += 4;
+    accepted += pedal_wake_check(&w) == 0;
+    w.size -= 4;
+    w.magic = 0;
+    accepted += pedal_wake_check(&w) == 0;
+    if (accepted) {
+        fprintf(stderr, "%d damaged records accepted\n", accepted);
+        err = 1;
+    }
+    printf("resume:    %zu bytes of RTC memory, bank and toggles kept, %zu corruptions rejected\n", sizeof(w),
+           sizeof(w) + 2);
+    return err;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    int iters = 2000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) iters = atoi(argv[++i]);
+        else path = argv[i];
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s <settings.json> [-n iters]\n", argv[0]);
+        return 2;
+    }
+    if (iters < 1) iters = 1;
+
+    size_t json_len;
+    char *json = read_file(path, &json_len);
+    static pedal_config_t cfg;
+    pedal_config_defaults(&cfg);
+    if (!json || pedal_config_from_json(&cfg, json, json_len) != 0) {
+        fprintf(stderr, "cannot parse settings %s\n", path);
+        return 1;
+    }
+    free(json);
+    // Switch 0 of bank 1 a toggle and switch 1 a momentary, both sending a CC
+    cfg.banks[0].sw[0].flags = PEDAL_SW_TOGGLE;
+    cfg.banks[0].sw[1].flags = 0;
+    for (int s = 0; s < 2; s++) {
+        cfg.banks[0].sw[s].act[PEDAL_TRIG_PRESS] = (pedal_action_t){ PEDAL_TYPE_CC, 0, 80 + s };
+        memset(cfg.banks[0].sw[s].excl, 0, sizeof(cfg.banks[0].sw[s].excl));
+        memset(cfg.banks[0].sw[s].lead, 0, sizeof(cfg.banks[0].sw[s].lead));
+        cfg.banks[0].sw[s].incl = 0;
+    }
+    if (check_resume(&cfg)) return 1;
+
+    // Getting the config live: from RTC memory vs from the NVS blob
+    static pedal_wake_t w;
+    static pedal_table_t tbl;
+    static uint8_t blob[PEDAL_BLOB_SIZE];
+    static pedal_config_t back;
+    pedal_logic_t lg;
+    pedal_logic_init(&lg, &tbl, sink, NULL);
+    pedal_wake_seal(&w, &cfg, &lg, 0);
+    size_t blob_len = pedal_blob_pack(&cfg, blob, sizeof(blob));
+
+    uint64_t t0 = now_ns();
+    int bad = 0;
+    for (int i = 0; i < iters; i++) {
+        bad |= pedal_wake_check(&w);
+        pedal_table_compile(&tbl, &w.cfg);
+    }
+    uint64_t t1 = now_ns();
+    for (int i = 0; i < iters; i++) {
+        pedal_config_defaults(&back);
+        bad |= pedal_blob_unpack(&back, blob, blob_len);
+        pedal_table_compile(&tbl, &back);
+    }
+    uint64_t t2 = now_ns();
+    if (bad) {
+        fprintf(stderr, "restore failed\n");
+        return 1;
+    }
+    printf("restore:   wake %.1f us, cold boot %.1f us (check / unpack + table compile)\n",
+           (t1 - t0) / 1e3 / iters, (t2 - t1) / 1e3 / iters);
+    return 0;
+}
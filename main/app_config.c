@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "pedal_blob.h"
+#include "pedal_commit.h"
+#include "pedal_snap.h"
+#include "app_config.h"
+#include "midi_out.h"
+#include "rt_tasks.h"
+
+static const char *TAG = "app_config";
+
+#define CFG_NVS_NAMESPACE "pedal"
+#define CFG_NVS_KEY       "cfg"
+#define PUBLISH_TRIES     50        // ticks to wait for the spare snapshot
+
+static app_config_snap_t s_snaps[2];
+static pedal_snap_t s_snap = { { &s_snaps[0], &s_snaps[1] }, &s_snaps[0], NULL };
+// Orders publishers and readers on core 0; the scan loop never takes it
+static SemaphoreHandle_t s_publish_lock;
+static int s_bank_req = -1;
+// Boot builds the first config here
+static pedal_config_t s_loaded;
+// Static so neither boot nor /api/save needs a heap allocation for the blob
+static uint8_t s_blob[PEDAL_BLOB_SIZE];
+// Records currently stored as overrides on top of the blob
+static uint64_t s_overrides;
+
+// Edits waiting for the writer task, packed at the time they were made
+static pedal_commit_queue_t s_queue;
+// A mutex, not a spinlock: packing a blob must not mask interrupts
+static SemaphoreHandle_t s_queue_lock;
+static TaskHandle_t s_writer;
+static SemaphoreHandle_t s_written;
+
+static void record_key(int rec, char *key, size_t len)
+{
+    snprintf(key, len, "r%d", rec);
+}
+
+const app_config_snap_t *app_config_acquire(void)
+{
+    return pedal_snap_acquire(&s_snap);
+}
+
+void app_config_release(void)
+{
+    pedal_snap_release(&s_snap);
+}
+
+void app_config_copy(pedal_config_t *out)
+{
+    xSemaphoreTake(s_publish_lock, portMAX_DELAY);
+    *out = ((const app_config_snap_t *)pedal_snap_live(&s_snap))->cfg;
+    xSemaphoreGive(s_publish_lock);
+}
+
+esp_err_t app_config_publish(const pedal_config_t *cfg)
+{
+    xSemaphoreTake(s_publish_lock, portMAX_DELAY);
+    app_config_snap_t *next;
+    // The scan loop holds the spare only if it started an iteration just before the last publish
+    for (int tries = 0; !(next = pedal_snap_spare(&s_snap)); tries++) {
+        if (tries == PUBLISH_TRIES) {
+            xSemaphoreGive(s_publish_lock);
+            ESP_LOGE(TAG, "Scan loop still holds the previous config");
+            return ESP_ERR_TIMEOUT;
+        }
+        vTaskDelay(1);
+    }
+    next->cfg = *cfg;
+    pedal_table_compile(&next->table, &next->cfg);
+    pedal_snap_publish(&s_snap, next);
+    xSemaphoreGive(s_publish_lock);
+    midi_out_exp_budget(cfg->exp_usb_hz, cfg->exp_ble_hz);
+    return ESP_OK;
+}
+
+void app_config_select_bank(uint8_t bank)
+{
+    __atomic_store_n(&s_bank_req, bank, __ATOMIC_RELEASE);
+}
+
+int app_config_bank_request(void)
+{
+    return __atomic_exchange_n(&s_bank_req, -1, __ATOMIC_ACQ_REL);
+}
+
+static void init_locks(void)
+{
+    if (!s_queue_lock) {
+        s_queue_lock = xSemaphoreCreateMutex();
+        s_publish_lock = xSemaphoreCreateMutex();
+        pedal_commit_init(&s_queue);
+    }
+}
+
+esp_err_t app_config_load(void)
+{
+    init_locks();
+    pedal_config_defaults(&s_loaded);
+
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(CFG_NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (err == ESP_OK) {
+        size_t len = sizeof(s_blob);
+        err = nvs_get_blob(nvs, CFG_NVS_KEY, s_blob, &len);
+        nvs_close(nvs);
+        if (err == ESP_OK && pedal_blob_unpack(&s_loaded, s_blob, len) != 0) {
+            ESP_LOGW(TAG, "Stored config failed CRC/version check, using defaults");
+            err = ESP_ERR_INVALID_CRC;
+        }
+    }
+    if (err != ESP_OK) ESP_LOGI(TAG, "No stored config (%s), using defaults", esp_err_to_name(err));
+
+    s_overrides = 0;
+    if (nvs_open(CFG_NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+        uint8_t rec_buf[PEDAL_REC_MAX_SIZE];
+        char key[8];
+        for (int rec = 0; rec < PEDAL_REC_COUNT; rec++) {
+            size_t len = sizeof(rec_buf);
+            record_key(rec, key, sizeof(key));
+            if (nvs_get_blob(nvs, key, rec_buf, &len) != ESP_OK) continue;
+            if (pedal_record_unpack(&s_loaded, rec, rec_buf, len) == 0) s_overrides |= 1ull << rec;
+        }
+        nvs_close(nvs);
+    }
+
+    esp_err_t perr = app_config_publish(&s_loaded);
+    return perr != ESP_OK ? perr : err;
+}
+
+esp_err_t app_config_resume(const pedal_config_t *cfg)
+{
+    init_locks();
+    // Which overrides NVS holds is unknown without reading it: the first
+    // full save erases every record key, missing ones included
+    s_overrides = (1ull << PEDAL_REC_COUNT) - 1;
+    return app_config_publish(cfg);
+}
+
+// Runs only in the writer task; s_overrides is its state from here on
+static esp_err_t write_batch(const pedal_commit_batch_t *b)
+{
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(CFG_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) return err;
+
+    char key[8];
+    if (b->full) {
+        // Overrides go first: a reset in between falls back to the previous
+        // full save instead of stale overrides on top of the new blob.
+        for (int rec = 0; rec < PEDAL_REC_COUNT; rec++) {
+            if (!(s_overrides & (1ull << rec))) continue;
+            record_key(rec, key, sizeof(key));
+            nvs_erase_key(nvs, key);
+        }
+        s_overrides = 0;
+        err = nvs_set_blob(nvs, CFG_NVS_KEY, b->blob, b->blob_len);
+    }
+    for (int rec = 0; rec < PEDAL_REC_COUNT && err == ESP_OK; rec++) {
+        if (!(b->dirty & (1ull << rec))) continue;
+        record_key(rec, key, sizeof(key));
+        err = nvs_set_blob(nvs, key, b->rec[rec], b->rec_len[rec]);
+        if (err == ESP_OK) s_overrides |= 1ull << rec;
+    }
+    if (err == ESP_OK) err = nvs_commit(nvs);
+    nvs_close(nvs);
+    return err;
+}
+
+static uint32_t now_ms(void)
+{
+    return esp_timer_get_time() / 1000;
+}
+
+// Lowest priority above idle: flash writes only happen when nothing else wants the CPU
+static void writer_task(void *arg)
+{
+    static pedal_commit_batch_t batch;
+    for (;;) {
+        xSemaphoreTake(s_queue_lock, portMAX_DELAY);
+        int32_t wait = pedal_commit_due(&s_queue, now_ms());
+        bool take = wait == 0 && pedal_commit_take(&s_queue, &batch);
+        xSemaphoreGive(s_queue_lock);
+
+        if (!take) {
+            ulTaskNotifyTake(pdTRUE, wait < 0 ? portMAX_DELAY : pdMS_TO_TICKS((uint32_t)wait) + 1);
+            continue;
+        }
+        esp_err_t err = write_batch(&batch);
+        if (err != ESP_OK) ESP_LOGE(TAG, "Config commit failed: %s", esp_err_to_name(err));
+
+        xSemaphoreTake(s_queue_lock, portMAX_DELAY);
+        pedal_commit_done(&s_queue, &batch, err == ESP_OK, now_ms());
+        xSemaphoreGive(s_queue_lock);
+        xSemaphoreGive(s_written);
+    }
+}
+
+esp_err_t app_config_writer_start(void)
+{
+    s_written = xSemaphoreCreateBinary();
+    if (!s_written || xTaskCreatePinnedToCore(writer_task, "cfg_writer", 3072, NULL, RT_PRIO_WRITER, &s_writer,
+                                              RT_SYS_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Cannot start config writer");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+static uint32_t queue_commit(bool full, uint64_t dirty)
+{
+    // Packing happens here, in the task that edits the config, from the snapshot it published
+    xSemaphoreTake(s_publish_lock, portMAX_DELAY);
+    const app_config_snap_t *live = pedal_snap_live(&s_snap);
+    xSemaphoreTake(s_queue_lock, portMAX_DELAY);
+    uint32_t gen = pedal_commit_stage(&s_queue, &live->cfg, full, dirty, now_ms());
+    xSemaphoreGive(s_queue_lock);
+    xSemaphoreGive(s_publish_lock);
+    if (s_writer) xTaskNotifyGive(s_writer);
+    return gen;
+}
+
+uint32_t app_config_commit(void)
+{
+    return queue_commit(true, 0);
+}
+
+uint32_t app_config_commit_records(uint64_t dirty)
+{
+    return queue_commit(false, dirty);
+}
+
+uint32_t app_config_saved(void)
+{
+    xSemaphoreTake(s_queue_lock, portMAX_DELAY);
+    uint32_t saved = s_queue.saved;
+    xSemaphoreGive(s_queue_lock);
+    return saved;
+}
+
+esp_err_t app_config_flush(uint32_t timeout_ms)
+{
+    int64_t deadline = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    for (;;) {
+        xSemaphoreTake(s_queue_lock, portMAX_DELAY);
+        bool done = pedal_commit_reached(s_queue.saved, s_queue.gen);
+        // Skip the settle time: whoever flushes is about to reset
+        s_queue.first_ms = now_ms() - PEDAL_COMMIT_MAX_WAIT_MS;
+        xSemaphoreGive(s_queue_lock);
+        if (done) return ESP_OK;
+
+        int64_t left = deadline - esp_timer_get_time();
+        if (left <= 0 || !s_writer) return ESP_ERR_TIMEOUT;
+        xTaskNotifyGive(s_writer);
+        xSemaphoreTake(s_written, pdMS_TO_TICKS(left / 1000) + 1);
+    }
+}
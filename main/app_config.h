@@ -0,0 +1,68 @@
+#ifndef APP_CONFIG_H
+#define APP_CONFIG_H
+
+#include "esp_err.h"
+#include "pedal_config.h"
+#include "pedal_table.h"
+
+/*
+ * The live config is an immutable snapshot: the config and the action
+ * table compiled from it. Changes are compiled into a second snapshot off
+ * to the side and published with one pointer swap (pedal_snap.h), so a
+ * press always sees one consistent bank, and the scan loop never waits on
+ * a handler, a mutex or masked interrupts.
+ */
+typedef struct {
+    pedal_config_t cfg;
+    pedal_table_t table;
+} app_config_snap_t;
+
+/**
+ * Scan loop only: the snapshot to run this iteration from. It stays valid
+ * until app_config_release() at the end of the iteration; the one it
+ * replaced is reused once the loop has moved past it.
+ */
+const app_config_snap_t *app_config_acquire(void);
+void app_config_release(void);
+
+// Copy of the live config, for handlers (never the scan loop).
+void app_config_copy(pedal_config_t *out);
+
+/**
+ * Compiles cfg and makes it live. Publishers take turns; each may wait
+ * out one scan iteration for the spare snapshot. ESP_ERR_TIMEOUT if the
+ * scan loop held it for far longer (nothing changed then).
+ */
+esp_err_t app_config_publish(const pedal_config_t *cfg);
+
+// /api/set_bank: the scan loop switches at its next iteration
+void app_config_select_bank(uint8_t bank);
+// Scan loop: bank asked for since the last call, or -1
+int app_config_bank_request(void);
+
+// NVS -> RAM: the packed blob, then any newer per-record overrides, published
+// as the first snapshot. Falls back to defaults if the blob is missing or corrupt.
+esp_err_t app_config_load(void);
+
+// After a deep-sleep wake: publishes the config kept in RTC memory
+// (boot_stage.h) without touching NVS.
+esp_err_t app_config_resume(const pedal_config_t *cfg);
+
+// Starts the low-priority task that writes queued commits to NVS.
+esp_err_t app_config_writer_start(void);
+
+// Queues the live config -> NVS as one packed blob, which drops all per-record
+// overrides. Returns at once with the commit generation; edits in quick
+// succession are written together once they settle.
+uint32_t app_config_commit(void);
+
+// Same, for the records set in dirty (bits PEDAL_REC_*) only.
+uint32_t app_config_commit_records(uint64_t dirty);
+
+// Every commit up to this generation is on flash.
+uint32_t app_config_saved(void);
+
+// Writes anything still queued now, e.g. before a restart.
+esp_err_t app_config_flush(uint32_t timeout_ms);
+
+#endif
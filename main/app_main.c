@@ -0,0 +1,76 @@
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "nvs_flash.h"
+#include "sdkconfig.h"
+#include "tinyusb.h"
+#include "boot_stage.h"
+#include "config_radio.h"
+#include "rt_tasks.h"
+
+static const char *TAG = "main";
+
+enum { ITF_NUM_MIDI, ITF_NUM_MIDI_STREAMING, ITF_COUNT };
+
+#define EPNUM_MIDI      1
+#define USB_CFG_LEN     (TUD_CONFIG_DESC_LEN + CFG_TUD_MIDI * TUD_MIDI_DESC_LEN)
+#define USB_PRIO        5
+
+// Device descriptor and names from the TinyUSB Kconfig; string 4 names the MIDI port
+static const char *s_usb_str[] = {
+    (const char[]){0x09, 0x04},   // English
+    CONFIG_TINYUSB_DESC_MANUFACTURER_STRING,
+    CONFIG_TINYUSB_DESC_PRODUCT_STRING,
+    CONFIG_TINYUSB_DESC_SERIAL_STRING,
+    "MidiBox MIDI",
+};
+
+static const uint8_t s_usb_cfg[] = {
+    TUD_CONFIG_DESCRIPTOR(1, ITF_COUNT, 0, USB_CFG_LEN, 0, 100),
+    TUD_MIDI_DESCRIPTOR(ITF_NUM_MIDI, 4, EPNUM_MIDI, 0x80 | EPNUM_MIDI, 64),
+};
+
+// Full, or written by a newer IDF: the config falls back to its defaults
+static esp_err_t nvs_init(void)
+{
+    esp_err_t err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_LOGW(TAG, "Erasing NVS: %s", esp_err_to_name(err));
+        err = nvs_flash_erase();
+        if (err == ESP_OK) err = nvs_flash_init();
+    }
+    return err;
+}
+
+static esp_err_t usb_init(void)
+{
+    tinyusb_config_t cfg = TINYUSB_DEFAULT_CONFIG();
+    cfg.task.priority = USB_PRIO;
+    cfg.task.xCoreID = RT_SYS_CORE;
+    cfg.descriptor.string = s_usb_str;
+    cfg.descriptor.string_count = sizeof(s_usb_str) / sizeof(s_usb_str[0]);
+    cfg.descriptor.full_speed_config = s_usb_cfg;
+    return tinyusb_driver_install(&cfg);
+}
+
+/*
+ * Each step only logs when it fails: without USB the pedal still plays
+ * over BLE, and without WiFi it only loses the web UI. boot_stage_run()
+ * gives up on its own when there is no config.
+ */
+void app_main(void)
+{
+    esp_err_t err = nvs_init();
+    if (err != ESP_OK) ESP_LOGE(TAG, "NVS init failed: %s", esp_err_to_name(err));
+
+    err = usb_init();
+    if (err != ESP_OK) ESP_LOGE(TAG, "TinyUSB install failed: %s", esp_err_to_name(err));
+
+    err = esp_netif_init();
+    if (err == ESP_OK) err = esp_event_loop_create_default();
+    if (err == ESP_OK) err = config_radio_init();
+    if (err != ESP_OK) ESP_LOGE(TAG, "WiFi init failed: %s", esp_err_to_name(err));
+
+    err = boot_stage_run();
+    if (err != ESP_OK) ESP_LOGE(TAG, "Boot failed: %s", esp_err_to_name(err));
+}
@@ -0,0 +1,288 @@
+#include <string.h>
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "nvs.h"
+#include "pedal_midi_out.h"
+#include "leds.h"
+#include "midi_out.h"
+#include "ble_midi_priv.h"
+
+static const char *TAG = "ble_midi";
+
+#define ID_NVS_NAMESPACE  "ble"
+#define ID_NVS_KEY        "addr"
+#define LINK_PENDING      8       // packets a congested central may owe
+
+typedef struct {
+    bool used;
+    bool subscribed;
+    bool congested;
+    uint16_t conn_id;
+    uint32_t gen;                 // which connection holds the slot
+    uint8_t addr[6];
+    pedal_ble_link_t info;
+} link_t;
+
+// Written by the BT host task, read by the BLE transmit task (notify) and status task; all on core 0
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static link_t s_links[BLE_MIDI_MAX_LINKS];
+static uint32_t s_gen;
+static bool s_advertised;
+
+// Packets a link slot still owes its central; only the BLE transmit task
+// touches them. A slot taken over by a new connection starts empty.
+typedef struct {
+    uint32_t gen;
+    uint8_t head, count;
+    uint8_t len[LINK_PENDING];
+    uint8_t pkt[LINK_PENDING][MIDI_OUT_BLE_PKT_MAX];
+} pending_t;
+static pending_t s_pending[BLE_MIDI_MAX_LINKS];
+static volatile uint8_t s_owing;            // bit i: s_pending[i] is not empty
+
+/*
+ * midi_out's BLE output: one packed notification, sent to every subscribed
+ * central. A central that is congested, or whose stack refuses it, keeps
+ * the packet behind the ones it already owes, and gets them in order once
+ * it has room (midi_out_ble_retry()), so every central hears the same
+ * stream. Only one that falls LINK_PENDING packets behind loses some.
+ */
+static esp_err_t notify_all(const uint8_t *pkt, size_t len)
+{
+    link_t l[BLE_MIDI_MAX_LINKS];
+    taskENTER_CRITICAL(&s_lock);
+    memcpy(l, s_links, sizeof(l));
+    taskEXIT_CRITICAL(&s_lock);
+
+    int took = 0;
+    uint8_t owing = 0;
+    for (int i = 0; i < BLE_MIDI_MAX_LINKS; i++) {
+        pending_t *q = &s_pending[i];
+        bool on = l[i].used && l[i].subscribed;
+        if (!on || q->gen != l[i].gen) {
+            q->gen = l[i].gen;
+            q->count = 0;
+        }
+        if (!on) continue;
+        while (q->count && !l[i].congested &&
+               ble_midi_stack_notify(l[i].conn_id, q->pkt[q->head], q->len[q->head]) == ESP_OK) {
+            q->head = (q->head + 1) % LINK_PENDING;
+            q->count--;
+        }
+        if (pkt) {
+            if (!q->count && !l[i].congested && ble_midi_stack_notify(l[i].conn_id, pkt, len) == ESP_OK) {
+                took++;
+            } else if (q->count < LINK_PENDING && len <= MIDI_OUT_BLE_PKT_MAX) {
+                int k = (q->head + q->count++) % LINK_PENDING;
+                memcpy(q->pkt[k], pkt, len);
+                q->len[k] = len;
+                took++;
+            } else {
+                taskENTER_CRITICAL(&s_lock);
+                if (s_links[i].gen == l[i].gen) s_links[i].info.dropped++;
+                taskEXIT_CRITICAL(&s_lock);
+            }
+        }
+        if (q->count) owing |= 1u << i;
+    }
+    s_owing = owing;
+    if (!pkt) return owing ? ESP_ERR_NOT_FINISHED : ESP_OK;
+    return took ? ESP_OK : ESP_FAIL;
+}
+
+/*
+ * One encode serves every central, so packets are sized for the smallest
+ * MTU and paced by the shortest interval. A slower link then sees more
+ * than one notification per connection event, which its controller
+ * queues; what it cannot take waits in its pending packets (notify_all).
+ */
+static void update_output(void)
+{
+    uint16_t mtu = UINT16_MAX;
+    uint32_t interval_us = UINT32_MAX;
+    taskENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < BLE_MIDI_MAX_LINKS; i++) {
+        const link_t *l = &s_links[i];
+        if (!l->used || !l->subscribed) continue;
+        if (l->info.mtu < mtu) mtu = l->info.mtu;
+        if (l->info.interval_us < interval_us) interval_us = l->info.interval_us;
+    }
+    for (int i = 0; i < BLE_MIDI_MAX_LINKS; i++) {
+        pedal_ble_link_t *info = &s_links[i].info;
+        uint32_t pace = interval_us != UINT32_MAX ? interval_us : info->interval_us;
+        info->worst_us = pace + info->interval_us * (info->latency + 1u);
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    if (mtu == UINT16_MAX) midi_out_ble_link(NULL, PEDAL_BLE_MTU_DEFAULT, 0);
+    else midi_out_ble_link(notify_all, mtu, interval_us);
+}
+
+// Callers hold s_lock
+static link_t *find(uint16_t conn_id)
+{
+    for (int i = 0; i < BLE_MIDI_MAX_LINKS; i++) {
+        if (s_links[i].used && s_links[i].conn_id == conn_id) return &s_links[i];
+    }
+    return NULL;
+}
+
+bool ble_midi_link_open(uint16_t conn_id, const uint8_t addr[6], uint32_t interval_us, uint16_t latency)
+{
+    link_t *l = NULL;
+    taskENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < BLE_MIDI_MAX_LINKS && !l; i++) {
+        if (!s_links[i].used) l = &s_links[i];
+    }
+    if (l) {
+        memset(l, 0, sizeof(*l));       // padding too: the status stream memcmp()s info
+        l->used = true;
+        l->gen = ++s_gen;
+        l->conn_id = conn_id;
+        memcpy(l->addr, addr, sizeof(l->addr));
+        l->info.interval_us = interval_us;
+        l->info.latency = latency;
+        l->info.mtu = PEDAL_BLE_MTU_DEFAULT;
+        l->info.phy = 1;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    if (!l) {
+        ESP_LOGW(TAG, "No free link slot for conn %u", conn_id);
+        return false;
+    }
+    ESP_LOGI(TAG, "Central connected (conn %u, %lu us interval)", conn_id, (unsigned long)interval_us);
+    update_output();
+    return true;
+}
+
+void ble_midi_link_close(uint16_t conn_id)
+{
+    taskENTER_CRITICAL(&s_lock);
+    link_t *l = find(conn_id);
+    if (l) l->used = false;
+    taskEXIT_CRITICAL(&s_lock);
+    ESP_LOGI(TAG, "Central disconnected (conn %u)", conn_id);
+    update_output();
+}
+
+int ble_midi_link_conn(const uint8_t addr[6])
+{
+    int conn = -1;
+    taskENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < BLE_MIDI_MAX_LINKS; i++) {
+        if (s_links[i].used && !memcmp(s_links[i].addr, addr, sizeof(s_links[i].addr))) conn = s_links[i].conn_id;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return conn;
+}
+
+void ble_midi_link_params(uint16_t conn_id, uint32_t interval_us, uint16_t latency)
+{
+    taskENTER_CRITICAL(&s_lock);
+    link_t *l = find(conn_id);
+    if (l) {
+        l->info.interval_us = interval_us;
+        l->info.latency = latency;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    ESP_LOGI(TAG, "Conn %u: interval %lu us, latency %u", conn_id, (unsigned long)interval_us, latency);
+    update_output();
+}
+
+void ble_midi_link_mtu(uint16_t conn_id, uint16_t mtu)
+{
+    taskENTER_CRITICAL(&s_lock);
+    link_t *l = find(conn_id);
+    if (l) l->info.mtu = mtu;
+    taskEXIT_CRITICAL(&s_lock);
+    update_output();
+}
+
+void ble_midi_link_phy(uint16_t conn_id, uint8_t phy)
+{
+    taskENTER_CRITICAL(&s_lock);
+    link_t *l = find(conn_id);
+    if (l) l->info.phy = phy;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+void ble_midi_link_subscribe(uint16_t conn_id, bool on)
+{
+    taskENTER_CRITICAL(&s_lock);
+    link_t *l = find(conn_id);
+    if (l) l->subscribed = on;
+    taskEXIT_CRITICAL(&s_lock);
+    update_output();
+}
+
+void ble_midi_link_congest(uint16_t conn_id, bool congested)
+{
+    bool owes = false;
+    taskENTER_CRITICAL(&s_lock);
+    link_t *l = find(conn_id);
+    if (l) {
+        l->congested = congested;
+        owes = s_owing & (1u << (l - s_links));
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    if (!congested && owes) midi_out_ble_retry();
+}
+
+int ble_midi_free_links(void)
+{
+    int n = 0;
+    taskENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < BLE_MIDI_MAX_LINKS; i++) n += !s_links[i].used;
+    taskEXIT_CRITICAL(&s_lock);
+    return n;
+}
+
+int ble_midi_links(pedal_ble_link_t *out, int max)
+{
+    int n = 0;
+    taskENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < BLE_MIDI_MAX_LINKS && n < max; i++) {
+        if (s_links[i].used) out[n++] = s_links[i].info;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return n;
+}
+
+bool ble_midi_identity(bool regenerate, uint8_t addr[6])
+{
+    nvs_handle_t nvs;
+    if (!regenerate) {
+        size_t len = 6;
+        bool have = false;
+        if (nvs_open(ID_NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+            have = nvs_get_blob(nvs, ID_NVS_KEY, addr, &len) == ESP_OK && len == 6;
+            nvs_close(nvs);
+        }
+        return have;
+    }
+
+    esp_fill_random(addr, 6);
+    addr[0] |= 0xC0;                 // two top bits set: random static
+    if (nvs_open(ID_NVS_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK) {
+        if (nvs_set_blob(nvs, ID_NVS_KEY, addr, 6) == ESP_OK) nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+    ESP_LOGI(TAG, "New BLE identity %02x:%02x:%02x:%02x:%02x:%02x", addr[0], addr[1], addr[2], addr[3], addr[4],
+             addr[5]);
+    leds_identity();
+    return true;
+}
+
+void ble_midi_advertising(void)
+{
+    if (s_advertised) return;
+    s_advertised = true;
+    // Parsed by pytest_ble_midi.py to compare the Bluedroid and NimBLE builds
+    ESP_LOGI(TAG, "Advertising %lu ms after boot, free heap %lu, min %lu",
+             (unsigned long)(esp_timer_get_time() / 1000), (unsigned long)esp_get_free_heap_size(),
+             (unsigned long)esp_get_minimum_free_heap_size());
+}
@@ -0,0 +1,22 @@
+#ifndef BLE_MIDI_H
+#define BLE_MIDI_H
+
+#include <stdbool.h>
+#include "esp_err.h"
+#include "pedal_status.h"
+
+// Centrals served at once (e.g. iPad + laptop); one ACL link stays spare
+#define BLE_MIDI_MAX_LINKS  PEDAL_STATUS_BLE_LINKS
+
+/**
+ * BLE-MIDI peripheral: GATT server, advertising, bonding and connection
+ * management. Every central that subscribes gets the same packets from
+ * midi_out's single encode. new_identity (Switch 5 + 8 held at boot)
+ * replaces the stored random address and forgets all bonds.
+ */
+esp_err_t ble_midi_start(bool new_identity);
+
+// Live parameters of the connected centrals; returns how many were written.
+int ble_midi_links(pedal_ble_link_t *out, int max);
+
+#endif
@@ -0,0 +1,215 @@
+#include <string.h>
+#include "esp_bt.h"
+#include "esp_bt_main.h"
+#include "esp_gap_ble_api.h"
+#include "esp_gatt_common_api.h"
+#include "esp_gatts_api.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include "ble_midi_priv.h"
+
+static const char *TAG = "ble_midi";
+
+enum { IDX_SVC, IDX_CHAR, IDX_VAL, IDX_CCCD, IDX_NB };
+
+static const uint8_t s_svc_uuid[16] = { BLE_MIDI_SVC_UUID128 };
+static const uint8_t s_chr_uuid[16] = { BLE_MIDI_CHR_UUID128 };
+static const uint16_t s_pri_uuid = ESP_GATT_UUID_PRI_SERVICE;
+static const uint16_t s_decl_uuid = ESP_GATT_UUID_CHAR_DECLARE;
+static const uint16_t s_cccd_uuid = ESP_GATT_UUID_CHAR_CLIENT_CONFIG;
+static const uint8_t s_chr_prop = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE_NR |
+                                  ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+static uint8_t s_chr_val[1];
+static uint8_t s_cccd_val[2];
+
+static const esp_gatts_attr_db_t s_db[IDX_NB] = {
+    [IDX_SVC] = { { ESP_GATT_AUTO_RSP }, { ESP_UUID_LEN_16, (uint8_t *)&s_pri_uuid, ESP_GATT_PERM_READ,
+                                           sizeof(s_svc_uuid), sizeof(s_svc_uuid), (uint8_t *)s_svc_uuid } },
+    [IDX_CHAR] = { { ESP_GATT_AUTO_RSP }, { ESP_UUID_LEN_16, (uint8_t *)&s_decl_uuid, ESP_GATT_PERM_READ,
+                                            1, 1, (uint8_t *)&s_chr_prop } },
+    // Reads return an empty value, as the BLE-MIDI spec asks
+    [IDX_VAL] = { { ESP_GATT_AUTO_RSP }, { ESP_UUID_LEN_128, (uint8_t *)s_chr_uuid,
+                                           ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE, sizeof(s_chr_val), 0,
+                                           s_chr_val } },
+    // Shared by all centrals; each one's subscription is tracked by ble_midi.c
+    [IDX_CCCD] = { { ESP_GATT_AUTO_RSP }, { ESP_UUID_LEN_16, (uint8_t *)&s_cccd_uuid,
+                                            ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE, sizeof(s_cccd_val),
+                                            sizeof(s_cccd_val), s_cccd_val } },
+};
+
+// Flags, complete list of 128-bit service UUIDs; the name goes in the scan response
+static uint8_t s_adv_data[3 + 2 + 16] = { 0x02, 0x01, 0x06, 0x11, 0x07, BLE_MIDI_SVC_UUID128 };
+static uint8_t s_rsp_data[2 + sizeof(BLE_MIDI_DEVICE_NAME) - 1] = { sizeof(BLE_MIDI_DEVICE_NAME), 0x09 };
+
+static esp_ble_adv_params_t s_adv = {
+    .adv_int_min = BLE_MIDI_ADV_INT_MIN,
+    .adv_int_max = BLE_MIDI_ADV_INT_MAX,
+    .adv_type = ADV_TYPE_IND,
+    .own_addr_type = BLE_ADDR_TYPE_PUBLIC,
+    .channel_map = ADV_CHNL_ALL,
+    .adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,
+};
+
+static esp_gatt_if_t s_gatts_if = ESP_GATT_IF_NONE;
+static uint16_t s_handles[IDX_NB];
+static bool s_advertising;
+static uint8_t s_adv_pending;            // raw adv / scan response data not yet set
+
+esp_err_t ble_midi_stack_notify(uint16_t conn_id, const uint8_t *pkt, size_t len)
+{
+    return esp_ble_gatts_send_indicate(s_gatts_if, conn_id, s_handles[IDX_VAL], len, (uint8_t *)pkt, false);
+}
+
+static void advertise(void)
+{
+    if (!s_advertising && !s_adv_pending && ble_midi_free_links()) esp_ble_gap_start_advertising(&s_adv);
+}
+
+// Asks for the fastest link the central will give us
+static void tune_link(esp_bd_addr_t bda)
+{
+    esp_ble_conn_update_params_t p = {
+        .min_int = BLE_MIDI_CONN_INT_MIN,
+        .max_int = BLE_MIDI_CONN_INT_MAX,
+        .latency = 0,
+        .timeout = BLE_MIDI_CONN_TIMEOUT,
+    };
+    memcpy(p.bda, bda, sizeof(p.bda));
+    esp_ble_gap_update_conn_params(&p);
+    esp_ble_gap_set_pkt_data_len(bda, BLE_MIDI_LL_DATA_LEN);
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+    esp_ble_gap_set_preferred_phy(bda, 0, ESP_BLE_GAP_PHY_2M_PREF_MASK, ESP_BLE_GAP_PHY_2M_PREF_MASK,
+                                  ESP_BLE_GAP_PHY_OPTIONS_NO_PREF);
+#endif
+}
+
+static void gatts_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *p)
+{
+    switch (event) {
+    case ESP_GATTS_REG_EVT:
+        s_gatts_if = gatts_if;
+        esp_ble_gap_set_device_name(BLE_MIDI_DEVICE_NAME);
+        s_adv_pending = 3;
+        esp_ble_gap_config_adv_data_raw(s_adv_data, sizeof(s_adv_data));
+        esp_ble_gap_config_scan_rsp_data_raw(s_rsp_data, sizeof(s_rsp_data));
+        esp_ble_gatts_create_attr_tab(s_db, gatts_if, IDX_NB, 0);
+        break;
+    case ESP_GATTS_CREAT_ATTR_TAB_EVT:
+        if (p->add_attr_tab.status != ESP_GATT_OK || p->add_attr_tab.num_handle != IDX_NB) {
+            ESP_LOGE(TAG, "Attribute table failed (0x%x)", p->add_attr_tab.status);
+            break;
+        }
+        memcpy(s_handles, p->add_attr_tab.handles, sizeof(s_handles));
+        esp_ble_gatts_start_service(s_handles[IDX_SVC]);
+        break;
+    case ESP_GATTS_CONNECT_EVT:
+        s_advertising = false;          // the controller stops advertising on a connection
+        if (ble_midi_link_open(p->connect.conn_id, p->connect.remote_bda, p->connect.conn_params.interval * 1250u,
+                               p->connect.conn_params.latency))
+            tune_link(p->connect.remote_bda);
+        advertise();                    // room for another central
+        break;
+    case ESP_GATTS_DISCONNECT_EVT:
+        ble_midi_link_close(p->disconnect.conn_id);
+        advertise();
+        break;
+    case ESP_GATTS_WRITE_EVT:
+        // MIDI written by the central is ignored
+        if (p->write.handle == s_handles[IDX_CCCD] && p->write.len == 2)
+            ble_midi_link_subscribe(p->write.conn_id, p->write.value[0] & 0x01);
+        break;
+    case ESP_GATTS_MTU_EVT:
+        ble_midi_link_mtu(p->mtu.conn_id, p->mtu.mtu);
+        break;
+    case ESP_GATTS_CONGEST_EVT:
+        ble_midi_link_congest(p->congest.conn_id, p->congest.congested);
+        break;
+    default:
+        break;
+    }
+}
+
+static void gap_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *p)
+{
+    int conn;
+    switch (event) {
+    case ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT:
+        s_adv_pending &= ~1;
+        advertise();
+        break;
+    case ESP_GAP_BLE_SCAN_RSP_DATA_RAW_SET_COMPLETE_EVT:
+        s_adv_pending &= ~2;
+        advertise();
+        break;
+    case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
+        s_advertising = p->adv_start_cmpl.status == ESP_BT_STATUS_SUCCESS;
+        if (s_advertising) ble_midi_advertising();
+        else ESP_LOGE(TAG, "Advertising failed (0x%x)", p->adv_start_cmpl.status);
+        break;
+    case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
+        conn = ble_midi_link_conn(p->update_conn_params.bda);
+        if (conn >= 0)
+            ble_midi_link_params(conn, p->update_conn_params.conn_int * 1250u, p->update_conn_params.latency);
+        break;
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+    case ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT:
+        conn = ble_midi_link_conn(p->phy_update.bda);
+        if (conn >= 0 && p->phy_update.status == ESP_BT_STATUS_SUCCESS) ble_midi_link_phy(conn, p->phy_update.tx_phy);
+        break;
+#endif
+    case ESP_GAP_BLE_SEC_REQ_EVT:
+        esp_ble_gap_security_rsp(p->ble_security.ble_req.bd_addr, true);
+        break;
+    case ESP_GAP_BLE_AUTH_CMPL_EVT:
+        if (!p->ble_security.auth_cmpl.success)
+            ESP_LOGW(TAG, "Pairing failed (0x%x)", p->ble_security.auth_cmpl.fail_reason);
+        break;
+    default:
+        break;
+    }
+}
+
+static void forget_bonds(void)
+{
+    int n = esp_ble_get_bond_device_num();
+    if (n <= 0) return;
+    esp_ble_bond_dev_t list[CONFIG_BT_SMP_MAX_BONDS];
+    if (n > CONFIG_BT_SMP_MAX_BONDS) n = CONFIG_BT_SMP_MAX_BONDS;
+    if (esp_ble_get_bond_device_list(&n, list) != ESP_OK) return;
+    for (int i = 0; i < n; i++) esp_ble_remove_bond_device(list[i].bd_addr);
+}
+
+esp_err_t ble_midi_start(bool new_identity)
+{
+    memcpy(s_rsp_data + 2, BLE_MIDI_DEVICE_NAME, sizeof(BLE_MIDI_DEVICE_NAME) - 1);
+
+    esp_bt_controller_config_t bt_cfg = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
+    esp_err_t err = esp_bt_controller_init(&bt_cfg);
+    if (err == ESP_OK) err = esp_bt_controller_enable(ESP_BT_MODE_BLE);
+    if (err == ESP_OK) err = esp_bluedroid_init();
+    if (err == ESP_OK) err = esp_bluedroid_enable();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Bluetooth init failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    esp_ble_auth_req_t auth = ESP_LE_AUTH_BOND;
+    esp_ble_io_cap_t iocap = ESP_IO_CAP_NONE;
+    uint8_t key_size = 16;
+    uint8_t keys = ESP_BLE_ENC_KEY_MASK | ESP_BLE_ID_KEY_MASK;
+    esp_ble_gap_set_security_param(ESP_BLE_SM_AUTHEN_REQ_MODE, &auth, sizeof(auth));
+    esp_ble_gap_set_security_param(ESP_BLE_SM_IOCAP_MODE, &iocap, sizeof(iocap));
+    esp_ble_gap_set_security_param(ESP_BLE_SM_MAX_KEY_SIZE, &key_size, sizeof(key_size));
+    esp_ble_gap_set_security_param(ESP_BLE_SM_SET_INIT_KEY, &keys, sizeof(keys));
+    esp_ble_gap_set_security_param(ESP_BLE_SM_SET_RSP_KEY, &keys, sizeof(keys));
+
+    esp_bd_addr_t addr;
+    if (new_identity) forget_bonds();
+    if (ble_midi_identity(new_identity, addr) && esp_ble_gap_set_rand_addr(addr) == ESP_OK)
+        s_adv.own_addr_type = BLE_ADDR_TYPE_RANDOM;
+
+    esp_ble_gatt_set_local_mtu(BLE_MIDI_LOCAL_MTU);
+    esp_ble_gap_register_callback(gap_handler);
+    esp_ble_gatts_register_callback(gatts_handler);
+    return esp_ble_gatts_app_register(0);
+}
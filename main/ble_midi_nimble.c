@@ -0,0 +1,208 @@
+#include <string.h>
+#include "esp_log.h"
+#include "host/ble_hs.h"
+#include "host/util/util.h"
+#include "nimble/nimble_port.h"
+#include "nimble/nimble_port_freertos.h"
+#include "services/gap/ble_svc_gap.h"
+#include "services/gatt/ble_svc_gatt.h"
+#include "sdkconfig.h"
+#include "ble_midi_priv.h"
+
+static const char *TAG = "ble_midi";
+
+void ble_store_config_init(void);
+
+static const ble_uuid128_t s_svc_uuid = BLE_UUID128_INIT(BLE_MIDI_SVC_UUID128);
+static const ble_uuid128_t s_chr_uuid = BLE_UUID128_INIT(BLE_MIDI_CHR_UUID128);
+static uint16_t s_val_handle;
+static uint8_t s_own_addr_type = BLE_OWN_ADDR_PUBLIC;
+static bool s_new_identity;
+
+// Reads return an empty value, as the BLE-MIDI spec asks; MIDI written by the central is ignored
+static int chr_access(uint16_t conn_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    return 0;
+}
+
+static const struct ble_gatt_chr_def s_chrs[] = {
+    {
+        .uuid = &s_chr_uuid.u,
+        .access_cb = chr_access,
+        .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE_NO_RSP | BLE_GATT_CHR_F_NOTIFY,
+        .val_handle = &s_val_handle,
+    },
+    { 0 },
+};
+
+static const struct ble_gatt_svc_def s_svcs[] = {
+    { .type = BLE_GATT_SVC_TYPE_PRIMARY, .uuid = &s_svc_uuid.u, .characteristics = s_chrs },
+    { 0 },
+};
+
+esp_err_t ble_midi_stack_notify(uint16_t conn_id, const uint8_t *pkt, size_t len)
+{
+    struct os_mbuf *om = ble_hs_mbuf_from_flat(pkt, len);
+    if (!om) return ESP_ERR_NO_MEM;
+    // Consumes om either way; ENOMEM here is NimBLE's equivalent of a congested
+    // link, and the packet waits for the next BLE_GAP_EVENT_NOTIFY_TX
+    return ble_gatts_notify_custom(conn_id, s_val_handle, om) ? ESP_FAIL : ESP_OK;
+}
+
+static int gap_event(struct ble_gap_event *event, void *arg);
+
+static void advertise(void)
+{
+    if (ble_gap_adv_active() || !ble_midi_free_links()) return;
+
+    // Flags and the service UUID; the name goes in the scan response
+    struct ble_hs_adv_fields fields = {
+        .flags = BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP,
+        .uuids128 = &s_svc_uuid,
+        .num_uuids128 = 1,
+        .uuids128_is_complete = 1,
+    };
+    struct ble_hs_adv_fields rsp = {
+        .name = (const uint8_t *)BLE_MIDI_DEVICE_NAME,
+        .name_len = sizeof(BLE_MIDI_DEVICE_NAME) - 1,
+        .name_is_complete = 1,
+    };
+    struct ble_gap_adv_params params = {
+        .conn_mode = BLE_GAP_CONN_MODE_UND,
+        .disc_mode = BLE_GAP_DISC_MODE_GEN,
+        .itvl_min = BLE_MIDI_ADV_INT_MIN,
+        .itvl_max = BLE_MIDI_ADV_INT_MAX,
+    };
+    int rc = ble_gap_adv_set_fields(&fields);
+    if (!rc) rc = ble_gap_adv_rsp_set_fields(&rsp);
+    if (!rc) rc = ble_gap_adv_start(s_own_addr_type, NULL, BLE_HS_FOREVER, &params, gap_event, NULL);
+    if (rc) ESP_LOGE(TAG, "Advertising failed (%d)", rc);
+    else ble_midi_advertising();
+}
+
+// Asks for the fastest link the central will give us
+static void tune_link(uint16_t conn)
+{
+    struct ble_gap_upd_params p = {
+        .itvl_min = BLE_MIDI_CONN_INT_MIN,
+        .itvl_max = BLE_MIDI_CONN_INT_MAX,
+        .latency = 0,
+        .supervision_timeout = BLE_MIDI_CONN_TIMEOUT,
+    };
+    ble_gap_update_params(conn, &p);
+    ble_gap_set_data_len(conn, BLE_MIDI_LL_DATA_LEN, BLE_MIDI_LL_DATA_TIME);
+#if CONFIG_BT_NIMBLE_50_FEATURE_SUPPORT
+    ble_gap_set_prefered_le_phy(conn, BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_CODED_ANY);
+#endif
+}
+
+static int gap_event(struct ble_gap_event *event, void *arg)
+{
+    struct ble_gap_conn_desc desc;
+    switch (event->type) {
+    case BLE_GAP_EVENT_CONNECT:
+        if (event->connect.status == 0 && ble_gap_conn_find(event->connect.conn_handle, &desc) == 0 &&
+            ble_midi_link_open(event->connect.conn_handle, desc.peer_id_addr.val, desc.conn_itvl * 1250u,
+                               desc.conn_latency))
+            tune_link(event->connect.conn_handle);
+        advertise();                    // failed, or room for another central
+        break;
+    case BLE_GAP_EVENT_DISCONNECT:
+        ble_midi_link_close(event->disconnect.conn.conn_handle);
+        advertise();
+        break;
+    case BLE_GAP_EVENT_CONN_UPDATE:
+        if (ble_gap_conn_find(event->conn_update.conn_handle, &desc) == 0)
+            ble_midi_link_params(event->conn_update.conn_handle, desc.conn_itvl * 1250u, desc.conn_latency);
+        break;
+#if CONFIG_BT_NIMBLE_50_FEATURE_SUPPORT
+    case BLE_GAP_EVENT_PHY_UPDATE_COMPLETE:
+        if (event->phy_updated.status == 0) ble_midi_link_phy(event->phy_updated.conn_handle, event->phy_updated.tx_phy);
+        break;
+#endif
+    case BLE_GAP_EVENT_MTU:
+        ble_midi_link_mtu(event->mtu.conn_handle, event->mtu.value);
+        break;
+    case BLE_GAP_EVENT_NOTIFY_TX:
+        // One went out, so there is room again for what the link still owes
+        if (!event->notify_tx.indication) ble_midi_link_congest(event->notify_tx.conn_handle, false);
+        break;
+    case BLE_GAP_EVENT_SUBSCRIBE:
+        if (event->subscribe.attr_handle == s_val_handle)
+            ble_midi_link_subscribe(event->subscribe.conn_handle, event->subscribe.cur_notify);
+        break;
+    case BLE_GAP_EVENT_ADV_COMPLETE:
+        advertise();
+        break;
+    case BLE_GAP_EVENT_REPEAT_PAIRING:
+        // The central lost its keys: drop ours and pair again, as Bluedroid does
+        if (ble_gap_conn_find(event->repeat_pairing.conn_handle, &desc) == 0)
+            ble_store_util_delete_peer(&desc.peer_id_addr);
+        return BLE_GAP_REPEAT_PAIRING_RETRY;
+    case BLE_GAP_EVENT_ENC_CHANGE:
+        if (event->enc_change.status) ESP_LOGW(TAG, "Pairing failed (%d)", event->enc_change.status);
+        break;
+    default:
+        break;
+    }
+    return 0;
+}
+
+static void on_sync(void)
+{
+    uint8_t addr[6], le[6];
+    if (s_new_identity) ble_store_clear();
+    if (ble_midi_identity(s_new_identity, addr)) {
+        // Stored most significant byte first, as Bluedroid takes it; NimBLE
+        // wants it little-endian, with the static type bits in le[5]
+        for (int i = 0; i < 6; i++) le[i] = addr[5 - i];
+        if (ble_hs_id_set_rnd(le) == 0) s_own_addr_type = BLE_OWN_ADDR_RANDOM;
+        else ESP_LOGE(TAG, "Random static address refused, using the public one");
+    }
+    if (s_own_addr_type != BLE_OWN_ADDR_RANDOM) ble_hs_util_ensure_addr(0);
+    advertise();
+}
+
+static void on_reset(int reason)
+{
+    ESP_LOGW(TAG, "Host reset (%d)", reason);
+}
+
+static void host_task(void *arg)
+{
+    nimble_port_run();
+    nimble_port_freertos_deinit();
+}
+
+esp_err_t ble_midi_start(bool new_identity)
+{
+    s_new_identity = new_identity;
+    esp_err_t err = nimble_port_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Bluetooth init failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    ble_hs_cfg.sync_cb = on_sync;
+    ble_hs_cfg.reset_cb = on_reset;
+    ble_hs_cfg.store_status_cb = ble_store_util_status_rr;
+    ble_hs_cfg.sm_io_cap = BLE_SM_IO_CAP_NO_IO;
+    ble_hs_cfg.sm_bonding = 1;
+    ble_hs_cfg.sm_our_key_dist = BLE_SM_PAIR_KEY_DIST_ENC | BLE_SM_PAIR_KEY_DIST_ID;
+    ble_hs_cfg.sm_their_key_dist = BLE_SM_PAIR_KEY_DIST_ENC | BLE_SM_PAIR_KEY_DIST_ID;
+
+    ble_svc_gap_init();
+    ble_svc_gatt_init();
+    int rc = ble_gatts_count_cfg(s_svcs);
+    if (!rc) rc = ble_gatts_add_svcs(s_svcs);
+    if (rc) {
+        ESP_LOGE(TAG, "GATT service registration failed (%d)", rc);
+        return ESP_FAIL;
+    }
+    ble_svc_gap_device_name_set(BLE_MIDI_DEVICE_NAME);
+    ble_att_set_preferred_mtu(BLE_MIDI_LOCAL_MTU);
+    ble_store_config_init();        // bonds in NVS (CONFIG_BT_NIMBLE_NVS_PERSIST)
+
+    nimble_port_freertos_init(host_task);
+    return ESP_OK;
+}
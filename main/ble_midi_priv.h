@@ -0,0 +1,62 @@
+#ifndef BLE_MIDI_PRIV_H
+#define BLE_MIDI_PRIV_H
+
+/*
+ * Shared between ble_midi.c (link table, fan-out, identity) and the host
+ * stack glue, ble_midi_bluedroid.c or ble_midi_nimble.c. Exactly one of
+ * the two is built, picked by the Bluetooth host selected in sdkconfig.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "ble_midi.h"
+
+#define BLE_MIDI_DEVICE_NAME    "MidiBox"
+#define BLE_MIDI_LOCAL_MTU      247     // fills one 251-byte LL packet with data length extension
+#define BLE_MIDI_LL_DATA_LEN    251
+#define BLE_MIDI_LL_DATA_TIME   2120    // us to send BLE_MIDI_LL_DATA_LEN on the 1M PHY
+// Connection interval in 1.25 ms units: ask for 7.5 ms, accept up to 15 ms
+#define BLE_MIDI_CONN_INT_MIN   6
+#define BLE_MIDI_CONN_INT_MAX   12
+#define BLE_MIDI_CONN_TIMEOUT   400     // 10 ms units
+#define BLE_MIDI_ADV_INT_MIN    0x20    // 20 ms, so hosts find the pedal quickly after a wake
+#define BLE_MIDI_ADV_INT_MAX    0x30
+
+// BLE-MIDI service 03B80E5A-EDE8-4B33-A751-6CE34EC4C700 and its I/O
+// characteristic 7772E5DB-3868-4112-A1A9-F2669D106BF3, both little endian
+#define BLE_MIDI_SVC_UUID128 \
+    0x00, 0xC7, 0xC4, 0x4E, 0xE3, 0x6C, 0x51, 0xA7, 0x33, 0x4B, 0xE8, 0xED, 0x5A, 0x0E, 0xB8, 0x03
+#define BLE_MIDI_CHR_UUID128 \
+    0xF3, 0x6B, 0x10, 0x9D, 0x66, 0xF2, 0xA9, 0xA1, 0x12, 0x41, 0x68, 0x38, 0xDB, 0xE5, 0x72, 0x77
+
+// Link table, called from the stack's host task. Every change but
+// congestion re-links midi_out with the new MTU and pacing. A link that
+// leaves congestion (Bluedroid), or had a notification go out (NimBLE),
+// gets the packets it missed meanwhile.
+bool ble_midi_link_open(uint16_t conn_id, const uint8_t addr[6], uint32_t interval_us, uint16_t latency);
+void ble_midi_link_close(uint16_t conn_id);
+int ble_midi_link_conn(const uint8_t addr[6]);     // conn_id, or -1 when not connected
+void ble_midi_link_params(uint16_t conn_id, uint32_t interval_us, uint16_t latency);
+void ble_midi_link_mtu(uint16_t conn_id, uint16_t mtu);
+void ble_midi_link_phy(uint16_t conn_id, uint8_t phy);
+void ble_midi_link_subscribe(uint16_t conn_id, bool on);
+void ble_midi_link_congest(uint16_t conn_id, bool congested);
+int ble_midi_free_links(void);
+
+/**
+ * Random static address to advertise with: the one in NVS, or a new one
+ * when regenerate is set. False while the pedal still uses its public
+ * address (nothing was ever regenerated). addr[0] is the most significant
+ * byte, as Bluedroid takes it, so the same NVS record serves both hosts.
+ */
+bool ble_midi_identity(bool regenerate, uint8_t addr[6]);
+
+// Stack glue reports the first successful advertising start (boot metrics).
+void ble_midi_advertising(void);
+
+// Implemented by the stack glue: one notification of the MIDI I/O characteristic.
+esp_err_t ble_midi_stack_notify(uint16_t conn_id, const uint8_t *pkt, size_t len);
+
+#endif
@@ -0,0 +1,166 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include "app_config.h"
+#include "ble_midi.h"
+#include "boot_stage.h"
+#include "config_radio.h"
+#include "exp_input.h"
+#include "leds.h"
+#include "matrix_scan.h"
+#include "midi_out.h"
+#include "pedal_rt.h"
+#include "power.h"
+#include "preset_store.h"
+#include "rt_tasks.h"
+
+static const char *TAG = "boot";
+
+#define BOOT_DEFER_MAX    4
+#define BOOT_BUDGET_US    (CONFIG_PEDAL_WAKE_BUDGET_MS * 1000u)
+#define BOOT_NEW_IDENTITY ((1u << 4) | (1u << 7))   // Switch 5 + 8
+
+static const char *const s_stage_names[BOOT_STAGES] = {
+    [BOOT_RESTORE] = "restore",   [BOOT_SCAN] = "scan", [BOOT_USB] = "usb",     [BOOT_FIRST_MIDI] = "first_midi",
+    [BOOT_BLE] = "ble",           [BOOT_WIFI] = "wifi", [BOOT_HTTPD] = "httpd",
+};
+
+// Kept through deep sleep; every other boot loads it zeroed from the image
+RTC_DATA_ATTR static pedal_wake_t s_wake;
+static const pedal_wake_t *s_woke;
+static bool s_checked;
+
+// Microseconds since boot per stage, 0 until reached
+static uint32_t s_stage_us[BOOT_STAGES];
+
+static struct {
+    boot_stage_t stage;
+    boot_init_t init;
+} s_defer[BOOT_DEFER_MAX];
+static int s_deferred;
+static TaskHandle_t s_task;
+
+const pedal_wake_t *boot_wake_state(void)
+{
+    if (!s_checked) {
+        s_checked = true;
+        if (esp_reset_reason() == ESP_RST_DEEPSLEEP) {
+            if (pedal_wake_check(&s_wake) == 0) s_woke = &s_wake;
+            else ESP_LOGW(TAG, "Woke without a sealed state, loading the config from NVS");
+        }
+    }
+    return s_woke;
+}
+
+void boot_sleep_seal(const pedal_config_t *cfg, const pedal_logic_t *lg, uint16_t exp)
+{
+    pedal_wake_seal(&s_wake, cfg, lg, exp);
+}
+
+void boot_mark(boot_stage_t stage)
+{
+    uint32_t now = esp_timer_get_time(), none = 0;
+    if (!now) now = 1;
+    if (!__atomic_compare_exchange_n(&s_stage_us[stage], &none, now, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        return;
+    if (stage != BOOT_FIRST_MIDI) return;
+    // Only the transmit tasks on core 0 get here, never the scan loop
+    if (now > BOOT_BUDGET_US)
+        ESP_LOGW(TAG, "First MIDI %lu ms after boot, over the %d ms budget", (unsigned long)(now / 1000),
+                 CONFIG_PEDAL_WAKE_BUDGET_MS);
+    if (s_task) xTaskNotifyGive(s_task);
+}
+
+esp_err_t boot_defer(boot_stage_t stage, boot_init_t init)
+{
+    if (s_task) return ESP_ERR_INVALID_STATE;
+    if (s_deferred == BOOT_DEFER_MAX) return ESP_ERR_NO_MEM;
+    s_defer[s_deferred].stage = stage;
+    s_defer[s_deferred].init = init;
+    s_deferred++;
+    return ESP_OK;
+}
+
+// Below TinyUSB, so enumeration is never held up by a radio coming up
+static void background_task(void *arg)
+{
+    (void)arg;
+    // After a wake the radios wait for the press that woke the pedal to go out
+    if (boot_wake_state() && !__atomic_load_n(&s_stage_us[BOOT_FIRST_MIDI], __ATOMIC_RELAXED)) {
+        int64_t left = (int64_t)BOOT_BUDGET_US - esp_timer_get_time();
+        if (left > 0) ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(left / 1000) + 1);
+    }
+    for (int i = 0; i < s_deferred; i++) {
+        esp_err_t err = s_defer[i].init();
+        if (err == ESP_OK) boot_mark(s_defer[i].stage);
+        else ESP_LOGE(TAG, "Deferred %s start failed: %s", s_stage_names[s_defer[i].stage], esp_err_to_name(err));
+    }
+    ESP_LOGI(TAG, "%s: scan at %lu us, first MIDI at %lu us, everything up at %lu ms",
+             s_woke ? "Woke" : "Booted", (unsigned long)s_stage_us[BOOT_SCAN],
+             (unsigned long)s_stage_us[BOOT_FIRST_MIDI], (unsigned long)(esp_timer_get_time() / 1000));
+    vTaskDelete(NULL);
+}
+
+esp_err_t boot_background_start(void)
+{
+    if (xTaskCreatePinnedToCore(background_task, "boot", 4096, NULL, RT_PRIO_BOOT, &s_task, RT_SYS_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Cannot start deferred boot task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+// Deferred, so the scan has long read the switches held since power-on
+static esp_err_t start_ble(void)
+{
+    return ble_midi_start((matrix_scan_state() & BOOT_NEW_IDENTITY) == BOOT_NEW_IDENTITY);
+}
+
+// The preset index is only needed by the web server: mounted off the wake path
+static esp_err_t start_wifi(void)
+{
+    if (preset_store_init() != ESP_OK) ESP_LOGW(TAG, "Presets unavailable");
+    return config_radio_start();
+}
+
+esp_err_t boot_stage_run(void)
+{
+    const pedal_wake_t *w = boot_wake_state();
+    esp_err_t err = w ? app_config_resume(&w->cfg) : app_config_load();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "No live config: %s", esp_err_to_name(err));
+        return err;
+    }
+    boot_mark(BOOT_RESTORE);
+    if (w) exp_input_seed(w->exp);
+    err = power_start();
+    if (err == ESP_OK) err = midi_out_start();
+    if (err == ESP_OK) err = pedal_rt_start();
+    if (err == ESP_OK) err = leds_start();
+    if (err == ESP_OK) err = app_config_writer_start();
+    if (err == ESP_OK) err = boot_defer(BOOT_BLE, start_ble);
+    if (err == ESP_OK) err = boot_defer(BOOT_WIFI, start_wifi);
+    if (err == ESP_OK) err = boot_background_start();
+    return err;
+}
+
+size_t boot_json(char *buf, size_t cap)
+{
+    uint32_t first = __atomic_load_n(&s_stage_us[BOOT_FIRST_MIDI], __ATOMIC_RELAXED);
+    size_t n = snprintf(buf, cap, "{\"woke\":%s,\"budget_ms\":%d,\"within_budget\":%s,\"stages_us\":{",
+                        s_woke ? "true" : "false", CONFIG_PEDAL_WAKE_BUDGET_MS,
+                        !first ? "null" : first <= BOOT_BUDGET_US ? "true" : "false");
+    for (int s = 0; s < BOOT_STAGES && n < cap; s++) {
+        uint32_t us = __atomic_load_n(&s_stage_us[s], __ATOMIC_RELAXED);
+        if (us) n += snprintf(buf + n, cap - n, "%s\"%s\":%lu", s ? "," : "", s_stage_names[s], (unsigned long)us);
+        else n += snprintf(buf + n, cap - n, "%s\"%s\":null", s ? "," : "", s_stage_names[s]);
+    }
+    if (n < cap) n += snprintf(buf + n, cap - n, "}}");
+    return n < cap ? n : 0;
+}
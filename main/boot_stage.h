@@ -0,0 +1,65 @@
+#ifndef BOOT_STAGE_H
+#define BOOT_STAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "pedal_logic.h"
+#include "pedal_wake.h"
+
+/*
+ * Staged boot. Only what a footswitch press needs comes up in line: the
+ * config (from RTC memory after a deep-sleep wake, NVS otherwise), the
+ * matrix scan and USB MIDI. BLE, WiFi and httpd are deferred to a
+ * background task on core 0 that starts once the wake press has gone out,
+ * or CONFIG_PEDAL_WAKE_BUDGET_MS after boot if it never does. After a
+ * wake the scan loop carries on with the bank and toggles it slept with
+ * (pedal_rt.c).
+ *
+ * Every stage is stamped once, in microseconds on the esp_timer clock,
+ * and reported by /api/metrics under "boot".
+ */
+typedef enum {
+    BOOT_RESTORE,        // live config published
+    BOOT_SCAN,           // matrix scan running
+    BOOT_USB,            // host mounted the USB MIDI interface
+    BOOT_FIRST_MIDI,     // first message handed to a transport
+    BOOT_BLE,            // deferred
+    BOOT_WIFI,           // first time WiFi came up (config_radio.h: on demand)
+    BOOT_HTTPD,          // first time the web server came up
+    BOOT_STAGES,
+} boot_stage_t;
+
+typedef esp_err_t (*boot_init_t)(void);
+
+/**
+ * The whole sequence, for app_main() once NVS, TinyUSB and the WiFi
+ * driver are initialized (config_radio.h): config restored or loaded,
+ * expression seeded, power management, MIDI out, the scan loop and the
+ * LEDs started, then BLE and WiFi handed to the background task. Holding
+ * Switch 5 + 8 until BLE comes up asks it for a new identity (ble_midi.h).
+ */
+esp_err_t boot_stage_run(void);
+
+// The sealed state if this boot is a deep-sleep wake, NULL otherwise.
+const pedal_wake_t *boot_wake_state(void);
+
+/**
+ * Scan loop, right before esp_deep_sleep_start() and after
+ * app_config_flush(): config, bank, toggles and expression position into
+ * RTC memory for the next wake.
+ */
+void boot_sleep_seal(const pedal_config_t *cfg, const pedal_logic_t *lg, uint16_t exp);
+
+// Stamps stage with the current time; later calls for it are ignored.
+void boot_mark(boot_stage_t stage);
+
+// Runs init from the background task, after the ones deferred before it.
+esp_err_t boot_defer(boot_stage_t stage, boot_init_t init);
+
+esp_err_t boot_background_start(void);
+
+// "boot" object of /api/metrics; returns the length, 0 if cap is too small.
+size_t boot_json(char *buf, size_t cap);
+
+#endif
@@ -0,0 +1,241 @@
+#include <string.h>
+#include <unistd.h>
+#include "esp_coexist.h"
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include "boot_stage.h"
+#include "config_radio.h"
+#include "metrics.h"
+#include "power.h"
+#include "preset_store.h"
+#include "rt_tasks.h"
+#include "status_stream.h"
+#include "web_api.h"
+#include "web_ui.h"
+
+static const char *TAG = "config_radio";
+
+#define RADIO_COMBO       ((1u << 0) | (1u << 3))   // Switch 1 + 4
+#define RADIO_REQ_ON      (1u << 0)
+#define RADIO_REQ_OFF     (1u << 1)
+#define RADIO_REQ_TOGGLE  (1u << 2)
+#define RADIO_IDLE_MS     (CONFIG_PEDAL_WIFI_IDLE_S * 1000u)
+#define RADIO_MAX_URIS    16                        // 13 registered today
+#define RADIO_POLL_MS     1000
+// The access point the web UI is served on (README)
+#define RADIO_AP_SSID     "MidiBox_Config"
+#define RADIO_AP_PASS     "12345678"
+#define RADIO_AP_CHANNEL  1
+#define RADIO_AP_CLIENTS  4
+
+static TaskHandle_t s_task;
+static esp_netif_t *s_ap;
+static bool s_wifi_ready;
+static httpd_handle_t s_server;
+static volatile bool s_on;
+// Open sockets, counted by the httpd task; idle since the count last hit 0
+static int s_clients;
+static uint32_t s_idle_ms;
+
+// Scan loop only
+static bool s_combo_held, s_combo_fired;
+static uint32_t s_combo_ms;
+
+// USB transmit task only
+static const uint8_t WIFI_SYSEX[] = { 0xF0, 0x7D, 0x4D, 0x42, 0x57 };
+static uint8_t s_sysex[8];
+static uint8_t s_sysex_len;
+
+static uint32_t now_ms(void)
+{
+    return esp_timer_get_time() / 1000;
+}
+
+static esp_err_t client_open(httpd_handle_t hd, int fd)
+{
+    (void)hd;
+    (void)fd;
+    __atomic_add_fetch(&s_clients, 1, __ATOMIC_RELAXED);
+    return ESP_OK;
+}
+
+// Owning the close callback means closing the socket, too
+static void client_close(httpd_handle_t hd, int fd)
+{
+    (void)hd;
+    close(fd);
+    if (__atomic_sub_fetch(&s_clients, 1, __ATOMIC_RELAXED) <= 0)
+        __atomic_store_n(&s_idle_ms, now_ms(), __ATOMIC_RELAXED);
+}
+
+static esp_err_t start_httpd(void)
+{
+    httpd_config_t cfg = HTTPD_DEFAULT_CONFIG();
+    cfg.core_id = RT_SYS_CORE;
+    cfg.max_uri_handlers = RADIO_MAX_URIS;
+    cfg.lru_purge_enable = true;
+    cfg.open_fn = client_open;
+    cfg.close_fn = client_close;
+    esp_err_t err = httpd_start(&s_server, &cfg);
+    if (err != ESP_OK) return err;
+    err = web_ui_register(s_server);
+    if (err == ESP_OK) err = web_api_register(s_server);
+    if (err == ESP_OK) err = preset_store_register(s_server);
+    if (err == ESP_OK) err = metrics_register(s_server);
+    if (err == ESP_OK) err = status_stream_start(s_server);
+    return err;
+}
+
+// The AP settings stay in RAM, not in NVS
+esp_err_t config_radio_init(void)
+{
+    if (s_wifi_ready) return ESP_OK;
+    if (!s_ap && !(s_ap = esp_netif_create_default_wifi_ap())) return ESP_FAIL;
+    wifi_init_config_t init = WIFI_INIT_CONFIG_DEFAULT();
+    wifi_config_t ap = {
+        .ap = {
+            .ssid = RADIO_AP_SSID,
+            .ssid_len = sizeof(RADIO_AP_SSID) - 1,
+            .password = RADIO_AP_PASS,
+            .channel = RADIO_AP_CHANNEL,
+            .authmode = WIFI_AUTH_WPA2_PSK,
+            .max_connection = RADIO_AP_CLIENTS,
+        },
+    };
+    esp_err_t err = esp_wifi_init(&init);
+    if (err == ESP_OK) err = esp_wifi_set_storage(WIFI_STORAGE_RAM);
+    if (err == ESP_OK) err = esp_wifi_set_mode(WIFI_MODE_AP);
+    if (err == ESP_OK) err = esp_wifi_set_config(WIFI_IF_AP, &ap);
+    if (err == ESP_OK) s_wifi_ready = true;
+    return err;
+}
+
+static void radio_down(void)
+{
+    if (s_server) {
+        status_stream_stop();
+        httpd_stop(s_server);
+        s_server = NULL;
+    }
+    esp_wifi_stop();
+    s_clients = 0;
+    s_on = false;
+    power_wifi(false);
+}
+
+static esp_err_t radio_up(void)
+{
+    s_on = true;
+    power_wifi(true);
+    esp_err_t err = config_radio_init();
+    if (err == ESP_OK) err = esp_wifi_start();
+    if (err == ESP_OK) {
+        // BLE connection events win the shared radio; a page load can wait a few ms
+        esp_coex_preference_set(ESP_COEX_PREFER_BT);
+        wifi_mode_t mode = WIFI_MODE_NULL;
+        esp_wifi_get_mode(&mode);
+        // Half the channel width, half the air time the BLE slots have to dodge
+        if (mode == WIFI_MODE_AP || mode == WIFI_MODE_APSTA) esp_wifi_set_bandwidth(WIFI_IF_AP, WIFI_BW_HT20);
+        if (mode == WIFI_MODE_STA || mode == WIFI_MODE_APSTA) esp_wifi_set_bandwidth(WIFI_IF_STA, WIFI_BW_HT20);
+        err = start_httpd();
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot bring up WiFi and the web UI: %s", esp_err_to_name(err));
+        radio_down();
+        return err;
+    }
+    s_idle_ms = now_ms();
+    boot_mark(BOOT_WIFI);
+    boot_mark(BOOT_HTTPD);
+    ESP_LOGI(TAG, "WiFi and web UI up");
+    return ESP_OK;
+}
+
+static void radio_task(void *arg)
+{
+    (void)arg;
+#if !CONFIG_PEDAL_WIFI_ON_DEMAND
+    radio_up();
+#endif
+    for (;;) {
+        uint32_t req = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &req, s_on ? pdMS_TO_TICKS(RADIO_POLL_MS) : portMAX_DELAY);
+        if (req & RADIO_REQ_TOGGLE) req |= s_on ? RADIO_REQ_OFF : RADIO_REQ_ON;
+        if (req & RADIO_REQ_OFF) {
+            if (s_on) {
+                ESP_LOGI(TAG, "WiFi off on request");
+                radio_down();
+            }
+        } else if (req & RADIO_REQ_ON) {
+            if (!s_on) radio_up();
+            else s_idle_ms = now_ms();
+        }
+#if CONFIG_PEDAL_WIFI_ON_DEMAND
+        if (s_on && __atomic_load_n(&s_clients, __ATOMIC_RELAXED) <= 0 &&
+            now_ms() - __atomic_load_n(&s_idle_ms, __ATOMIC_RELAXED) >= RADIO_IDLE_MS) {
+            ESP_LOGI(TAG, "No web client for %d s, WiFi off", CONFIG_PEDAL_WIFI_IDLE_S);
+            radio_down();
+        }
+#endif
+    }
+}
+
+esp_err_t config_radio_start(void)
+{
+    if (xTaskCreatePinnedToCore(radio_task, "config_radio", 4096, NULL, RT_PRIO_BOOT, &s_task, RT_SYS_CORE) !=
+        pdPASS) {
+        ESP_LOGE(TAG, "Cannot start WiFi control task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void config_radio_request(bool on)
+{
+    if (s_task) xTaskNotify(s_task, on ? RADIO_REQ_ON : RADIO_REQ_OFF, eSetBits);
+}
+
+void config_radio_switches(uint8_t down, uint32_t now_ms)
+{
+    if (down != RADIO_COMBO) {
+        s_combo_held = s_combo_fired = false;
+        return;
+    }
+    if (!s_combo_held) {
+        s_combo_held = true;
+        s_combo_ms = now_ms;
+    } else if (!s_combo_fired && now_ms - s_combo_ms >= CONFIG_PEDAL_WIFI_COMBO_MS) {
+        // Once per hold; the notification is the only thing that crosses to core 0
+        s_combo_fired = true;
+        if (s_task) xTaskNotify(s_task, RADIO_REQ_TOGGLE, eSetBits);
+    }
+}
+
+void config_radio_usb_packet(const uint8_t pkt[4])
+{
+    // Code index 4: SysEx start or continue; 5, 6, 7: SysEx end with 1, 2, 3 bytes
+    uint8_t cin = pkt[0] & 0x0F;
+    int n = cin == 0x4 || cin == 0x7 ? 3 : cin == 0x6 ? 2 : cin == 0x5 ? 1 : 0;
+    for (int i = 0; i < n; i++) {
+        uint8_t b = pkt[1 + i];
+        if (b == 0xF0) s_sysex_len = 0;
+        if (s_sysex_len < sizeof(s_sysex)) s_sysex[s_sysex_len] = b;
+        if (s_sysex_len < UINT8_MAX) s_sysex_len++;
+        if (b != 0xF7) continue;
+        if (s_sysex_len == sizeof(WIFI_SYSEX) + 2 && !memcmp(s_sysex, WIFI_SYSEX, sizeof(WIFI_SYSEX)) &&
+            s_sysex[sizeof(WIFI_SYSEX)] <= 1)
+            config_radio_request(s_sysex[sizeof(WIFI_SYSEX)]);
+        s_sysex_len = 0;
+    }
+}
+
+bool config_radio_on(void)
+{
+    return s_on;
+}
@@ -0,0 +1,44 @@
+#ifndef CONFIG_RADIO_H
+#define CONFIG_RADIO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/*
+ * Performance mode: WiFi and the web server are off while playing, so
+ * BLE MIDI has the radio to itself and software coexistence never slices
+ * its connection events. They come up on demand, from Switch 1 + 4 held
+ * for CONFIG_PEDAL_WIFI_COMBO_MS or a SysEx from the USB host, and go
+ * down again once no web client has been connected for
+ * CONFIG_PEDAL_WIFI_IDLE_S. While WiFi is up, coexistence prefers BLE.
+ *
+ * app_main() initializes the driver as the soft AP "MidiBox_Config"
+ * (192.168.4.1) with config_radio_init(), and the deferred BOOT_WIFI stage
+ * calls config_radio_start(); everything after that happens in the
+ * config_radio task on core 0, which only starts and stops the driver.
+ * With CONFIG_PEDAL_WIFI_ON_DEMAND off, WiFi comes up at boot and stays
+ * up, as before.
+ *
+ * USB command, manufacturer ID 0x7D (non-commercial):
+ *     F0 7D 4D 42 57 01 F7   WiFi on     ("MBW")
+ *     F0 7D 4D 42 57 00 F7   WiFi off
+ */
+// Once esp_netif and the default event loop are up; later calls do nothing.
+esp_err_t config_radio_init(void);
+
+esp_err_t config_radio_start(void);
+
+// Any task: bring WiFi and httpd up (on) or down.
+void config_radio_request(bool on);
+
+// Scan loop, every iteration: debounced switches down (matrix_scan_state()).
+void config_radio_switches(uint8_t down, uint32_t now_ms);
+
+// USB transmit task: one USB-MIDI event packet received from the host.
+void config_radio_usb_packet(const uint8_t pkt[4]);
+
+// WiFi is up (or coming up); lock-free, for the latency metrics.
+bool config_radio_on(void);
+
+#endif
@@ -0,0 +1,214 @@
+#include "esp_adc/adc_continuous.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "pedal_exp_filter.h"
+#include "pedal_power.h"
+#include "rt_tasks.h"
+#include "exp_input.h"
+
+static const char *TAG = "exp_input";
+
+#define EXP_GPIO        2
+#define BATTERY_GPIO    7
+#define EXP_SAMPLE_HZ   (PEDAL_EXP_RATE_HZ * PEDAL_CIC_R)   // per channel, 32 kHz
+#define FRAME_SAMPLES   (2 * PEDAL_CIC_R)                   // both channels, one CIC output per frame
+#define FRAME_BYTES     (FRAME_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES)
+#define CIC_SETTLE      1       // outputs before the comb delay line is filled
+#define IDLE_POLL_MS    50      // one frame this often while suspended
+
+static adc_continuous_handle_t s_adc;
+static TaskHandle_t s_task;
+static TaskHandle_t s_rt_task;          // woken when the pedal moves while suspended
+static adc_channel_t s_exp_ch, s_bat_ch;
+static pedal_cic_t s_cic;
+static pedal_euro_t s_euro;
+static pedal_jack_t s_jack;
+// Nothing is sent until the first settled CIC output
+static volatile uint8_t s_jack_state = PEDAL_JACK_OPEN;
+static volatile uint16_t s_value;
+static bool s_seeded;
+static uint8_t s_settle;
+static volatile uint16_t s_battery;
+static volatile uint32_t s_overruns;
+// Requested by the scan loop; s_stopped is the task's side of it
+static volatile bool s_suspend;
+static bool s_stopped;
+static uint16_t s_raw, s_raw_ref;
+static uint32_t s_outputs;
+
+static bool IRAM_ATTR on_frame(adc_continuous_handle_t adc, const adc_continuous_evt_data_t *edata, void *ctx)
+{
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(s_task, &woken);
+    return woken == pdTRUE;
+}
+
+static bool IRAM_ATTR on_overrun(adc_continuous_handle_t adc, const adc_continuous_evt_data_t *edata, void *ctx)
+{
+    s_overruns++;
+    return false;
+}
+
+static void process(const uint8_t *buf, uint32_t len)
+{
+    uint16_t exp[FRAME_SAMPLES], dec[FRAME_SAMPLES / PEDAL_CIC_R + 1];
+    size_t n = 0;
+    uint32_t bat = 0, nbat = 0;
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= len; i += SOC_ADC_DIGI_RESULT_BYTES) {
+        const adc_digi_output_data_t *d = (const adc_digi_output_data_t *)&buf[i];
+        if (d->type2.channel == s_exp_ch && n < FRAME_SAMPLES) exp[n++] = d->type2.data;
+        else if (d->type2.channel == s_bat_ch) bat += d->type2.data, nbat++;
+    }
+    size_t m = pedal_cic_frame(&s_cic, exp, n, dec);
+    for (size_t j = 0; j < m; j++) {
+        // Combs start from zero, so the first output is about half the input
+        if (s_settle) {
+            s_settle--;
+            continue;
+        }
+        s_raw = dec[j];
+        s_outputs++;
+        s_jack_state = pedal_jack_step(&s_jack, dec[j]);
+        s_value = pedal_euro_step(&s_euro, dec[j]);
+    }
+    if (nbat) s_battery = bat / nbat;
+}
+
+static void drain(void)
+{
+    static uint8_t buf[FRAME_BYTES];
+    uint32_t len;
+    while (adc_continuous_read(s_adc, buf, sizeof(buf), &len, 0) == ESP_OK) process(buf, len);
+}
+
+// Fresh CIC state: the combs would otherwise difference across the gap
+static esp_err_t restart(void)
+{
+    pedal_cic_init(&s_cic);
+    s_settle = CIC_SETTLE;
+    return adc_continuous_start(s_adc);
+}
+
+// One settled output with the ADC started just for it; true if the pedal
+// moved (or was plugged in or out) since the scan loop went idle
+static bool poll_moved(void)
+{
+    uint32_t outputs = s_outputs;
+    if (restart() != ESP_OK) return false;
+    for (int i = 0; i < 4 * (CIC_SETTLE + 1) && s_outputs == outputs; i++) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(2));
+        drain();
+    }
+    adc_continuous_stop(s_adc);
+    adc_continuous_flush_pool(s_adc);
+    return s_outputs != outputs && pedal_idle_moved(s_raw_ref, s_raw);
+}
+
+static void exp_task(void *arg)
+{
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, s_stopped ? pdMS_TO_TICKS(IDLE_POLL_MS) : portMAX_DELAY);
+        if (s_suspend && !s_stopped) {
+            // The driver drops its PM lock with the DMA
+            adc_continuous_stop(s_adc);
+            adc_continuous_flush_pool(s_adc);
+            s_raw_ref = s_raw;
+            s_stopped = true;
+        } else if (s_stopped && (!s_suspend || poll_moved())) {
+            bool moved = s_suspend;
+            s_suspend = false;
+            s_stopped = false;
+            if (restart() != ESP_OK) ESP_LOGE(TAG, "ADC did not restart");
+            if (moved) xTaskNotifyGive(s_rt_task);
+        }
+        if (!s_stopped) drain();
+    }
+}
+
+esp_err_t exp_input_start(void)
+{
+    adc_unit_t unit;
+    esp_err_t err = adc_continuous_io_to_channel(EXP_GPIO, &unit, &s_exp_ch);
+    if (err == ESP_OK) err = adc_continuous_io_to_channel(BATTERY_GPIO, &unit, &s_bat_ch);
+    if (err != ESP_OK) return err;
+
+    pedal_cic_init(&s_cic);
+    pedal_jack_init(&s_jack);
+    pedal_euro_init(&s_euro, PEDAL_EXP_RATE_HZ, PEDAL_EXP_MIN_CUTOFF_MHZ, PEDAL_EXP_BETA_Q8, PEDAL_EXP_D_CUTOFF_MHZ);
+    if (s_seeded) pedal_euro_step(&s_euro, s_value);
+    s_rt_task = xTaskGetCurrentTaskHandle();
+    s_settle = CIC_SETTLE;
+
+    // Channels alternate, so each gets half the conversion rate
+    adc_digi_pattern_config_t pattern[2] = {
+        { .atten = ADC_ATTEN_DB_12, .channel = s_exp_ch, .unit = ADC_UNIT_1, .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH },
+        { .atten = ADC_ATTEN_DB_12, .channel = s_bat_ch, .unit = ADC_UNIT_1, .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH },
+    };
+    adc_continuous_handle_cfg_t handle_cfg = {
+        .max_store_buf_size = 4 * FRAME_BYTES,
+        .conv_frame_size = FRAME_BYTES,
+    };
+    adc_continuous_config_t cfg = {
+        .pattern_num = 2,
+        .adc_pattern = pattern,
+        .sample_freq_hz = 2 * EXP_SAMPLE_HZ,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE2,
+    };
+    adc_continuous_evt_cbs_t cbs = { .on_conv_done = on_frame, .on_pool_ovf = on_overrun };
+
+    if (xTaskCreatePinnedToCore(exp_task, "exp_input", 3072, NULL, RT_PRIO_EXP, &s_task, RT_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Cannot start expression task");
+        return ESP_ERR_NO_MEM;
+    }
+    err = adc_continuous_new_handle(&handle_cfg, &s_adc);
+    if (err == ESP_OK) err = adc_continuous_config(s_adc, &cfg);
+    if (err == ESP_OK) err = adc_continuous_register_event_callbacks(s_adc, &cbs, NULL);
+    if (err == ESP_OK) err = adc_continuous_start(s_adc);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ADC DMA failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "Expression at %d Hz, filtered to %d Hz", EXP_SAMPLE_HZ, PEDAL_EXP_RATE_HZ);
+    return ESP_OK;
+}
+
+void exp_input_suspend(void)
+{
+    s_suspend = true;
+    xTaskNotifyGive(s_task);
+}
+
+void exp_input_resume(void)
+{
+    s_suspend = false;
+    xTaskNotifyGive(s_task);
+}
+
+void exp_input_seed(uint16_t value)
+{
+    s_value = value;
+    s_seeded = true;
+}
+
+uint16_t exp_input_read(void)
+{
+    return s_value;
+}
+
+uint8_t exp_input_jack(void)
+{
+    return s_jack_state;
+}
+
+uint16_t exp_input_battery(void)
+{
+    return s_battery;
+}
+
+uint32_t exp_input_overruns(void)
+{
+    return s_overruns;
+}
@@ -0,0 +1,48 @@
+#ifndef EXP_INPUT_H
+#define EXP_INPUT_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "pedal_exp_filter.h"
+
+/*
+ * Expression pedal (GPIO 2) and battery sense (GPIO 7) converted
+ * continuously by ADC1 into DMA frames. A task woken once per frame runs
+ * the expression samples through a CIC decimator and a one-euro filter
+ * (pedal_exp_filter.h) and publishes the latest value; readers never wait
+ * for a conversion. Battery sense shares the stream because one-shot reads
+ * are refused on a unit that is in continuous mode. Called from pedal_rt,
+ * so the DMA interrupt and the filter task share the real-time core.
+ */
+esp_err_t exp_input_start(void);
+
+// Before exp_input_start(), after a wake: the position the pedal was left
+// at (pedal_wake_t.exp). The filter starts from it, so a pedal that was not
+// moved comes back on the value it sent before sleeping.
+void exp_input_seed(uint16_t value);
+
+/**
+ * Scan loop, going idle: stops the DMA, which lets the chip sleep. The
+ * task then converts a single frame every 50 ms, and when the pedal has
+ * moved past PEDAL_IDLE_EXP_DEADBAND (or was plugged in or out) it streams
+ * again and wakes the scan loop. exp_input_resume() streams again at once.
+ */
+void exp_input_suspend(void);
+void exp_input_resume(void);
+
+// Filtered pedal position, 12-bit counts in Q4 (0..PEDAL_EXP_FULL); map it
+// through the bank's calibration and curve with pedal_table_exp().
+uint16_t exp_input_read(void);
+
+// PEDAL_JACK_OK while a pedal is plugged in; nothing should be sent otherwise
+uint8_t exp_input_jack(void);
+
+// Mean battery-sense reading over the last frame, 0..4095
+uint16_t exp_input_battery(void);
+// Battery sense: 1:2 divider into ADC1 at 12 dB, about 3.1 V full scale
+#define EXP_INPUT_BATTERY_MV(raw)  ((uint32_t)(raw) * 2 * 3100 / 4095)
+
+// Frames lost because the task fell behind the DMA
+uint32_t exp_input_overruns(void);
+
+#endif
@@ -0,0 +1,133 @@
+#include <string.h>
+#include "driver/rmt_tx.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "pedal_led.h"
+#include "exp_input.h"
+#include "leds.h"
+#include "rt_tasks.h"
+
+static const char *TAG = "leds";
+
+#define LED_GPIO          48
+#define LED_RES_HZ        10000000                  // 0.1 us per RMT tick
+#define LED_DMA_SYMBOLS   256                       // a whole frame (216 bits) in one DMA buffer
+#define LED_BATTERY_MS    5000
+#define LED_SEND_MS       10
+#define LED_STATE_VALID   (1u << 24)
+
+static TaskHandle_t s_task;
+static rmt_channel_handle_t s_chan;
+static rmt_encoder_handle_t s_enc;
+// bank | on << 8 | brightness << 16, written by the scan loop
+static uint32_t s_state;
+static uint32_t s_published;
+static volatile bool s_identity;
+
+void leds_update(uint8_t bank, uint8_t on, uint8_t brightness)
+{
+    uint32_t v = bank | (uint32_t)on << 8 | (uint32_t)brightness << 16 | LED_STATE_VALID;
+    if (v == s_published) return;
+    s_published = v;
+    __atomic_store_n(&s_state, v, __ATOMIC_RELEASE);
+    if (s_task) xTaskNotifyGive(s_task);
+}
+
+void leds_identity(void)
+{
+    s_identity = true;
+    if (s_task) xTaskNotifyGive(s_task);
+}
+
+static esp_err_t init_rmt(void)
+{
+    rmt_tx_channel_config_t chan_cfg = {
+        .gpio_num = LED_GPIO,
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = LED_RES_HZ,
+        .mem_block_symbols = LED_DMA_SYMBOLS,
+        .trans_queue_depth = 1,
+        .flags.with_dma = true,
+    };
+    // WS2812B: 0 is 0.3 us high + 0.9 us low, 1 is 0.9 us high + 0.3 us low
+    rmt_bytes_encoder_config_t enc_cfg = {
+        .bit0 = { .level0 = 1, .duration0 = 3, .level1 = 0, .duration1 = 9 },
+        .bit1 = { .level0 = 1, .duration0 = 9, .level1 = 0, .duration1 = 3 },
+        .flags.msb_first = 1,
+    };
+    esp_err_t err = rmt_new_tx_channel(&chan_cfg, &s_chan);
+    if (err == ESP_OK) err = rmt_new_bytes_encoder(&enc_cfg, &s_enc);
+    return err;
+}
+
+// The channel is only enabled for the transfer, so it holds no PM lock in between
+static void send(const uint8_t *frame)
+{
+    static const rmt_transmit_config_t tx = { .loop_count = 0 };
+    esp_err_t err = rmt_enable(s_chan);
+    if (err == ESP_OK) err = rmt_transmit(s_chan, s_enc, frame, PEDAL_LED_FRAME, &tx);
+    if (err == ESP_OK) err = rmt_tx_wait_all_done(s_chan, LED_SEND_MS);
+    rmt_disable(s_chan);
+    if (err != ESP_OK) ESP_LOGW(TAG, "LED frame not sent: %s", esp_err_to_name(err));
+}
+
+static void leds_task(void *arg)
+{
+    (void)arg;
+    esp_err_t err = init_rmt();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "RMT init failed: %s", esp_err_to_name(err));
+        s_task = NULL;
+        vTaskDelete(NULL);
+        return;
+    }
+    static pedal_led_t led;
+    pedal_led_state_t st = { .battery = PEDAL_LED_BAT_UNKNOWN };
+    uint32_t shown = 0, battery_ms = 0, next = 0;
+    pedal_led_init(&led, 0);
+    for (;;) {
+        // The frame timer: the next animation step, else the next battery reading
+        TickType_t wait = pdMS_TO_TICKS(LED_BATTERY_MS);
+        uint32_t now = esp_timer_get_time() / 1000;
+        if (next) {
+            int32_t ms = (int32_t)(next - now);
+            if (ms <= 0) wait = 0;
+            else if (ms < LED_BATTERY_MS) wait = pdMS_TO_TICKS(ms) + 1;
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+        now = esp_timer_get_time() / 1000;
+
+        uint32_t v = __atomic_load_n(&s_state, __ATOMIC_ACQUIRE);
+        if (!(v & LED_STATE_VALID)) continue;
+        if (v != shown) {
+            // The first update is the boot flash
+            uint8_t bank = v & 0xFF;
+            if (!shown || bank != st.bank) pedal_led_animate(&led, PEDAL_LED_ANIM_BANK, now);
+            st.bank = bank;
+            st.on = v >> 8;
+            pedal_led_brightness(&led, v >> 16);
+            shown = v;
+        }
+        if (s_identity) {
+            s_identity = false;
+            pedal_led_animate(&led, PEDAL_LED_ANIM_IDENTITY, now);
+        }
+        if (now - battery_ms >= LED_BATTERY_MS) {
+            st.battery = pedal_led_battery(st.battery, EXP_INPUT_BATTERY_MV(exp_input_battery()));
+            battery_ms = now;
+        }
+        if (pedal_led_render(&led, &st, now, &next)) send(led.frame);
+    }
+}
+
+esp_err_t leds_start(void)
+{
+    // The RMT and DMA interrupts are installed from the task, on core 0
+    if (xTaskCreatePinnedToCore(leds_task, "leds", 3072, NULL, RT_PRIO_LED, &s_task, RT_SYS_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Cannot start LED task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
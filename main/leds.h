@@ -0,0 +1,29 @@
+#ifndef LEDS_H
+#define LEDS_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+/*
+ * The nine WS2812B LEDs on GPIO 48 (LED 1 battery, LEDs 2-9 the switches,
+ * pedal_led.h). A low-priority task on core 0 owns them: the scan loop
+ * only publishes bank, lit switches and brightness in one word with
+ * leds_update(), and the task renders a frame when that changed or an
+ * animation step is due, and sends it over RMT with DMA only when it
+ * differs from the frame on the LEDs. The task wakes for nothing else but
+ * a battery reading every few seconds, runs below the MIDI transmit tasks
+ * and installs the RMT interrupt on core 0, so no footswitch event ever
+ * waits for LED traffic.
+ *
+ * boot_stage_run() calls leds_start() after creating pedal_rt; the boot
+ * flash in the bank's color follows the scan loop's first update.
+ */
+esp_err_t leds_start(void);
+
+// Scan loop, every iteration: on bit n is switch n ON or held
+void leds_update(uint8_t bank, uint8_t on, uint8_t brightness);
+
+// Three purple flashes: a new BLE identity was generated
+void leds_identity(void);
+
+#endif
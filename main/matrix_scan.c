@@ -0,0 +1,221 @@
+#include <string.h>
+#include "driver/gpio.h"
+#include "driver/gptimer.h"
+#include "driver/rtc_io.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "soc/gpio_reg.h"
+#include "sdkconfig.h"
+#include "metrics.h"
+#include "rt_tasks.h"
+#include "matrix_scan.h"
+
+static const char *TAG = "matrix_scan";
+
+// Read from the interrupt, which also runs while flash is written: keep in DRAM
+static DRAM_ATTR const uint8_t s_row_gpio[PEDAL_SCAN_ROWS] = { 12, 13 };
+static DRAM_ATTR const uint8_t s_col_gpio[PEDAL_SCAN_COLS] = { 4, 5, 6, 8 };
+
+static pedal_scan_t s_scan;
+static gptimer_handle_t s_timer;
+static TaskHandle_t s_logic_task;
+static uint32_t s_ticks_per_ms;
+static uint32_t s_ticks;
+// Idle: timer stopped, every row low, a column going low wakes the loop
+static volatile bool s_suspended;
+static volatile uint32_t s_wake_us;
+
+static bool IRAM_ATTR on_alarm(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *ctx)
+{
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    uint32_t in = REG_READ(GPIO_IN_REG);
+    uint8_t cols = 0;
+    for (int c = 0; c < PEDAL_SCAN_COLS; c++) {
+        if (!(in & BIT(s_col_gpio[c]))) cols |= 1 << c;     // pulled up, pressed pulls low
+    }
+    uint8_t row = s_scan.row;
+    bool edge = pedal_scan_row(&s_scan, now, cols);
+
+    // Drive the next row now, so it has a whole period to settle before it is read
+    REG_WRITE(GPIO_OUT_W1TS_REG, BIT(s_row_gpio[row]));
+    REG_WRITE(GPIO_OUT_W1TC_REG, BIT(s_row_gpio[s_scan.row]));
+
+    BaseType_t woken = pdFALSE;
+    if (edge || ++s_ticks >= s_ticks_per_ms) {
+        s_ticks = 0;
+        vTaskNotifyGiveFromISR(s_logic_task, &woken);
+    }
+    return woken == pdTRUE;
+}
+
+static void IRAM_ATTR on_column(void *arg)
+{
+    for (int c = 0; c < PEDAL_SCAN_COLS; c++) gpio_intr_disable(s_col_gpio[c]);
+    if (!s_wake_us) s_wake_us = (uint32_t)esp_timer_get_time();
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(s_logic_task, &woken);
+    if (woken == pdTRUE) portYIELD_FROM_ISR();
+}
+
+esp_err_t matrix_scan_start(TaskHandle_t logic_task)
+{
+    // The timer interrupt lands on the calling core
+    if (xPortGetCoreID() != RT_CORE) ESP_LOGW(TAG, "Started on core %d, scan interrupt shares it", xPortGetCoreID());
+    pedal_scan_init(&s_scan, CONFIG_PEDAL_SCAN_RATE_HZ, CONFIG_PEDAL_SCAN_DEBOUNCE_MS);
+    s_logic_task = logic_task;
+    s_ticks_per_ms = s_scan.period_us < 1000 ? 1000 / s_scan.period_us : 1;
+
+    // Open drain rows, so two switches down in one column never short a high row to a low one
+    // After a deep-sleep wake the rows are still held low from before it
+    for (int r = 0; r < PEDAL_SCAN_ROWS; r++) gpio_hold_dis(s_row_gpio[r]);
+    gpio_deep_sleep_hold_dis();
+    gpio_config_t rows = { .mode = GPIO_MODE_OUTPUT_OD };
+    for (int r = 0; r < PEDAL_SCAN_ROWS; r++) rows.pin_bit_mask |= BIT64(s_row_gpio[r]);
+    gpio_config_t cols = { .mode = GPIO_MODE_INPUT, .pull_up_en = GPIO_PULLUP_ENABLE };
+    for (int c = 0; c < PEDAL_SCAN_COLS; c++) cols.pin_bit_mask |= BIT64(s_col_gpio[c]);
+    esp_err_t err = gpio_config(&rows);
+    if (err == ESP_OK) err = gpio_config(&cols);
+    if (err != ESP_OK) return err;
+    for (int r = 0; r < PEDAL_SCAN_ROWS; r++) gpio_set_level(s_row_gpio[r], r != s_scan.row);
+
+    // Column wake from light sleep; the rows have to keep their level while asleep
+    err = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+    if (err == ESP_ERR_INVALID_STATE) err = ESP_OK;
+    for (int c = 0; c < PEDAL_SCAN_COLS && err == ESP_OK; c++) {
+        gpio_sleep_sel_dis(s_col_gpio[c]);
+        err = gpio_isr_handler_add(s_col_gpio[c], on_column, NULL);
+    }
+    for (int r = 0; r < PEDAL_SCAN_ROWS; r++) gpio_sleep_sel_dis(s_row_gpio[r]);
+    if (err == ESP_OK) err = esp_sleep_enable_gpio_wakeup();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Column wake-up failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    gptimer_config_t timer_cfg = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = 1000000,
+    };
+    gptimer_alarm_config_t alarm = {
+        .alarm_count = s_scan.period_us,
+        .reload_count = 0,
+        .flags.auto_reload_on_alarm = true,
+    };
+    gptimer_event_callbacks_t cbs = { .on_alarm = on_alarm };
+    err = gptimer_new_timer(&timer_cfg, &s_timer);
+    if (err == ESP_OK) err = gptimer_register_event_callbacks(s_timer, &cbs, NULL);
+    if (err == ESP_OK) err = gptimer_set_alarm_action(s_timer, &alarm);
+    if (err == ESP_OK) err = gptimer_enable(s_timer);
+    if (err == ESP_OK) err = gptimer_start(s_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Scan timer failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "Scanning at %d Hz (%lu us per row), %d ms debounce", CONFIG_PEDAL_SCAN_RATE_HZ,
+             (unsigned long)s_scan.period_us, CONFIG_PEDAL_SCAN_DEBOUNCE_MS);
+    return ESP_OK;
+}
+
+void matrix_scan_suspend(void)
+{
+    // Disabling the timer drops its PM lock, so nothing of ours keeps the chip awake
+    gptimer_stop(s_timer);
+    gptimer_disable(s_timer);
+    ulTaskNotifyValueClear(NULL, UINT32_MAX);
+    // Every row low: a press anywhere pulls its column down
+    for (int r = 0; r < PEDAL_SCAN_ROWS; r++) gpio_set_level(s_row_gpio[r], 0);
+    s_wake_us = 0;
+    s_suspended = true;
+    // Level triggered, so a press that came in meanwhile fires at once
+    for (int c = 0; c < PEDAL_SCAN_COLS; c++) {
+        gpio_wakeup_enable(s_col_gpio[c], GPIO_INTR_LOW_LEVEL);
+        gpio_intr_enable(s_col_gpio[c]);
+    }
+}
+
+static void resume(void)
+{
+    for (int c = 0; c < PEDAL_SCAN_COLS; c++) {
+        gpio_intr_disable(s_col_gpio[c]);
+        gpio_wakeup_disable(s_col_gpio[c]);
+    }
+    s_suspended = false;
+    // One row driven again, settling for a period before the first sample,
+    // so a press is read within one full scan as while scanning
+    for (int r = 0; r < PEDAL_SCAN_ROWS; r++) gpio_set_level(s_row_gpio[r], r != s_scan.row);
+    pedal_scan_resume(&s_scan);
+    s_ticks = 0;
+    gptimer_set_raw_count(s_timer, 0);
+    esp_err_t err = gptimer_enable(s_timer);
+    if (err == ESP_OK) err = gptimer_start(s_timer);
+    if (err != ESP_OK) ESP_LOGE(TAG, "Scan timer did not restart: %s", esp_err_to_name(err));
+}
+
+void matrix_scan_deep_sleep(void)
+{
+    if (!s_suspended) matrix_scan_suspend();
+    // The rows keep driving low through deep sleep; the columns wake the chip
+    // from the RTC domain, which keeps their pull-ups
+    uint64_t cols = 0;
+    for (int r = 0; r < PEDAL_SCAN_ROWS; r++) gpio_hold_en(s_row_gpio[r]);
+    gpio_deep_sleep_hold_en();
+    for (int c = 0; c < PEDAL_SCAN_COLS; c++) {
+        rtc_gpio_pullup_en(s_col_gpio[c]);
+        rtc_gpio_pulldown_dis(s_col_gpio[c]);
+        cols |= BIT64(s_col_gpio[c]);
+    }
+    esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON);
+    esp_err_t err = esp_sleep_enable_ext1_wakeup(cols, ESP_EXT1_WAKEUP_ANY_LOW);
+    if (err != ESP_OK) ESP_LOGE(TAG, "Column wake from deep sleep failed: %s", esp_err_to_name(err));
+}
+
+void matrix_scan_wait(void)
+{
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (s_suspended) resume();
+}
+
+bool matrix_scan_suspended(void)
+{
+    return s_suspended;
+}
+
+bool matrix_scan_edge(pedal_scan_edge_t *e)
+{
+    if (!pedal_scan_pop(&s_scan, e)) return false;
+    // The first press after a column wake counts from the column interrupt
+    uint32_t wake = s_wake_us;
+    if (wake) {
+        s_wake_us = 0;
+        if (e->us - wake <= PEDAL_SCAN_ROWS * 2 * s_scan.period_us) {
+            metrics_latency(METRICS_RESUME, e->us - wake);
+            e->us = wake;
+        }
+    }
+    metrics_latency(METRICS_WAKE, (uint32_t)esp_timer_get_time() - e->us);
+    return true;
+}
+
+uint8_t matrix_scan_state(void)
+{
+    return s_scan.state;
+}
+
+uint32_t matrix_scan_period_us(void)
+{
+    return s_scan.period_us;
+}
+
+// Unlocked copy: the counters may be a sample apart, which is fine for a histogram
+void matrix_scan_jitter(pedal_scan_jitter_t *out)
+{
+    memcpy(out, (const void *)&s_scan.jitter, sizeof(*out));
+}
+
+uint32_t matrix_scan_dropped(void)
+{
+    return s_scan.dropped;
+}
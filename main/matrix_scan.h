@@ -0,0 +1,48 @@
+#ifndef MATRIX_SCAN_H
+#define MATRIX_SCAN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "pedal_scan.h"
+
+/*
+ * Footswitch matrix (rows GPIO12/13, columns GPIO4/5/6/8) scanned from a
+ * hardware timer at CONFIG_PEDAL_SCAN_RATE_HZ. The logic task (pedal_rt.c)
+ * starts the scan itself so the interrupt is on its core, sleeps in
+ * matrix_scan_wait() and is woken for every edge and once a millisecond
+ * for long-press timing. Once nothing has happened for a while,
+ * power_scan_loop() stops the scan (power.h) and a press wakes the loop
+ * through its column instead.
+ */
+esp_err_t matrix_scan_start(TaskHandle_t logic_task);
+
+// Restarts a suspended scan when woken
+void matrix_scan_wait(void);
+
+/**
+ * Scan loop only: stops the timer, drives every row low and arms the
+ * columns as light-sleep wake-up sources. The next matrix_scan_wait()
+ * returns on a press (or any notification) and restarts the scan, which
+ * reads the switch within one full scan, as while scanning; that edge is
+ * stamped with the column interrupt's time.
+ */
+void matrix_scan_suspend(void);
+bool matrix_scan_suspended(void);
+
+// Scan loop, before esp_deep_sleep_start(): rows held low, any column wakes.
+void matrix_scan_deep_sleep(void);
+
+// Next queued edge; e->us is the interrupt's sample time (esp_timer clock).
+bool matrix_scan_edge(pedal_scan_edge_t *e);
+
+// Debounced switches currently down, bit n: switch n (e.g. 5 + 8 at boot)
+uint8_t matrix_scan_state(void);
+
+uint32_t matrix_scan_period_us(void);
+void matrix_scan_jitter(pedal_scan_jitter_t *out);
+uint32_t matrix_scan_dropped(void);
+
+#endif
@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include "sdkconfig.h"
+#include "pedal_lat.h"
+#include "boot_stage.h"
+#include "matrix_scan.h"
+#include "metrics.h"
+
+static const char *const s_stage_names[METRICS_STAGES] = {
+    [METRICS_WAKE] = "wake",     [METRICS_LOGIC] = "logic", [METRICS_USB_TX] = "usb_tx",
+    [METRICS_BLE_TX] = "ble_tx", [METRICS_USB] = "usb",     [METRICS_BLE] = "ble",
+    [METRICS_BLE_WIFI_OFF] = "ble_wifi_off", [METRICS_BLE_WIFI_ON] = "ble_wifi_on",
+    [METRICS_RESUME] = "resume",
+};
+static pedal_lat_t s_lat[METRICS_STAGES];
+
+void metrics_latency(metrics_stage_t stage, uint32_t us)
+{
+    pedal_lat_add(&s_lat[stage], us);
+}
+
+// GET /api/metrics
+static esp_err_t metrics_get_handler(httpd_req_t *req)
+{
+    static char buf[1536];           // httpd serves one request at a time
+    pedal_scan_jitter_t j;
+    matrix_scan_jitter(&j);
+
+    size_t n = snprintf(buf, sizeof(buf),
+                        "{\"scan\":{\"rate_hz\":%d,\"period_us\":%lu,\"samples\":%lu,\"worst_us\":%lu,"
+                        "\"dropped\":%lu,\"jitter_us\":[",
+                        CONFIG_PEDAL_SCAN_RATE_HZ, (unsigned long)matrix_scan_period_us(), (unsigned long)j.samples,
+                        (unsigned long)j.worst_us, (unsigned long)matrix_scan_dropped());
+    for (int b = 0; b < PEDAL_SCAN_JITTER_BUCKETS && n < sizeof(buf); b++)
+        n += snprintf(buf + n, sizeof(buf) - n, "%s%lu", b ? "," : "", (unsigned long)j.hist[b]);
+    if (n < sizeof(buf)) n += snprintf(buf + n, sizeof(buf) - n, "]},\"latency_us\":{");
+    for (int s = 0; s < METRICS_STAGES && n < sizeof(buf); s++) {
+        n += snprintf(buf + n, sizeof(buf) - n, "%s\"%s\":", s ? "," : "", s_stage_names[s]);
+        if (n < sizeof(buf)) {
+            size_t len = pedal_lat_json(&s_lat[s], buf + n, sizeof(buf) - n);
+            n = len ? n + len : sizeof(buf);
+        }
+    }
+    if (n < sizeof(buf)) n += snprintf(buf + n, sizeof(buf) - n, "},\"boot\":");
+    if (n < sizeof(buf)) {
+        size_t len = boot_json(buf + n, sizeof(buf) - n);
+        n = len ? n + len : sizeof(buf);
+    }
+    if (n < sizeof(buf)) n += snprintf(buf + n, sizeof(buf) - n, "}");
+    if (n >= sizeof(buf)) return httpd_resp_send_500(req);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_send(req, buf, n);
+}
+
+esp_err_t metrics_register(httpd_handle_t server)
+{
+    static const httpd_uri_t uri = { .uri = "/api/metrics", .method = HTTP_GET, .handler = metrics_get_handler };
+    return httpd_register_uri_handler(server, &uri);
+}
@@ -0,0 +1,32 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+/*
+ * Press-to-wire latency, from the scan interrupt's sample of a footswitch
+ * edge to the hand-off of each resulting message to the USB and BLE
+ * stacks. Each stage has a single writer task, so recording is a few
+ * adds with no locking; it stays on in production.
+ */
+typedef enum {
+    METRICS_WAKE,          // edge sampled -> logic task picks it up
+    METRICS_RESUME,        // column interrupt after idle -> edge sampled (included in the above)
+    METRICS_LOGIC,         // picked up -> message queued for the transports
+    METRICS_USB_TX,        // queued -> accepted by TinyUSB
+    METRICS_BLE_TX,        // queued -> notification sent (waits for the connection interval)
+    METRICS_USB,           // edge -> TinyUSB, end to end
+    METRICS_BLE,           // edge -> BLE notification, end to end
+    METRICS_BLE_WIFI_OFF,  // the same, split by whether WiFi was up (config_radio)
+    METRICS_BLE_WIFI_ON,
+    METRICS_STAGES,
+} metrics_stage_t;
+
+void metrics_latency(metrics_stage_t stage, uint32_t us);
+
+// Registers /api/metrics: scan period jitter, latency histograms and boot stages.
+esp_err_t metrics_register(httpd_handle_t server);
+
+#endif
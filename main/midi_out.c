@@ -0,0 +1,330 @@
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include "tusb.h"
+#include "pedal_exp_out.h"
+#include "pedal_midi_out.h"
+#include "pedal_spsc.h"
+#include "pedal_usb_ring.h"
+#include "boot_stage.h"
+#include "config_radio.h"
+#include "metrics.h"
+#include "midi_out.h"
+#include "power.h"
+#include "rt_tasks.h"
+
+static const char *TAG = "midi_out";
+
+#define BLE_TX_SLOTS      4       // packets on their way to core 0, power of two
+#define BLE_TX_STAMPS     16      // footswitch messages timed per packet
+#define BLE_RETRY_MS      10      // while a central owes packets and no room was signalled
+// Events waiting for USB above which the expression pedal holds off
+#define USB_EXP_BACKLOG   (PEDAL_USB_RING_LEN / 4)
+// Until then, messages wait for the host to enumerate instead of being dropped
+#define USB_MOUNT_WAIT_US (CONFIG_PEDAL_WAKE_BUDGET_MS * 1000)
+// After that, how often an unplugged pedal looks for a host
+#define USB_PROBE_MS      100
+
+// Filled by the scan loop, drained by usb_tx_task
+static pedal_usb_ring_t s_usb;
+static uint32_t s_usb_signalled;
+static TaskHandle_t s_usb_task;
+static bool s_usb_mounted;
+
+// Expression pacing per transport; budgets from app_config_publish()
+static pedal_exp_out_t s_exp_usb, s_exp_ble;
+static volatile uint16_t s_usb_exp_ms = PEDAL_EXP_OUT_INTERVAL_MS, s_ble_exp_ms = 2 * PEDAL_EXP_OUT_INTERVAL_MS;
+static pedal_rate_t s_usb_rate, s_ble_rate;
+static uint32_t s_ble_exp_counted;
+
+static pedal_ble_out_t s_ble;
+static midi_out_ble_notify_t s_notify;
+
+// Link changes from the BT host task; the next flush applies the newest
+typedef struct {
+    midi_out_ble_notify_t notify;
+    uint16_t mtu;
+    uint32_t interval_us;
+} ble_link_t;
+static ble_link_t s_link_slot[PEDAL_LATEST_SLOTS];
+static pedal_latest_t s_link = PEDAL_LATEST_INITIALIZER;
+
+// Encoded by the scan loop, sent by ble_tx_task on core 0, so the real-time
+// core never enters the Bluetooth stack
+typedef struct {
+    midi_out_ble_notify_t notify;
+    uint16_t len;
+    uint16_t msgs;
+    uint8_t stamps;
+    uint8_t pkt[MIDI_OUT_BLE_PKT_MAX];
+    pedal_lat_stamp_t stamp[BLE_TX_STAMPS];
+} ble_pkt_t;
+static ble_pkt_t s_ble_pkt[BLE_TX_SLOTS];
+static pedal_spsc_t s_ble_tx;
+static TaskHandle_t s_ble_task;
+static uint32_t s_ble_refused;           // messages in packets no central took
+
+// Edge being resolved by the scan loop
+static uint32_t s_origin_us;
+static uint32_t s_pickup_us;
+
+void midi_out_origin(uint32_t edge_us)
+{
+    s_origin_us = edge_us;
+    s_pickup_us = edge_us ? (uint32_t)esp_timer_get_time() : 0;
+}
+
+void midi_out_sink(void *ctx, const pedal_midi_msg_t *msg)
+{
+    (void)ctx;
+    int64_t now = esp_timer_get_time();
+    pedal_lat_stamp_t stamp = { s_origin_us, (uint32_t)now };
+    if (s_origin_us) metrics_latency(METRICS_LOGIC, stamp.queued_us - s_pickup_us);
+#if !CONFIG_PEDAL_USB_MIDI_BENCH
+    pedal_usb_ring_push(&s_usb, msg, &stamp);
+#endif
+    if (s_notify) pedal_midi_queue_push(&s_ble.q, msg, now / 1000, &stamp);
+}
+
+// Called after the tick's footswitch messages were sunk, so on USB they
+// are always ahead in the ring; BLE keeps the value in its own slot.
+void midi_out_exp(uint8_t ch, uint8_t cc, uint16_t value)
+{
+    uint32_t now_ms = esp_timer_get_time() / 1000;
+    uint16_t prev;
+    s_exp_usb.interval_ms = s_usb_exp_ms;
+    s_exp_ble.interval_ms = s_ble_exp_ms;
+#if !CONFIG_PEDAL_USB_MIDI_BENCH
+    uint32_t backlog = s_usb.head - __atomic_load_n(&s_usb.tail, __ATOMIC_ACQUIRE);
+    if (backlog < USB_EXP_BACKLOG && pedal_exp_out_due(&s_exp_usb, value, now_ms, &prev)) {
+        pedal_midi_msg_t m[2];
+        int n = pedal_exp_cc14(ch, cc, value, prev, m);
+        for (int k = 0; k < n; k++) pedal_usb_ring_push(&s_usb, &m[k], NULL);
+        pedal_rate_add(&s_usb_rate, now_ms, 1);
+    }
+#endif
+    if (s_notify && pedal_exp_out_due(&s_exp_ble, value, now_ms, &prev))
+        pedal_ble_out_exp(&s_ble, ch, cc, value, now_ms);
+}
+
+void midi_out_exp_budget(uint16_t usb_hz, uint16_t ble_hz)
+{
+    s_usb_exp_ms = 1000 / pedal_exp_hz_clamp(usb_hz);
+    s_ble_exp_ms = 1000 / pedal_exp_hz_clamp(ble_hz);
+}
+
+static void record_sent(const pedal_lat_stamp_t *stamp, uint32_t now, metrics_stage_t tx, metrics_stage_t total)
+{
+    if (!stamp->origin_us) return;
+    metrics_latency(tx, now - stamp->queued_us);
+    metrics_latency(total, now - stamp->origin_us);
+}
+
+// Hands the ring to TinyUSB a transfer's worth at a time. packet_write_n
+// queues the run and starts one bulk transfer, so a burst leaves in 64-byte
+// packets instead of one event per transfer.
+static void usb_tx_task(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        // Woken by a flush; the timeout retries after the host fell behind.
+        // Without a host it only probes now and then, so the chip can sleep.
+        bool waiting = s_usb_mounted || esp_timer_get_time() < USB_MOUNT_WAIT_US;
+        ulTaskNotifyTake(pdTRUE, waiting ? 1 : pdMS_TO_TICKS(USB_PROBE_MS));
+        bool mounted = tud_midi_mounted();
+        if (mounted != s_usb_mounted) {
+            s_usb_mounted = mounted;
+            if (mounted) boot_mark(BOOT_USB);
+            power_usb(mounted);
+        }
+        // From the host only the WiFi command means anything; the rest is
+        // read so the OUT endpoint never backs up
+        uint8_t in[4];
+        while (tud_midi_n_packet_read(0, in))
+            config_radio_usb_packet(in);
+        const uint8_t *span;
+        size_t n;
+        while ((n = pedal_usb_ring_peek(&s_usb, &span, PEDAL_USB_XFER_EVENTS))) {
+            if (!tud_midi_mounted()) {
+                // The press that woke the pedal goes out once the host has enumerated it
+                if (esp_timer_get_time() < USB_MOUNT_WAIT_US) break;
+                pedal_usb_ring_consume(&s_usb, n, 0);
+                continue;
+            }
+            size_t took = tud_midi_n_packet_write_n(0, span, n * PEDAL_USB_EVENT_SIZE) / PEDAL_USB_EVENT_SIZE;
+            if (took) boot_mark(BOOT_FIRST_MIDI);
+            uint32_t now = esp_timer_get_time();
+            for (size_t k = 0; k < took; k++)
+                record_sent(pedal_usb_ring_stamp(&s_usb, k), now, METRICS_USB_TX, METRICS_USB);
+            pedal_usb_ring_consume(&s_usb, took, n);
+            if (took < n) break;
+        }
+    }
+}
+
+static void ble_tx_task(void *arg)
+{
+    (void)arg;
+    midi_out_ble_notify_t notify = NULL;
+    bool owed = false;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, owed ? pdMS_TO_TICKS(BLE_RETRY_MS) : portMAX_DELAY);
+        int slot;
+        while ((slot = pedal_spsc_front(&s_ble_tx)) >= 0) {
+            const ble_pkt_t *p = &s_ble_pkt[slot];
+            notify = p->notify;
+            if (p->notify(p->pkt, p->len) == ESP_OK) {
+                boot_mark(BOOT_FIRST_MIDI);
+                uint32_t now = esp_timer_get_time();
+                metrics_stage_t radio = config_radio_on() ? METRICS_BLE_WIFI_ON : METRICS_BLE_WIFI_OFF;
+                for (int k = 0; k < p->stamps; k++) {
+                    record_sent(&p->stamp[k], now, METRICS_BLE_TX, METRICS_BLE);
+                    if (p->stamp[k].origin_us) metrics_latency(radio, now - p->stamp[k].origin_us);
+                }
+            } else {
+                s_ble_refused += p->msgs;
+            }
+            pedal_spsc_pop(&s_ble_tx);
+        }
+        // A central that was congested gets what it missed, in order
+        owed = notify && notify(NULL, 0) != ESP_OK;
+    }
+}
+
+void midi_out_ble_retry(void)
+{
+    if (s_ble_task) xTaskNotifyGive(s_ble_task);
+}
+
+#if CONFIG_PEDAL_USB_MIDI_BENCH
+// Stands in for the scan loop as the ring's only producer: CC sweeps as
+// fast as the ring takes them, with the achieved rate logged every second.
+static void usb_bench_task(void *arg)
+{
+    (void)arg;
+    ESP_LOGI(TAG, "USB MIDI bench started");
+    uint32_t i = 0, events = 0, transfers = 0;
+    int64_t next_log = esp_timer_get_time() + 1000000;
+    for (;;) {
+        pedal_midi_msg_t m = { 3, { 0xB0, i & 0x7F, (i >> 7) & 0x7F } };
+        if (pedal_usb_ring_push(&s_usb, &m, NULL)) {
+            i++;
+            if (!(i & 15)) xTaskNotifyGive(s_usb_task);
+        } else {
+            xTaskNotifyGive(s_usb_task);
+            vTaskDelay(1);
+        }
+        if (esp_timer_get_time() >= next_log) {
+            next_log += 1000000;
+            uint32_t ev = s_usb.events - events, xf = s_usb.transfers - transfers;
+            events = s_usb.events;
+            transfers = s_usb.transfers;
+            ESP_LOGI(TAG, "USB MIDI bench: %lu events/s, %.1f per transfer, dropped %lu, stalls %lu",
+                     (unsigned long)ev, xf ? (double)ev / xf : 0.0, (unsigned long)s_usb.dropped,
+                     (unsigned long)s_usb.stalls);
+        }
+    }
+}
+#endif
+
+esp_err_t midi_out_start(void)
+{
+    pedal_exp_out_init(&s_exp_usb, 14, s_usb_exp_ms);
+    pedal_exp_out_init(&s_exp_ble, 14, s_ble_exp_ms);
+    pedal_ble_out_init(&s_ble, PEDAL_BLE_MTU_DEFAULT, 0);
+    pedal_spsc_init(&s_ble_tx, BLE_TX_SLOTS);
+    // Next to TinyUSB and the BT host
+    if (xTaskCreatePinnedToCore(usb_tx_task, "usb_midi_tx", 2048, NULL, RT_PRIO_TX, &s_usb_task, RT_SYS_CORE) !=
+            pdPASS ||
+        xTaskCreatePinnedToCore(ble_tx_task, "ble_midi_tx", 3072, NULL, RT_PRIO_TX, &s_ble_task, RT_SYS_CORE) !=
+            pdPASS) {
+        ESP_LOGE(TAG, "Cannot start MIDI transmit tasks");
+        return ESP_ERR_NO_MEM;
+    }
+#if CONFIG_PEDAL_USB_MIDI_BENCH
+    xTaskCreate(usb_bench_task, "usb_midi_bench", 3072, NULL, 1, NULL);
+#endif
+    return ESP_OK;
+}
+
+static void apply_link(const ble_link_t *l)
+{
+    if (!l->notify) s_ble.q.tail = s_ble.q.head;
+    // Whoever just connected gets the whole expression value
+    s_ble.exp_pending = false;
+    s_ble.exp_sent = PEDAL_EXP_OUT_NONE;
+    pedal_exp_out_init(&s_exp_ble, 14, s_ble_exp_ms);
+    s_ble.mtu = l->mtu;
+    s_ble.interval_us = l->interval_us;
+    s_notify = l->notify;
+}
+
+void midi_out_flush(void)
+{
+    uint32_t now_ms = esp_timer_get_time() / 1000;
+    pedal_rate_add(&s_usb_rate, now_ms, 0);
+    pedal_rate_add(&s_ble_rate, now_ms, s_ble.exp_updates - s_ble_exp_counted);
+    s_ble_exp_counted = s_ble.exp_updates;
+
+    uint32_t head = s_usb.head;
+    if (head != s_usb_signalled && s_usb_task) {
+        s_usb_signalled = head;
+        xTaskNotifyGive(s_usb_task);
+    }
+
+    if (pedal_latest_take(&s_link)) apply_link(&s_link_slot[pedal_latest_front(&s_link)]);
+    if (!s_notify) return;
+    // While core 0 holds every slot the messages keep waiting in the queue
+    int slot = pedal_spsc_slot(&s_ble_tx);
+    if (slot < 0) return;
+    ble_pkt_t *p = &s_ble_pkt[slot];
+    uint32_t before = s_ble.msgs;
+    uint16_t tail = s_ble.q.tail;
+    p->len = pedal_ble_out_poll(&s_ble, esp_timer_get_time(), p->pkt, sizeof(p->pkt));
+    if (!p->len) return;
+    p->notify = s_notify;
+    p->msgs = s_ble.msgs - before;
+    // The packed events stay in their slots until the next push
+    p->stamps = 0;
+    for (; tail != s_ble.q.tail && p->stamps < BLE_TX_STAMPS; tail++) {
+        const pedal_lat_stamp_t *st = &s_ble.q.ev[tail & (PEDAL_MIDI_QUEUE_LEN - 1)].stamp;
+        if (st->origin_us) p->stamp[p->stamps++] = *st;
+    }
+    pedal_spsc_push(&s_ble_tx);
+    xTaskNotifyGive(s_ble_task);
+}
+
+void midi_out_ble_link(midi_out_ble_notify_t notify, uint16_t mtu, uint32_t interval_us)
+{
+    ble_link_t *l = &s_link_slot[pedal_latest_back(&s_link)];
+    l->notify = notify;
+    l->mtu = mtu;
+    l->interval_us = interval_us;
+    pedal_latest_publish(&s_link);
+}
+
+void midi_out_ble_stats(midi_out_stats_t *out)
+{
+    out->msgs = s_ble.msgs;
+    out->packets = s_ble.packets;
+    out->dropped = s_ble.q.dropped + s_ble_refused;
+    out->max_msgs = s_ble.max_msgs;
+    out->stalls = 0;
+    out->high_water = 0;
+    out->exp_hz = s_ble_rate.hz;
+    out->exp_coalesced = s_ble.exp_coalesced;
+}
+
+void midi_out_usb_stats(midi_out_stats_t *out)
+{
+    out->msgs = s_usb.events;
+    out->packets = s_usb.transfers;
+    out->dropped = s_usb.dropped;
+    out->max_msgs = 0;
+    out->stalls = s_usb.stalls;
+    out->high_water = s_usb.high_water;
+    out->exp_hz = s_usb_rate.hz;
+    out->exp_coalesced = 0;
+}
@@ -0,0 +1,83 @@
+#ifndef MIDI_OUT_H
+#define MIDI_OUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "pedal_table.h"
+
+/*
+ * MIDI output, one queue per transport. The scan loop installs
+ * midi_out_sink as the pedal_logic sink and calls midi_out_flush() at the
+ * end of every iteration, so all messages of one press (group fan-out,
+ * long press plus releases) leave together: USB as multi-event bulk
+ * transfers from a lock-free ring, BLE as a single notification per
+ * connection interval. Encoding happens on the real-time core; transmit
+ * tasks on core 0 take the results from lock-free rings and are the only
+ * ones to call into TinyUSB and the Bluetooth stack (rt_tasks.h).
+ */
+
+// Largest BLE-MIDI packet handed to midi_out_ble_notify_t
+#define MIDI_OUT_BLE_PKT_MAX  128
+
+/**
+ * Sends one BLE-MIDI packet as a notification on the MIDI I/O
+ * characteristic to every subscribed central; a central that cannot take
+ * it now keeps it for later. ESP_FAIL if no central took it.
+ * notify(NULL, 0) retries what the centrals still owe, ESP_OK once
+ * nothing is owed any more.
+ */
+typedef esp_err_t (*midi_out_ble_notify_t)(const uint8_t *pkt, size_t len);
+
+typedef struct {
+    uint32_t msgs;
+    uint32_t packets;            // BLE notifications / USB transfers
+    uint32_t dropped;
+    uint8_t max_msgs;            // BLE: most messages in one notification
+    uint32_t stalls;             // USB: the host took less than offered
+    uint32_t high_water;         // USB: most events ever waiting in the ring
+    uint16_t exp_hz;             // expression values sent per second
+    uint32_t exp_coalesced;      // BLE: values replaced by a newer one before they went out
+} midi_out_stats_t;
+
+// Starts the USB and BLE transmit tasks on core 0.
+esp_err_t midi_out_start(void);
+
+void midi_out_sink(void *ctx, const pedal_midi_msg_t *msg);
+
+// Footswitch edge (its scan sample time) that the next sunk messages
+// belong to, for the latency metrics; 0 for messages of a tick.
+void midi_out_origin(uint32_t edge_us);
+
+void midi_out_flush(void);
+
+/**
+ * Expression value, called every tick after the footswitches with the
+ * bank's 14-bit curve output (pedal_table_exp), and only while
+ * exp_input_jack() is PEDAL_JACK_OK. Sent when it changed, within each
+ * transport's budget, as a 14-bit MSB/LSB pair (7-bit CC for controllers
+ * above 31). USB skips values while the host is behind; BLE sends the
+ * latest value after everything queued at the next connection event.
+ */
+void midi_out_exp(uint8_t ch, uint8_t cc, uint16_t value);
+
+// Expression updates per second per transport (config exp_usb_hz / exp_ble_hz)
+void midi_out_exp_budget(uint16_t usb_hz, uint16_t ble_hz);
+
+/**
+ * Link state from the BLE glue: on connect, MTU exchange and connection
+ * parameter updates, and with notify NULL on disconnect (anything still
+ * queued is dropped then). Only the BT host task may call it; the scan
+ * loop picks up the newest state without locking. notify is called from
+ * the BLE transmit task.
+ */
+void midi_out_ble_link(midi_out_ble_notify_t notify, uint16_t mtu, uint32_t interval_us);
+
+// BLE glue: a central has room again; the transmit task retries what it owes.
+void midi_out_ble_retry(void);
+
+void midi_out_ble_stats(midi_out_stats_t *out);
+void midi_out_usb_stats(midi_out_stats_t *out);
+
+#endif
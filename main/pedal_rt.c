@@ -0,0 +1,119 @@
+#include "esp_log.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "pedal_logic.h"
+#include "pedal_status.h"
+#include "app_config.h"
+#include "boot_stage.h"
+#include "config_radio.h"
+#include "exp_input.h"
+#include "leds.h"
+#include "matrix_scan.h"
+#include "midi_out.h"
+#include "pedal_rt.h"
+#include "power.h"
+#include "rt_tasks.h"
+#include "status_stream.h"
+
+static const char *TAG = "pedal_rt";
+
+#define DEEP_SLEEP_FLUSH_MS  2000
+#define DEEP_SLEEP_LED_MS    20      // for the dark frame to go out
+
+static void publish_status(const pedal_logic_t *lg, uint16_t exp, uint16_t out)
+{
+    pedal_status_t st = {
+        .bank = lg->bank,
+        .sw = lg->state[lg->bank],
+        .bat_mv = EXP_INPUT_BATTERY_MV(exp_input_battery()),
+        .exp_raw = exp >> PEDAL_EXP_FRAC_BITS,
+        .exp_out = out >> 7,
+    };
+    status_stream_publish(&st);
+}
+
+// Seals where the loop left off into RTC memory and powers down; a press
+// boots again and carries on from there (boot_stage.h).
+static void deep_sleep(const pedal_logic_t *lg, uint16_t exp)
+{
+    esp_err_t err = app_config_flush(DEEP_SLEEP_FLUSH_MS);
+    if (err != ESP_OK) {
+        // Asleep, the last edits would only live in RTC memory; try again next time
+        ESP_LOGW(TAG, "Config not on flash yet, staying awake: %s", esp_err_to_name(err));
+        return;
+    }
+    ESP_LOGI(TAG, "Idle, going to deep sleep");
+    leds_update(lg->bank, 0, 0);
+    vTaskDelay(pdMS_TO_TICKS(DEEP_SLEEP_LED_MS));
+    const app_config_snap_t *snap = app_config_acquire();
+    boot_sleep_seal(&snap->cfg, lg, exp);
+    app_config_release();
+    matrix_scan_deep_sleep();
+    esp_deep_sleep_start();
+}
+
+static void pedal_rt_task(void *arg)
+{
+    (void)arg;
+    pedal_logic_t lg;
+    pedal_logic_init(&lg, NULL, midi_out_sink, NULL);
+    const pedal_wake_t *w = boot_wake_state();
+    if (w) pedal_wake_resume(w, &lg);
+    esp_err_t err = matrix_scan_start(xTaskGetCurrentTaskHandle());
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Matrix scan failed: %s", esp_err_to_name(err));
+        vTaskDelete(NULL);
+        return;
+    }
+    boot_mark(BOOT_SCAN);
+    err = exp_input_start();
+    if (err != ESP_OK) ESP_LOGE(TAG, "Expression input failed, switches only: %s", esp_err_to_name(err));
+
+    uint16_t out = 0;
+    for (;;) {
+        matrix_scan_wait();
+        int64_t now_us = esp_timer_get_time();
+        uint32_t now_ms = now_us / 1000;
+        const app_config_snap_t *snap = app_config_acquire();
+        lg.tbl = &snap->table;
+        int bank = app_config_bank_request();
+        if (bank >= 0) pedal_logic_set_bank(&lg, bank);
+
+        // Edge times are 32-bit microseconds; count back from now so they
+        // stay on the tick's millisecond clock when that wraps
+        bool edges = false;
+        pedal_scan_edge_t e;
+        while (matrix_scan_edge(&e)) {
+            edges = true;
+            midi_out_origin(e.us);
+            pedal_logic_edge(&lg, e.sw, e.down, now_ms - ((uint32_t)now_us - e.us) / 1000);
+        }
+        midi_out_origin(0);
+        pedal_logic_tick(&lg, now_ms);
+        config_radio_switches(matrix_scan_state(), now_ms);
+
+        const pedal_exp_t *exp = &snap->cfg.banks[lg.bank].exp;
+        uint16_t pos = exp_input_read();
+        if (exp_input_jack() == PEDAL_JACK_OK) {
+            out = pedal_table_exp(&snap->table, lg.bank, pos);
+            midi_out_exp(exp->ch, exp->cc, out);
+        }
+        midi_out_flush();
+        leds_update(lg.bank, lg.state[lg.bank] | matrix_scan_state(), snap->cfg.brightness);
+        publish_status(&lg, pos, out);
+        uint32_t deep_ms = snap->cfg.ds_en ? snap->cfg.ds_min * 60000u : 0;
+        app_config_release();
+        if (power_scan_loop(matrix_scan_state(), edges, pos, now_ms, deep_ms)) deep_sleep(&lg, pos);
+    }
+}
+
+esp_err_t pedal_rt_start(void)
+{
+    if (rt_task_create(pedal_rt_task, NULL, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Cannot start the scan loop");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
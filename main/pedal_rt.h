@@ -0,0 +1,22 @@
+#ifndef PEDAL_RT_H
+#define PEDAL_RT_H
+
+#include "esp_err.h"
+
+/*
+ * The scan loop: the pedal_rt task on the real-time core (rt_tasks.h). It
+ * starts the matrix scan and the expression input itself, so their
+ * interrupts land on its core, and after a deep-sleep wake carries on with
+ * the bank and toggles it slept with (boot_stage.h). It then sleeps in
+ * matrix_scan_wait() and, for every edge and once a millisecond, runs one
+ * iteration from the live config snapshot: bank requests, edges and
+ * long-press timing through pedal_logic, the WiFi combo, the expression
+ * value, one MIDI flush, the LEDs and the live status. Once idle it lets
+ * power_scan_loop() stop the scan (power.h), and once deep sleep is due it
+ * seals its state (boot_sleep_seal()) and powers down.
+ *
+ * boot_stage_run() starts it once the config is live.
+ */
+esp_err_t pedal_rt_start(void);
+
+#endif
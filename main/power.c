@@ -0,0 +1,165 @@
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include "pedal_power.h"
+#include "ble_midi.h"
+#include "exp_input.h"
+#include "matrix_scan.h"
+#include "power.h"
+#include "rt_tasks.h"
+
+static const char *TAG = "power";
+
+#define PM_MIN_MHZ  40          // XTAL: the PLL may stop while nothing needs it
+
+static esp_pm_lock_handle_t s_usb_lock, s_wifi_lock;
+static volatile bool s_usb, s_wifi;
+
+// Scan loop only; the bench reads the counters
+static pedal_idle_t s_idle, s_deep;
+static volatile bool s_asleep;
+static volatile uint32_t s_asleep_ms, s_asleep_since_ms;
+// Wakes the scan loop out of light sleep when deep sleep is due
+static esp_timer_handle_t s_deep_timer;
+static TaskHandle_t s_loop;
+
+static void on_deep_timer(void *arg)
+{
+    (void)arg;
+    xTaskNotifyGive(s_loop);
+}
+
+bool power_scan_loop(uint8_t held, bool edges, uint16_t exp, uint32_t now_ms, uint32_t deep_ms)
+{
+    s_deep.idle_ms = deep_ms;
+    bool deep = pedal_idle_step(&s_deep, now_ms, held, edges, exp) && !s_usb && !s_wifi;
+    if (deep) s_deep.since_ms = now_ms;
+    if (s_asleep) {
+        // A column, the pedal or the deep-sleep timer woke us; matrix_scan_wait() restarted the scan
+        s_asleep_ms += now_ms - s_asleep_since_ms;
+        s_asleep = false;
+        esp_timer_stop(s_deep_timer);
+        exp_input_resume();
+        pedal_idle_init(&s_idle, CONFIG_PEDAL_IDLE_SLEEP_MS, now_ms, exp);
+        return deep;
+    }
+    if (deep) return true;
+    if (!pedal_idle_step(&s_idle, now_ms, held, edges, exp) || s_usb || s_wifi) return false;
+    matrix_scan_suspend();
+    exp_input_suspend();
+    s_asleep_since_ms = now_ms;
+    s_asleep = true;
+    if (deep_ms) {
+        s_loop = xTaskGetCurrentTaskHandle();
+        esp_timer_start_once(s_deep_timer, (uint64_t)(deep_ms - (now_ms - s_deep.since_ms)) * 1000);
+    }
+    return false;
+}
+
+static void hold(esp_pm_lock_handle_t lock, volatile bool *held, bool on)
+{
+    if (on == *held) return;
+    *held = on;
+    if (!lock) return;
+    if (on) esp_pm_lock_acquire(lock);
+    else esp_pm_lock_release(lock);
+}
+
+void power_usb(bool mounted)
+{
+    // The host keeps polling; light sleep would drop us off the bus
+    hold(s_usb_lock, &s_usb, mounted);
+}
+
+void power_wifi(bool up)
+{
+    hold(s_wifi_lock, &s_wifi, up);
+}
+
+#if CONFIG_PEDAL_POWER_BENCH
+static uint32_t asleep_ms(uint32_t now_ms)
+{
+    uint32_t ms = s_asleep_ms;
+    return s_asleep ? ms + (now_ms - s_asleep_since_ms) : ms;
+}
+
+// Samples the state once a second; the log line covers the last window and
+// the whole run. Waking for it costs a little of the sleep it measures.
+static void bench_task(void *arg)
+{
+    (void)arg;
+    pedal_power_t total, window;
+    pedal_power_init(&total);
+    pedal_power_init(&window);
+    uint32_t last = asleep_ms(esp_timer_get_time() / 1000), seconds = 0;
+    uint16_t battery0 = exp_input_battery();
+    TickType_t wake = xTaskGetTickCount();
+    ESP_LOGI(TAG, "Power bench started, logging every %d s", CONFIG_PEDAL_POWER_BENCH_S);
+    for (;;) {
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(1000));
+        uint32_t now = asleep_ms(esp_timer_get_time() / 1000);
+        pedal_ble_link_t links[BLE_MIDI_MAX_LINKS];
+        uint8_t loads = (ble_midi_links(links, BLE_MIDI_MAX_LINKS) ? 1u << PEDAL_POWER_BLE : 0) |
+                        (s_wifi ? 1u << PEDAL_POWER_WIFI : 0) | (s_usb ? 1u << PEDAL_POWER_USB : 0);
+        pedal_power_add(&total, 1000, now - last, loads);
+        pedal_power_add(&window, 1000, now - last, loads);
+        last = now;
+        if (++seconds % CONFIG_PEDAL_POWER_BENCH_S) continue;
+
+        uint32_t ua = pedal_power_ua(&total);
+        ESP_LOGI(TAG,
+                 "Power bench %lu s: %lu%% asleep, BLE %lu%%, WiFi %lu%%, USB %lu%%: ~%.2f mA now, ~%.2f mA "
+                 "average (%lu h on %d mAh), battery %u (%+d since start)",
+                 (unsigned long)seconds, (unsigned long)pedal_power_asleep_pct(&window),
+                 (unsigned long)pedal_power_load_pct(&window, PEDAL_POWER_BLE),
+                 (unsigned long)pedal_power_load_pct(&window, PEDAL_POWER_WIFI),
+                 (unsigned long)pedal_power_load_pct(&window, PEDAL_POWER_USB), pedal_power_ua(&window) / 1000.0,
+                 ua / 1000.0, (unsigned long)(ua ? CONFIG_PEDAL_BATTERY_MAH * 1000ull / ua : 0),
+                 CONFIG_PEDAL_BATTERY_MAH, exp_input_battery(), exp_input_battery() - battery0);
+        pedal_power_init(&window);
+#if CONFIG_PM_PROFILING
+        esp_pm_dump_locks(stdout);
+#endif
+    }
+}
+#endif
+
+esp_err_t power_start(void)
+{
+    pedal_idle_init(&s_idle, CONFIG_PEDAL_IDLE_SLEEP_MS, 0, 0);
+    pedal_idle_init(&s_deep, 0, 0, 0);
+    esp_timer_create_args_t deep = { .callback = on_deep_timer, .name = "deep_sleep" };
+    esp_err_t err = esp_timer_create(&deep, &s_deep_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Deep-sleep timer failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    esp_pm_config_t pm = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = PM_MIN_MHZ,
+        .light_sleep_enable = true,
+    };
+    err = esp_pm_configure(&pm);
+    if (err == ESP_OK) err = esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "usb", &s_usb_lock);
+    if (err == ESP_OK) err = esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "wifi", &s_wifi_lock);
+    if (err == ESP_ERR_NOT_SUPPORTED) {
+        // The scan still stops when idle, the chip just does not sleep
+        ESP_LOGW(TAG, "CONFIG_PM_ENABLE is off: no frequency scaling or light sleep");
+    } else if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Power management failed: %s", esp_err_to_name(err));
+        return err;
+    } else {
+        ESP_LOGI(TAG, "CPU %d-%d MHz, light sleep after %d ms idle", PM_MIN_MHZ, CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+                 CONFIG_PEDAL_IDLE_SLEEP_MS);
+    }
+#if CONFIG_PEDAL_POWER_BENCH
+    if (xTaskCreatePinnedToCore(bench_task, "power_bench", 3072, NULL, RT_PRIO_WRITER, NULL, RT_SYS_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Cannot start power bench");
+        return ESP_ERR_NO_MEM;
+    }
+#endif
+    return ESP_OK;
+}
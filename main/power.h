@@ -0,0 +1,46 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/*
+ * Battery life. Dynamic frequency scaling runs the CPU between the XTAL
+ * and its configured maximum, and the tickless idle task puts the chip in
+ * automatic light sleep whenever no task is ready and nobody holds a PM
+ * lock. Locks are held only by what is busy: the scan timer and the ADC
+ * DMA (their drivers), the WiFi soft AP and a mounted USB host (here).
+ *
+ * Once no switch was down, no edge came in and the expression pedal stayed
+ * put for CONFIG_PEDAL_IDLE_SLEEP_MS, the scan loop stops the matrix scan
+ * and the ADC stream (matrix_scan_suspend(), exp_input_suspend()). A press
+ * pulls its column low and wakes the chip; the scan restarts and reads it
+ * within one full scan, the same bound as while scanning, plus the light
+ * sleep exit. The scan never stops while USB is mounted or WiFi is up.
+ * /api/metrics reports the column-to-scan time as latency_us.resume.
+ *
+ * With deep sleep on (config ds_en, ds_min minutes) the same inactivity,
+ * light sleep included, ends in deep sleep: a timer wakes the loop at the
+ * deadline, and the loop seals its state and powers down (boot_stage.h).
+ *
+ * boot_stage_run() calls power_start() before creating pedal_rt.
+ * CONFIG_PEDAL_POWER_BENCH adds a task that logs the estimated current
+ * draw (pedal_power.h) and the battery reading over time.
+ */
+esp_err_t power_start(void);
+
+/**
+ * Scan loop, every iteration, after releasing the config snapshot.
+ * deep_ms: idle time before deep sleep, 0 for never. Returns true once that
+ * is up, and then counts it again from now.
+ */
+bool power_scan_loop(uint8_t held, bool edges, uint16_t exp, uint32_t now_ms, uint32_t deep_ms);
+
+// USB transmit task: the host mounted or dropped us
+void power_usb(bool mounted);
+
+// config_radio task: WiFi and httpd came up or went down
+void power_wifi(bool up);
+
+#endif
@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <string.h>
+#include "cJSON.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "pedal_preset.h"
+#include "app_config.h"
+#include "web_api.h"
+#include "preset_store.h"
+
+static const char *TAG = "preset_store";
+
+#define PRESET_PARTITION_SUBTYPE 0x40
+
+static const esp_partition_t *s_part;
+static pedal_flash_t s_flash;
+static pedal_preset_store_t s_store;
+static bool s_ready;
+
+static int part_read(void *ctx, uint32_t addr, void *buf, size_t len)
+{
+    return esp_partition_read(ctx, addr, buf, len) == ESP_OK ? 0 : -1;
+}
+
+static int part_write(void *ctx, uint32_t addr, const void *buf, size_t len)
+{
+    return esp_partition_write(ctx, addr, buf, len) == ESP_OK ? 0 : -1;
+}
+
+static int part_erase(void *ctx, uint32_t addr)
+{
+    return esp_partition_erase_range(ctx, addr, PEDAL_PRESET_SECTOR) == ESP_OK ? 0 : -1;
+}
+
+esp_err_t preset_store_init(void)
+{
+    s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, PRESET_PARTITION_SUBTYPE, "presets");
+    if (!s_part) {
+        ESP_LOGE(TAG, "No \"presets\" partition, check partitions.csv");
+        return ESP_ERR_NOT_FOUND;
+    }
+    s_flash = (pedal_flash_t){ part_read, part_write, part_erase, (void *)s_part, s_part->size };
+    int err = pedal_preset_mount(&s_store, &s_flash);
+    if (err != PEDAL_PRESET_OK) {
+        ESP_LOGE(TAG, "Mount failed (%d)", err);
+        return ESP_FAIL;
+    }
+    s_ready = true;
+
+    int count = 0;
+    for (int id = 0; id < PEDAL_PRESET_MAX; id++) count += pedal_preset_name(&s_store, id) != NULL;
+    ESP_LOGI(TAG, "%d presets, %u bytes live in %u KB", count, (unsigned)s_store.live, (unsigned)(s_part->size / 1024));
+    return ESP_OK;
+}
+
+static esp_err_t send_unavailable(httpd_req_t *req)
+{
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Preset store unavailable");
+}
+
+static esp_err_t send_preset_error(httpd_req_t *req, int err)
+{
+    if (err == PEDAL_PRESET_ERR_ID) return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No such preset");
+    if (err == PEDAL_PRESET_ERR_FULL) return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Preset store full");
+    return httpd_resp_send_500(req);
+}
+
+// Appends s to the JSON output as a string literal
+static char *put_json_str(char *p, const char *s)
+{
+    *p++ = '"';
+    for (; *s; s++) {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\') {
+            *p++ = '\\';
+            *p++ = c;
+        } else if (c < 0x20) {
+            p += sprintf(p, "\\u%04x", c);
+        } else {
+            *p++ = c;
+        }
+    }
+    *p++ = '"';
+    return p;
+}
+
+// GET /api/presets: every slot, served from the RAM index without touching flash
+static esp_err_t presets_get_handler(httpd_req_t *req)
+{
+    // Worst-case entry: every name character escaped as \u00XX
+    static char buf[1024];
+    const size_t entry_max = 48 + 6 * PEDAL_PRESET_NAME_MAX;
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    char *p = buf;
+    *p++ = '[';
+    for (int id = 0; id < PEDAL_PRESET_MAX; id++) {
+        const char *name = s_ready ? pedal_preset_name(&s_store, id) : NULL;
+        if (id) *p++ = ',';
+        p += sprintf(p, "{\"id\":%d,\"active\":%s,\"name\":", id, name ? "true" : "false");
+        p = put_json_str(p, name ? name : "Empty");
+        *p++ = '}';
+        if (buf + sizeof(buf) - p < (ptrdiff_t)entry_max) {
+            if (httpd_resp_send_chunk(req, buf, p - buf) != ESP_OK) return ESP_FAIL;
+            p = buf;
+        }
+    }
+    *p++ = ']';
+    if (httpd_resp_send_chunk(req, buf, p - buf) != ESP_OK) return ESP_FAIL;
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+// POST /api/preset/save: {"id": n, "name": "..."}, snapshots the live config
+static esp_err_t preset_save_handler(httpd_req_t *req)
+{
+    static uint8_t body[128];
+    if (!s_ready) return send_unavailable(req);
+    int len = web_api_recv_body(req, body, sizeof(body) - 1);
+    if (len < 0) return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad body");
+    body[len] = '\0';
+
+    cJSON *root = cJSON_Parse((const char *)body);
+    cJSON *id = cJSON_GetObjectItem(root, "id");
+    cJSON *name = cJSON_GetObjectItem(root, "name");
+    int err = PEDAL_PRESET_ERR_ID;
+    if (cJSON_IsNumber(id) && cJSON_IsString(name)) {
+        static pedal_config_t cfg;
+        app_config_copy(&cfg);
+        err = pedal_preset_save(&s_store, id->valueint, name->valuestring, &cfg);
+    }
+    cJSON_Delete(root);
+
+    if (err != PEDAL_PRESET_OK) {
+        ESP_LOGW(TAG, "Save failed (%d)", err);
+        return send_preset_error(req, err);
+    }
+    return httpd_resp_sendstr(req, "OK");
+}
+
+// POST /api/preset/load: the preset becomes the live (and persisted) config
+static esp_err_t preset_load_handler(httpd_req_t *req)
+{
+    static pedal_config_t cfg;
+    if (!s_ready) return send_unavailable(req);
+    int id = web_api_recv_index(req, PEDAL_PRESET_MAX);
+    if (id < 0) return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad preset id");
+
+    int err = pedal_preset_load(&s_store, id, &cfg);
+    if (err != PEDAL_PRESET_OK) return send_preset_error(req, err);
+    if (app_config_publish(&cfg) != ESP_OK) return httpd_resp_send_500(req);
+
+    return web_api_send_commit(req, app_config_commit());
+}
+
+// POST /api/preset/delete
+static esp_err_t preset_delete_handler(httpd_req_t *req)
+{
+    if (!s_ready) return send_unavailable(req);
+    int id = web_api_recv_index(req, PEDAL_PRESET_MAX);
+    if (id < 0) return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad preset id");
+
+    int err = pedal_preset_delete(&s_store, id);
+    if (err != PEDAL_PRESET_OK) return send_preset_error(req, err);
+    return httpd_resp_sendstr(req, "OK");
+}
+
+esp_err_t preset_store_register(httpd_handle_t server)
+{
+    static const httpd_uri_t uris[] = {
+        { .uri = "/api/presets", .method = HTTP_GET, .handler = presets_get_handler },
+        { .uri = "/api/preset/save", .method = HTTP_POST, .handler = preset_save_handler },
+        { .uri = "/api/preset/load", .method = HTTP_POST, .handler = preset_load_handler },
+        { .uri = "/api/preset/delete", .method = HTTP_POST, .handler = preset_delete_handler },
+    };
+    for (size_t i = 0; i < sizeof(uris) / sizeof(uris[0]); i++) {
+        esp_err_t err = httpd_register_uri_handler(server, &uris[i]);
+        if (err != ESP_OK) return err;
+    }
+    return ESP_OK;
+}
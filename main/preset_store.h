@@ -0,0 +1,15 @@
+#ifndef PRESET_STORE_H
+#define PRESET_STORE_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+// Mounts the "presets" partition and builds the in-RAM preset index. Part of
+// the deferred BOOT_WIFI stage (boot_stage.c), before the handlers exist;
+// until it succeeds they answer "Preset store unavailable".
+esp_err_t preset_store_init(void);
+
+// Registers /api/presets, /api/preset/save, /api/preset/load and /api/preset/delete.
+esp_err_t preset_store_register(httpd_handle_t server);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef RT_TASKS_H
+#define RT_TASKS_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+/*
+ * Where every task runs. Core 1 belongs to the real-time pipeline and runs
+ * nothing else of ours; everything that can block on a radio, a socket or
+ * flash stays on core 0. The two sides share no lock: data crosses in
+ * lock-free single-producer single-consumer rings (pedal_usb_ring, the
+ * BLE packet ring) and newest-value exchanges (pedal_latest: BLE link
+ * parameters, live status). The only cross-core calls left are the task
+ * notifications that wake a consumer.
+ *
+ *   core 1  scan timer ISR    gptimer, allocated by matrix_scan_start()
+ *           column GPIO ISR   the same, wakes pedal_rt while the scan is idle
+ *           ADC DMA ISR       allocated by exp_input_start()
+ *           pedal_rt     24   logic, expression, MIDI encoding and flush
+ *           exp_input    23   CIC + one-euro filter, once per ADC frame
+ *
+ *   core 0  BT controller / host, WiFi, lwIP (18), esp_timer   sdkconfig
+ *           usb_midi_tx  10   drains the USB ring into TinyUSB
+ *           ble_midi_tx  10   sends packets from the BLE ring
+ *           TinyUSB       5   tinyusb_config_t.task.xCoreID, app_main.c
+ *           httpd         5   httpd_config_t.core_id = RT_SYS_CORE
+ *           boot          4   deferred BLE / WiFi start, then exits
+ *           config_radio  4   WiFi + httpd on demand, idle shutdown
+ *           leds          3   frame render + RMT DMA, only on change
+ *           status_stream 2   live status to WebSocket clients
+ *           cfg_writer    1   NVS commits
+ *           power_bench   1   CONFIG_PEDAL_POWER_BENCH only
+ *
+ * Interrupts are allocated on the core that installs them, so
+ * pedal_rt_start() creates pedal_rt with rt_task_create() and the task calls
+ * matrix_scan_start() and exp_input_start() itself. Both ISRs are IRAM-safe; a flash
+ * write still stalls pedal_rt for its duration (edges keep their sample
+ * time in the scan ring), which the config writer limits by coalescing.
+ * The transmit tasks sit above httpd, so a busy web UI cannot delay MIDI;
+ * WiFi itself is off unless asked for (config_radio.h).
+ */
+
+#if CONFIG_FREERTOS_UNICORE
+#define RT_CORE            0
+#else
+#define RT_CORE            1
+#endif
+#define RT_SYS_CORE        0
+
+#define RT_PRIO_LOGIC      (configMAX_PRIORITIES - 1)
+#define RT_PRIO_EXP        (configMAX_PRIORITIES - 2)
+#define RT_PRIO_TX         10
+#define RT_PRIO_BOOT       4
+#define RT_PRIO_LED        3
+#define RT_PRIO_STATUS     2
+#define RT_PRIO_WRITER     1
+
+#define RT_LOGIC_STACK     4096
+
+// Creates the pedal_rt task (the scan loop, pedal_rt.c) on RT_CORE.
+static inline BaseType_t rt_task_create(TaskFunction_t loop, void *arg, TaskHandle_t *out)
+{
+    return xTaskCreatePinnedToCore(loop, "pedal_rt", RT_LOGIC_STACK, arg, RT_PRIO_LOGIC, out, RT_CORE);
+}
+
+#endif
@@ -0,0 +1,170 @@
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "pedal_spsc.h"
+#include "app_config.h"
+#include "ble_midi.h"
+#include "exp_input.h"
+#include "midi_out.h"
+#include "rt_tasks.h"
+#include "status_stream.h"
+
+static const char *TAG = "status_stream";
+
+#define STATUS_PERIOD_MS   20
+#define STATUS_MAX_FDS     8
+
+static httpd_handle_t s_server;
+static TaskHandle_t s_task;
+// Published by the real-time core; s_lock only orders the two readers on core 0
+static pedal_status_t s_slot[PEDAL_LATEST_SLOTS];
+static pedal_latest_t s_latest = PEDAL_LATEST_INITIALIZER;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static pedal_status_stream_t s_stream;
+
+// One frame in flight at a time, so the payload can live in a static buffer
+static char s_frame[512];
+static size_t s_frame_len;
+static volatile bool s_sending;
+static volatile bool s_new_client;
+static volatile int s_clients;
+
+void status_stream_publish(const pedal_status_t *status)
+{
+    s_slot[pedal_latest_back(&s_latest)] = *status;
+    pedal_latest_publish(&s_latest);
+}
+
+static void snapshot(pedal_status_t *out)
+{
+    taskENTER_CRITICAL(&s_lock);
+    pedal_latest_take(&s_latest);
+    *out = s_slot[pedal_latest_front(&s_latest)];
+    taskEXIT_CRITICAL(&s_lock);
+    out->saved = app_config_saved();
+    midi_out_stats_t ble;
+    midi_out_ble_stats(&ble);
+    out->ble_msgs = ble.msgs;
+    out->ble_pkts = ble.packets;
+    out->exp_ble_hz = ble.exp_hz;
+    midi_out_stats_t usb;
+    midi_out_usb_stats(&usb);
+    out->exp_usb_hz = usb.exp_hz;
+    out->jack = exp_input_jack();
+    memset(out->ble, 0, sizeof(out->ble));
+    out->ble_links = ble_midi_links(out->ble, PEDAL_STATUS_BLE_LINKS);
+}
+
+// Runs in the httpd task via httpd_queue_work, arg is that server
+static void broadcast_work(void *arg)
+{
+    httpd_handle_t server = arg;
+    int fds[STATUS_MAX_FDS];
+    size_t n = STATUS_MAX_FDS;
+    int clients = 0;
+    httpd_ws_frame_t frame = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)s_frame,
+        .len = s_frame_len,
+    };
+    if (httpd_get_client_list(server, &n, fds) == ESP_OK) {
+        for (size_t i = 0; i < n; i++) {
+            if (httpd_ws_get_fd_info(server, fds[i]) != HTTPD_WS_CLIENT_WEBSOCKET) continue;
+            if (httpd_ws_send_frame_async(server, fds[i], &frame) == ESP_OK) clients++;
+        }
+    }
+    s_clients = clients;
+    s_sending = false;
+}
+
+static void status_task(void *arg)
+{
+    TickType_t last = xTaskGetTickCount();
+    for (;;) {
+        // No periodic wake-up while WiFi is off: status_stream_start() notifies
+        while (!s_server) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            last = xTaskGetTickCount();
+        }
+        vTaskDelayUntil(&last, pdMS_TO_TICKS(STATUS_PERIOD_MS));
+        httpd_handle_t server = s_server;
+        if (s_sending || !server) continue;
+        if (s_new_client) {
+            s_new_client = false;
+            s_clients++;
+            pedal_status_stream_reset(&s_stream);
+        }
+        if (!s_clients) continue;
+
+        pedal_status_t cur;
+        snapshot(&cur);
+        size_t len = pedal_status_delta(&s_stream, &cur, esp_timer_get_time() / 1000, s_frame, sizeof(s_frame));
+        if (!len) continue;
+
+        s_frame_len = len;
+        s_sending = true;
+        if (httpd_queue_work(server, broadcast_work, server) != ESP_OK) s_sending = false;
+    }
+}
+
+// GET /api/status: one-off snapshot, kept for tools and as the UI fallback
+static esp_err_t status_get_handler(httpd_req_t *req)
+{
+    char buf[512];
+    pedal_status_t cur;
+    snapshot(&cur);
+    size_t len = pedal_status_json(&cur, buf, sizeof(buf));
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_send(req, buf, len);
+}
+
+// /api/ws: push-only; the next tick sends the new client a full snapshot
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        s_new_client = true;
+        return ESP_OK;
+    }
+    uint8_t buf[16];
+    httpd_ws_frame_t frame = { .payload = buf };
+    esp_err_t err = httpd_ws_recv_frame(req, &frame, 0);
+    if (err == ESP_OK && frame.len <= sizeof(buf)) err = httpd_ws_recv_frame(req, &frame, sizeof(buf));
+    return err;
+}
+
+esp_err_t status_stream_start(httpd_handle_t server)
+{
+    static const httpd_uri_t uris[] = {
+        { .uri = "/api/status", .method = HTTP_GET, .handler = status_get_handler },
+        { .uri = "/api/ws", .method = HTTP_GET, .handler = ws_handler, .is_websocket = true },
+    };
+    s_server = server;
+    for (size_t i = 0; i < sizeof(uris) / sizeof(uris[0]); i++) {
+        esp_err_t err = httpd_register_uri_handler(server, &uris[i]);
+        if (err != ESP_OK) return err;
+    }
+    // The task outlives the server when config_radio takes WiFi down
+    if (s_task) {
+        xTaskNotifyGive(s_task);
+        return ESP_OK;
+    }
+    if (xTaskCreatePinnedToCore(status_task, "status_stream", 3072, NULL, RT_PRIO_STATUS, &s_task, RT_SYS_CORE) !=
+        pdPASS) {
+        ESP_LOGE(TAG, "Cannot start status task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void status_stream_stop(void)
+{
+    // A broadcast still queued is dropped with the server
+    s_server = NULL;
+    s_clients = 0;
+    s_new_client = false;
+    s_sending = false;
+}
@@ -0,0 +1,18 @@
+#ifndef STATUS_STREAM_H
+#define STATUS_STREAM_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include "pedal_status.h"
+
+// Registers /api/status (snapshot) and /api/ws (push stream) and starts the
+// low-priority task that pushes changes to connected clients.
+esp_err_t status_stream_start(httpd_handle_t server);
+
+// Before the server is stopped; status_stream_start() picks up a new one.
+void status_stream_stop(void);
+
+// Latest live values; lock-free, from the scan loop only (one producer).
+void status_stream_publish(const pedal_status_t *status);
+
+#endif
@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+"""Minify and gzip the web UI for embedding in the firmware.
+
+    pack.py <index.html> <out.gz>
+
+The minifier is deliberately conservative: it drops comments, indentation
+and blank lines but keeps line breaks inside <script> so automatic
+semicolon insertion behaves exactly as in the source. Output is
+byte-for-byte reproducible (no gzip timestamp), so the ETag only changes
+when the page does.
+"""
+import gzip
+import re
+import sys
+
+
+def minify_css(css):
+    css = re.sub(r'/\*.*?\*/', '', css, flags=re.S)
+    css = re.sub(r'\s+', ' ', css)
+    css = re.sub(r'\s*([{};,>])\s*', r'\1', css)
+    css = re.sub(r':\s+', ':', css)  # not before ':', "a :hover" is a descendant selector
+    return css.replace(';}', '}').strip()
+
+
+def minify_js(js):
+    out = []
+    for line in js.split('\n'):
+        line = line.strip()
+        if line and not line.startswith('//'):
+            out.append(line)
+    return '\n'.join(out)
+
+
+def minify_html(html):
+    html = re.sub(r'<!--.*?-->', '', html, flags=re.S)
+    return '\n'.join(l.strip() for l in html.split('\n') if l.strip())
+
+
+def minify(src):
+    parts = re.split(r'(<style>.*?</style>|<script>.*?</script>)', src, flags=re.S)
+    out = []
+    for p in parts:
+        if p.startswith('<style>'):
+            out.append('<style>' + minify_css(p[7:-8]) + '</style>')
+        elif p.startswith('<script>'):
+            out.append('<script>' + minify_js(p[8:-9]) + '</script>')
+        else:
+            out.append(minify_html(p))
+    return '\n'.join(p for p in out if p)
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__.strip().split('\n\n')[1])
+    with open(sys.argv[1], encoding='utf-8') as f:
+        src = f.read()
+    mini = minify(src).encode('utf-8')
+    packed = gzip.compress(mini, compresslevel=9, mtime=0)
+    with open(sys.argv[2], 'wb') as f:
+        f.write(packed)
+    print('web UI: %d -> %d minified -> %d gzipped' % (len(src.encode('utf-8')), len(mini), len(packed)))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,201 @@
+#!/usr/bin/env node
+// Headless render benchmark for the web UI.
+//
+//   node render_bench.js <index.html> [baseline.html] [-n iterations]
+//
+// Runs the page script against a small recording DOM with a 4x8 config and
+// times the operations that used to rebuild every switch card: bank
+// switches, checkbox edits and action type changes. Alongside wall time it
+// counts what a browser would have to redo: elements created from HTML,
+// HTML bytes parsed and DOM property writes. Compare against an older page
+// with e.g. `git show HEAD~1:main/web/index.html > /tmp/old.html`.
+'use strict';
+const fs = require('fs');
+const vm = require('vm');
+
+const VOID = new Set(['input', 'br', 'meta', 'img', 'hr', 'link']);
+
+function makeDom(stats) {
+    const ids = new Map();
+
+    let parsing = false;
+    function record(target) {
+        return new Proxy(target, {
+            set(o, k, v) { if(!parsing && o[k] !== v) stats.writes++; o[k] = v; return true; }
+        });
+    }
+
+    class Element {
+        constructor(tag, attrs) {
+            stats.created++;
+            this.tagName = tag.toUpperCase();
+            this.attrs = attrs;
+            this.children = [];
+            this.text = '';
+            this.style = record({});
+            const cls = new Set((attrs.class || '').split(/\s+/).filter(Boolean));
+            this.classList = {
+                contains: c => cls.has(c),
+                toggle: (c, on) => {
+                    if(on === undefined) on = !cls.has(c);
+                    if(on !== cls.has(c)) { if(!parsing) stats.writes++; on ? cls.add(c) : cls.delete(c); }
+                    return on;
+                },
+                add: c => this.classList.toggle(c, true),
+                remove: c => this.classList.toggle(c, false),
+            };
+            this.props = { value: attrs.value || '', checked: 'checked' in attrs, disabled: 'disabled' in attrs, open: 'open' in attrs };
+            const el = record(this);
+            if(attrs.id) ids.set(attrs.id, el);
+            return el;
+        }
+        getAttribute(k) { return k in this.attrs ? this.attrs[k] : null; }
+        addEventListener() {}
+        get value() { return this.props.value; }
+        set value(v) { this.props.value = String(v); }
+        get checked() { return this.props.checked; }
+        set checked(v) { this.props.checked = !!v; }
+        get disabled() { return this.props.disabled; }
+        set disabled(v) { this.props.disabled = !!v; }
+        get open() { return this.props.open; }
+        set open(v) { this.props.open = !!v; }
+        get innerText() { return this.text; }
+        set innerText(v) { this.text = String(v); }
+        get textContent() { return this.text; }
+        set textContent(v) { this.text = String(v); }
+        set innerHTML(html) {
+            stats.parsed += html.length;
+            parsing = true;
+            this.children = parse(html);
+            parsing = false;
+        }
+        querySelectorAll(sel) {
+            const m = /^\[([\w-]+)\]$/.exec(sel);
+            if(!m) throw new Error('unsupported selector ' + sel);
+            const out = [];
+            const walk = el => el.children.forEach(ch => { if(m[1] in ch.attrs) out.push(ch); walk(ch); });
+            walk(this);
+            return out;
+        }
+    }
+
+    // Just enough HTML for the page: tags, quoted/bare attributes, text.
+    function parse(html) {
+        const root = { children: [] };
+        const stack = [root];
+        const re = /<!--[\s\S]*?-->|<\/(\w+)\s*>|<(\w+)((?:\s+[\w-]+(?:\s*=\s*(?:'[^']*'|"[^"]*"|[^\s>]+))?)*)\s*\/?>|([^<]+)/g;
+        let m;
+        while((m = re.exec(html))) {
+            if(m[1]) { if(stack.length > 1) stack.pop(); continue; }
+            if(m[4]) { stack[stack.length - 1].text += m[4]; continue; }
+            if(!m[2]) continue;
+            const tag = m[2].toLowerCase();
+            if(tag === 'script' || tag === 'style') {
+                re.lastIndex = html.indexOf('</' + tag, re.lastIndex);
+                continue;
+            }
+            const attrs = {};
+            const ar = /([\w-]+)(?:\s*=\s*('[^']*'|"[^"]*"|[^\s>]+))?/g;
+            let a;
+            while((a = ar.exec(m[3]))) attrs[a[1]] = a[2] ? a[2].replace(/^['"]|['"]$/g, '') : '';
+            const el = new Element(tag, attrs);
+            stack[stack.length - 1].children.push(el);
+            if(!VOID.has(tag)) stack.push(el);
+        }
+        return root.children;
+    }
+
+    const body = new Element('body', {});
+    return {
+        body,
+        getElementById: id => ids.get(id) || null,
+        get activeElement() { return body; },
+        load: html => { body.innerHTML = html; },
+    };
+}
+
+function makeConfig() {
+    const types = [144, 176, 192, 128, 176, 0, 251, 252];
+    const d = { brightness: 127, ds_en: true, ds_min: 10, banks: [] };
+    for(let b=0; b<4; b++) {
+        const bank = { exp: { ch: b, cc: 11, crv: 0, min: 0, max: 4095 }, switches: [] };
+        for(let i=0; i<8; i++) {
+            const t = types[(i + b) % 8];
+            bank.switches.push({
+                p: [t, b, 10 * i], lp: [i & 1 ? 176 : 0, 0, i], l: [i & 2 ? 128 : 0, 0, i],
+                pe: i < 4 ? 0x0F : 0, lpe: 0, le: 0, pm: 1 << i, lpm: 0, lm: 0, incl: 1 << b,
+                tog: !!(i & 1), edge: i & 4 ? 1 : 0, lp_en: !!(i & 1),
+            });
+        }
+        d.banks.push(bank);
+    }
+    return d;
+}
+
+const BENCH = `
+;(function() {
+    fullData = decodeConfig(encodeConfig(__makeConfig()));
+    const out = {};
+    const op = (name, n, fn) => {
+        const s0 = Object.assign({}, __stats);
+        const t0 = performance.now();
+        for(let k=0; k<n; k++) fn(k);
+        const t = performance.now() - t0;
+        out[name] = { us: 1000 * t / n, created: (__stats.created - s0.created) / n,
+                      parsed: (__stats.parsed - s0.parsed) / n, writes: (__stats.writes - s0.writes) / n };
+    };
+    op('first render', 1, () => render());
+    op('bank switch', __n, k => { curBank = (k + 1) % 4; render(); });
+    op('toggle edit', __n, k => { const i = k % 8; updBool(i, 'tog', !fullData.banks[curBank].switches[i].tog); });
+    op('type change', __n, k => { const i = k % 8; upd(i, 'p', 0, ((k >> 3) & 1) ? 176 : 144); });
+    return out;
+})()`;
+
+function run(path, n) {
+    const html = fs.readFileSync(path, 'utf8');
+    const m = /<script>([\s\S]*)<\/script>/.exec(html);
+    if(!m) throw new Error(path + ': no <script>');
+    // Drop the auto-start; the bench installs the config itself
+    const script = m[1].replace(/\n\s*load\(\);\s*$/, '\n');
+
+    const stats = { created: 0, parsed: 0, writes: 0 };
+    const document = makeDom(stats);
+    document.load(html.slice(html.indexOf('<body'), m.index));
+    const ctx = {
+        document, performance, console, Map, Array, Object, String, Uint8Array, Uint32Array, DataView, ArrayBuffer,
+        Promise, Error, JSON, Math, parseInt, isNaN,
+        setTimeout: () => 0, clearTimeout: () => {}, setInterval: () => 0, clearInterval: () => {},
+        fetch: async () => ({ ok: true, json: async () => ({}) }),
+        localStorage: { getItem: () => null, setItem: () => {} },
+        location: { host: 'bench' },
+        alert: () => {}, confirm: () => true,
+        __makeConfig: makeConfig, __stats: stats, __n: n,
+    };
+    ctx.window = ctx;
+    vm.createContext(ctx);
+    return vm.runInContext(script + BENCH, ctx, { filename: path });
+}
+
+function main() {
+    const args = process.argv.slice(2);
+    let n = 2000;
+    const ni = args.indexOf('-n');
+    if(ni >= 0) { n = parseInt(args[ni + 1]); args.splice(ni, 2); }
+    if(args.length < 1 || args.length > 2 || !(n > 0)) {
+        console.error('usage: render_bench.js <index.html> [baseline.html] [-n iterations]');
+        process.exit(2);
+    }
+
+    const cur = run(args[0], n);
+    const base = args[1] ? run(args[1], n) : null;
+    const fmt = r => `${r.us.toFixed(1).padStart(8)} us ${r.created.toFixed(0).padStart(5)} el ` +
+                     `${r.parsed.toFixed(0).padStart(6)} B ${r.writes.toFixed(0).padStart(5)} wr`;
+    console.log(`render bench, 4x8 config, ${n} iterations` + (base ? ` (baseline: ${args[1]})` : ''));
+    for(const name of Object.keys(cur)) {
+        let line = `  ${name.padEnd(13)} ${fmt(cur[name])}`;
+        if(base) line += `   | baseline ${fmt(base[name])}   x${(base[name].us / cur[name].us).toFixed(1)}`;
+        console.log(line);
+    }
+}
+
+main();
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cJSON.h"
+#include "esp_log.h"
+#include "esp_wifi.h"
+#include "pedal_blob.h"
+#include "pedal_patch.h"
+#include "app_config.h"
+#include "web_api.h"
+
+static const char *TAG = "web_api";
+
+int web_api_recv_body(httpd_req_t *req, uint8_t *buf, size_t cap)
+{
+    if (req->content_len > cap) return -1;
+    size_t got = 0;
+    while (got < req->content_len) {
+        int r = httpd_req_recv(req, (char *)buf + got, req->content_len - got);
+        if (r == HTTPD_SOCK_ERR_TIMEOUT) continue;
+        if (r <= 0) return -1;
+        got += r;
+    }
+    return got;
+}
+
+int web_api_recv_index(httpd_req_t *req, int limit)
+{
+    uint8_t body[8];
+    int len = web_api_recv_body(req, body, sizeof(body) - 1);
+    if (len <= 0) return -1;
+    body[len] = '\0';
+    char *end;
+    long n = strtol((const char *)body, &end, 10);
+    return (end == (char *)body || n < 0 || n >= limit) ? -1 : (int)n;
+}
+
+esp_err_t web_api_send_commit(httpd_req_t *req, uint32_t gen)
+{
+    char buf[24];
+    snprintf(buf, sizeof(buf), "{\"gen\":%lu}", (unsigned long)gen);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, buf);
+}
+
+// Edits are made on a copy and published whole (app_config_publish); httpd
+// runs one handler at a time, so one copy serves them all
+static pedal_config_t s_edit;
+
+static esp_err_t send_publish_error(httpd_req_t *req)
+{
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    return httpd_resp_sendstr(req, "Busy, try again");
+}
+
+// GET /api/settings: the packed config blob (see pedal_blob.h)
+static esp_err_t settings_get_handler(httpd_req_t *req)
+{
+    static uint8_t blob[PEDAL_BLOB_SIZE];
+    app_config_copy(&s_edit);
+    size_t len = pedal_blob_pack(&s_edit, blob, sizeof(blob));
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_send(req, (const char *)blob, len);
+}
+
+// POST /api/save: a packed config blob, validated before it replaces the
+// live config. Answers before the flash write; see app_config_commit().
+static esp_err_t save_post_handler(httpd_req_t *req)
+{
+    static uint8_t blob[PEDAL_BLOB_SIZE + 64];
+
+    int len = web_api_recv_body(req, blob, sizeof(blob));
+    if (len < 0) return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad body");
+
+    app_config_copy(&s_edit);
+    if (pedal_blob_unpack(&s_edit, blob, len) != 0) {
+        ESP_LOGW(TAG, "Rejected config blob (%d bytes)", len);
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad config blob");
+    }
+    if (app_config_publish(&s_edit) != ESP_OK) return send_publish_error(req);
+
+    return web_api_send_commit(req, app_config_commit());
+}
+
+// POST /api/patch: a batch of field edits (see pedal_patch.h); only the
+// touched records are written to flash
+static esp_err_t patch_post_handler(httpd_req_t *req)
+{
+    static uint8_t ops[64 * PEDAL_PATCH_OP_SIZE];
+
+    int len = web_api_recv_body(req, ops, sizeof(ops));
+    if (len < 0) return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad body");
+
+    uint64_t dirty = 0;
+    app_config_copy(&s_edit);
+    int n = pedal_patch_apply(&s_edit, ops, len, &dirty);
+    if (n < 0) return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad patch");
+    if (app_config_publish(&s_edit) != ESP_OK) return send_publish_error(req);
+
+    ESP_LOGD(TAG, "Patched %d fields", n);
+    return web_api_send_commit(req, app_config_commit_records(dirty));
+}
+
+// POST /api/set_bank: bare bank index, as posted by the UI's bank buttons
+static esp_err_t set_bank_post_handler(httpd_req_t *req)
+{
+    int bank = web_api_recv_index(req, PEDAL_NUM_BANKS);
+    if (bank < 0) return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad bank");
+    app_config_select_bank(bank);
+    return httpd_resp_sendstr(req, "OK");
+}
+
+// GET /api/wifi: station credentials, kept out of the config blob
+static esp_err_t wifi_get_handler(httpd_req_t *req)
+{
+    wifi_config_t conf = { 0 };
+    esp_wifi_get_config(WIFI_IF_STA, &conf);
+
+    // The driver's fields are not NUL-terminated when full
+    char ssid[sizeof(conf.sta.ssid) + 1] = { 0 };
+    char pass[sizeof(conf.sta.password) + 1] = { 0 };
+    memcpy(ssid, conf.sta.ssid, sizeof(conf.sta.ssid));
+    memcpy(pass, conf.sta.password, sizeof(conf.sta.password));
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "ssid", ssid);
+    cJSON_AddStringToObject(root, "pass", pass);
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    httpd_resp_set_type(req, "application/json");
+    esp_err_t err = httpd_resp_sendstr(req, json);
+    cJSON_free(json);
+    return err;
+}
+
+esp_err_t web_api_register(httpd_handle_t server)
+{
+    static const httpd_uri_t uris[] = {
+        { .uri = "/api/settings", .method = HTTP_GET, .handler = settings_get_handler },
+        { .uri = "/api/save", .method = HTTP_POST, .handler = save_post_handler },
+        { .uri = "/api/patch", .method = HTTP_POST, .handler = patch_post_handler },
+        { .uri = "/api/set_bank", .method = HTTP_POST, .handler = set_bank_post_handler },
+        { .uri = "/api/wifi", .method = HTTP_GET, .handler = wifi_get_handler },
+    };
+    for (size_t i = 0; i < sizeof(uris) / sizeof(uris[0]); i++) {
+        esp_err_t err = httpd_register_uri_handler(server, &uris[i]);
+        if (err != ESP_OK) return err;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,20 @@
+#ifndef WEB_API_H
+#define WEB_API_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+// Registers the /api/* configuration endpoints on a running server.
+esp_err_t web_api_register(httpd_handle_t server);
+
+// Reads the whole request body into buf. Returns the length or -1.
+int web_api_recv_body(httpd_req_t *req, uint8_t *buf, size_t cap);
+
+// Body that is a bare decimal number below limit, as posted by the UI; -1 otherwise.
+int web_api_recv_index(httpd_req_t *req, int limit);
+
+// {"gen": n} for a queued config commit; "saved" in /api/status reaches n
+// once it is on flash.
+esp_err_t web_api_send_commit(httpd_req_t *req, uint32_t gen);
+
+#endif
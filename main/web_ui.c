@@ -0,0 +1,42 @@
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "pedal_blob.h"
+#include "web_ui.h"
+
+static const char *TAG = "web_ui";
+
+// Generated by web/pack.py and embedded by main/CMakeLists.txt
+extern const uint8_t index_html_gz_start[] asm("_binary_index_html_gz_start");
+extern const uint8_t index_html_gz_end[] asm("_binary_index_html_gz_end");
+
+static char s_etag[24];
+
+// GET /: the page is always sent gzipped; every browser accepts gzip and
+// storing a second, uncompressed copy would double the flash cost.
+// Revalidated on every load (the UI must match the running firmware's
+// config format after an OTA), which costs a bodiless 304 when unchanged.
+static esp_err_t index_get_handler(httpd_req_t *req)
+{
+    char inm[64];
+    httpd_resp_set_hdr(req, "ETag", s_etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", inm, sizeof(inm)) == ESP_OK && strstr(inm, s_etag)) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+    httpd_resp_set_type(req, "text/html");
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    return httpd_resp_send(req, (const char *)index_html_gz_start, index_html_gz_end - index_html_gz_start);
+}
+
+esp_err_t web_ui_register(httpd_handle_t server)
+{
+    size_t len = index_html_gz_end - index_html_gz_start;
+    snprintf(s_etag, sizeof(s_etag), "\"%08lx-%x\"",
+             (unsigned long)pedal_crc32(0, index_html_gz_start, len), (unsigned)len);
+    ESP_LOGI(TAG, "UI %u bytes gzipped, ETag %s", (unsigned)len, s_etag);
+
+    static const httpd_uri_t uri = { .uri = "/", .method = HTTP_GET, .handler = index_get_handler };
+    return httpd_register_uri_handler(server, &uri);
+}
@@ -0,0 +1,10 @@
+#ifndef WEB_UI_H
+#define WEB_UI_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+// Registers GET / serving the embedded, gzipped web UI (built from web/index.html).
+esp_err_t web_ui_register(httpd_handle_t server);
+
+#endif
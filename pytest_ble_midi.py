@@ -0,0 +1,22 @@
+# SPDX-License-Identifier: CC0-1.0
+import os
+
+import pytest
+from pytest_embedded import Dut
+from pytest_embedded_idf.utils import idf_parametrize
+
+ADV_LINE = r'Advertising (\d+) ms after boot, free heap (\d+), min (\d+)'
+
+
+@pytest.mark.generic
+@pytest.mark.parametrize('config', ['bluedroid', 'nimble'], indirect=True)
+@idf_parametrize('target', ['esp32s3'], indirect=['target'])
+def test_ble_midi_footprint(dut: Dut, config: str, record_property) -> None:
+    # Compare runs of both configs: time to advertising, heap left, app size
+    m = dut.expect(ADV_LINE, timeout=10)
+    adv_ms, heap, min_heap = (int(m.group(i)) for i in (1, 2, 3))
+    app_size = os.path.getsize(dut.app.bin_file)
+    print(f'BLE MIDI on {config}: advertising after {adv_ms} ms, free heap {heap} (min {min_heap}), '
+          f'app image {app_size} bytes')
+    for name, value in (('adv_ms', adv_ms), ('free_heap', heap), ('min_free_heap', min_heap), ('app_size', app_size)):
+        record_property(f'{config}_{name}', value)
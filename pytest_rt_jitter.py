@@ -0,0 +1,81 @@
+# SPDX-License-Identifier: CC0-1.0
+import json
+import os
+import threading
+import time
+import urllib.request
+
+import pytest
+from pytest_embedded import Dut
+from pytest_embedded_idf.utils import idf_parametrize
+
+# The test host has to be on the pedal's network (MidiBox_Config by default)
+PEDAL_URL = os.environ.get('PEDAL_URL', 'http://192.168.4.1')
+IDLE_SECONDS = 10
+LOAD_SECONDS = 20
+LOAD_CLIENTS = 6
+LOAD_PATHS = ('/', '/api/settings', '/api/status', '/api/metrics')
+
+
+def get(path: str, timeout: float = 5) -> bytes:
+    with urllib.request.urlopen(PEDAL_URL + path, timeout=timeout) as r:
+        return r.read()
+
+
+def metrics() -> dict:
+    return json.loads(get('/api/metrics'))
+
+
+def worst_bucket(before: dict, after: dict) -> int:
+    # Highest jitter bucket that gained samples: b covers [2^(b-1), 2^b) us
+    hist = [a - b for a, b in zip(after['scan']['jitter_us'], before['scan']['jitter_us'])]
+    return max((b for b, n in enumerate(hist) if n), default=0)
+
+
+def bound_us(bucket: int) -> int:
+    return 1 << bucket if bucket else 0
+
+
+@pytest.mark.generic
+@idf_parametrize('target', ['esp32s3'], indirect=['target'])
+def test_rt_scan_jitter_under_web_load(dut: Dut, record_property) -> None:
+    # Scan jitter and wake-up latency with the web UI idle and hammered.
+    # The real-time core (rt_tasks.h) should not notice httpd at all.
+    dut.expect(r'Scanning at (\d+) Hz', timeout=10)
+    try:
+        m0 = metrics()
+    except OSError as e:
+        pytest.skip(f'pedal web UI not reachable at {PEDAL_URL}: {e}')
+
+    time.sleep(IDLE_SECONDS)
+    m1 = metrics()
+
+    stop = time.monotonic() + LOAD_SECONDS
+    served = [0] * LOAD_CLIENTS
+
+    def client(i: int) -> None:
+        while time.monotonic() < stop:
+            try:
+                get(LOAD_PATHS[served[i] % len(LOAD_PATHS)])
+            except OSError:
+                pass
+            served[i] += 1
+
+    threads = [threading.Thread(target=client, args=(i,)) for i in range(LOAD_CLIENTS)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    m2 = metrics()
+
+    idle, load = worst_bucket(m0, m1), worst_bucket(m1, m2)
+    dropped = m2['scan']['dropped'] - m0['scan']['dropped']
+    wake = m2['latency_us']['wake']
+    print(f'scan jitter worst: idle < {bound_us(idle)} us, web load < {bound_us(load)} us '
+          f'({sum(served) / LOAD_SECONDS:.0f} requests/s), dropped edges {dropped}, wake p99 {wake["p99"]} us')
+    record_property('jitter_idle_us', bound_us(idle))
+    record_property('jitter_load_us', bound_us(load))
+    record_property('wake_p99_us', wake['p99'])
+    assert dropped == 0
+    # Load may cost one bucket of interrupt latency, not a task's time slice
+    assert load <= max(idle + 1, 4)
@@ -13,3 +13,37 @@ def test_usb_device_midi_example(dut: Dut) -> None:
     dut.expect_exact('MIDI write task init')
     dut.expect_exact('MIDI read task init')
     dut.expect_exact('Writing MIDI data 74')
+
+
+BENCH_SECONDS = 5
+BENCH_LINE = r'USB MIDI bench: (\d+) events/s, ([\d.]+) per transfer, dropped (\d+), stalls (\d+)'
+
+
+@pytest.mark.usb_device
+@pytest.mark.parametrize('config', ['usb_bench'], indirect=True)
+@idf_parametrize('target', ['esp32s3'], indirect=['target'])
+def test_usb_device_midi_throughput(dut: Dut) -> None:
+    # The host only polls the IN endpoint while a MIDI input port is open
+    mido = pytest.importorskip('mido')
+    dut.expect_exact('USB MIDI bench started')
+    names = [n for n in mido.get_input_names() if 'Espressif' in n or 'TinyUSB' in n]
+    if not names:
+        pytest.skip('pedal MIDI port not found on the host')
+
+    received = 0
+    with mido.open_input(names[0]) as port:
+        dut.expect(BENCH_LINE, timeout=5)  # first second includes enumeration
+        rates, per_xfer = [], []
+        for _ in range(BENCH_SECONDS):
+            m = dut.expect(BENCH_LINE, timeout=5)
+            rates.append(int(m.group(1)))
+            per_xfer.append(float(m.group(2)))
+            received += sum(1 for _ in port.iter_pending())
+
+    rate = sum(rates) / len(rates)
+    print(f'USB MIDI: {rate:.0f} events/s on the device, {received / BENCH_SECONDS:.0f}/s seen by the host, '
+          f'{sum(per_xfer) / len(per_xfer):.1f} events per transfer')
+    # One event per transfer is bound by how often the host polls the IN
+    # endpoint; a 64-byte full-speed bulk packet carries 16.
+    assert rate > 4000
+    assert max(per_xfer) > 4